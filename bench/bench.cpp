@@ -0,0 +1,256 @@
+// bench.cpp
+// Times the analyses, every pass and every full pipeline over synthetic grammar families of growing size.
+// Compilar: g++ -std=c++17 -O2 -pthread bench/*.cpp $(ls src/*.cpp | grep -v glc_norm_v2) -Isrc -o glc_bench
+// Uso: ./glc_bench [--families=f1,f2,...] [--sizes=100,1000,...] [--pipelines=cnf,gnf,2nf] [--threads=N] [--seed=S]
+//      [--limit=time=10s,memory=2G] [--csv=resultado.csv] [--json=resultado.jsonl] [--emit=pasta]
+
+#include <bits/stdc++.h>
+
+#include "alloc_stats.hpp"
+#include "analyses.hpp"
+#include "io_handling.hpp"
+#include "pass_manager.hpp"
+#include "synthetic.hpp"
+#include "utility.hpp"
+
+using namespace std;
+
+// One measurement: a pass, a whole pipeline ("(total)") or an analysis over one generated grammar.
+struct BenchRow {
+    string family;
+    size_t size = 0;        // productions asked of the generator
+    size_t productions = 0; // productions of the generated grammar
+    size_t variables = 0;
+    string pipeline;        // "analyses" for the analysis rows
+    string stage;
+    string status;          // ok, skipped (no-op), aborted (--limit), error
+    string message;         // what stopped the stage (aborted, error)
+    double ms = 0;
+    size_t productions_in = 0, productions_out = 0;
+    size_t peak = 0;        // heap high-water mark above what was live when the stage started
+};
+
+static size_t count_productions(const Grammar &G) {
+    size_t n = 0;
+    for (auto &pr : G.P) n += pr.second.size();
+    return n;
+}
+
+static double ms_since(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+// Input productions per second.
+static double throughput(const BenchRow &r) { return r.ms > 0 ? (double)r.productions_in / (r.ms / 1000) : 0.0; }
+
+static string csv_header() {
+    return "family,size,productions,variables,pipeline,stage,status,ms,productions_in,productions_out,"
+           "productions_per_s,peak_bytes,message";
+}
+
+static string csv_quote(const string &s) {
+    if (s.find_first_of(",\"\n") == string::npos) return s;
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c == '\n' ? ' ' : c;
+    }
+    return out + "\"";
+}
+
+static string json_quote(const string &s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c < 0x20) out += ' ';
+        else out += c;
+    }
+    return out + "\"";
+}
+
+static string to_csv(const BenchRow &r) {
+    ostringstream oss;
+    oss << r.family << "," << r.size << "," << r.productions << "," << r.variables << "," << r.pipeline << ","
+        << r.stage << "," << r.status << "," << fixed << setprecision(3) << r.ms << "," << r.productions_in << ","
+        << r.productions_out << "," << setprecision(0) << throughput(r) << "," << r.peak << "," << csv_quote(r.message);
+    return oss.str();
+}
+
+static string to_json(const BenchRow &r) {
+    ostringstream oss;
+    oss << "{\"family\":\"" << r.family << "\",\"size\":" << r.size << ",\"productions\":" << r.productions
+        << ",\"variables\":" << r.variables << ",\"pipeline\":\"" << r.pipeline << "\",\"stage\":\"" << r.stage
+        << "\",\"status\":\"" << r.status << "\",\"ms\":" << fixed << setprecision(3) << r.ms
+        << ",\"productions_in\":" << r.productions_in << ",\"productions_out\":" << r.productions_out
+        << ",\"productions_per_s\":" << setprecision(0) << throughput(r) << ",\"peak_bytes\":" << r.peak;
+    if (!r.message.empty()) oss << ",\"message\":" << json_quote(r.message);
+    oss << "}";
+    return oss.str();
+}
+
+// Times each analysis from scratch on G.
+static void bench_analyses(const Grammar &G, unsigned threads, BenchRow base, vector<BenchRow> &rows) {
+    base.pipeline = "analyses";
+    base.productions_in = base.productions_out = count_productions(G);
+    vector<pair<string, function<void()>>> analyses = {
+        { "nullable", [&]() { compute_nullable(G, threads); } },
+        { "generating", [&]() { compute_generating(G, threads); } },
+        { "reachable", [&]() { compute_reachable(G); } },
+        { "unit-closure", [&]() { compute_unit_closure(G, threads); } },
+    };
+    for (auto &a : analyses) {
+        BenchRow r = base;
+        r.stage = a.first;
+        reset_alloc_peak();
+        size_t live = alloc_stats().live;
+        auto t0 = chrono::steady_clock::now();
+        a.second();
+        r.ms = ms_since(t0);
+        r.peak = alloc_stats().peak - live;
+        r.status = "ok";
+        rows.push_back(r);
+    }
+}
+
+// Runs the pipeline on a copy of G with run_pipeline, one row per pass from PassContext::on_pass. A pass over
+// a limit (or that fails) ends the pipeline; the message goes into its row and to stderr.
+static void bench_pipeline(const Grammar &G, const string &name, const Budget &limits, unsigned threads,
+                           BenchRow base, vector<BenchRow> &rows) {
+    base.pipeline = name;
+    Logger quiet("/dev/null");
+    quiet.enabled = false;
+    size_t live_before = alloc_stats().live, peak = live_before, pass_start = 0;
+    BenchRow total = base;
+    total.stage = "(total)";
+    total.status = "ok";
+    total.productions_in = total.productions_out = count_productions(G);
+    {
+        Grammar H = G;
+        PassContext ctx(quiet);
+        ctx.threads = threads;
+        ctx.budget.copy_limits(limits);
+        ctx.on_pass = [&](const PassReport &p) {
+            BenchRow r = base;
+            r.stage = p.pass->name;
+            r.status = p.status;
+            r.message = p.error;
+            r.ms = p.ms;
+            r.productions_in = p.productions_in;
+            r.productions_out = p.productions_out;
+            r.peak = p.peak;
+            // the peak of a pass is above what was live when it started; the total's above the pipeline's start
+            peak = max(peak, pass_start + p.peak);
+            total.ms += r.ms;
+            total.productions_out = r.productions_out;
+            rows.push_back(r);
+            pass_start = alloc_stats().live;
+        };
+        pass_start = alloc_stats().live;
+        try {
+            run_pipeline(H, parse_pipeline(name), ctx);
+        } catch (const exception &e) {
+            total.status = dynamic_cast<const BudgetExceeded *>(&e) ? "aborted" : "error";
+            total.message = e.what();
+            cerr << "  " << name << ": " << e.what() << "\n";
+        }
+    }
+    total.peak = peak - live_before;
+    rows.push_back(total);
+}
+
+int main(int argc, char** argv) {
+    vector<string> families, pipelines = { "cnf", "gnf", "2nf" };
+    vector<size_t> sizes = { 100, 1000, 10000, 100000, 1000000 };
+    unsigned threads = 1;
+    uint64_t seed = 1;
+    string csvf, jsonf, emitd;
+    Budget limits;
+    limits.global.seconds = 10;               // per pipeline run
+    limits.global.memory = (size_t)2 << 30;  // live heap
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            vector<string> list;
+            if (arg.rfind("--families=", 0) == 0) {
+                split_tokens_list(arg.substr(11), families);
+            } else if (arg.rfind("--sizes=", 0) == 0) {
+                split_tokens_list(arg.substr(8), list);
+                sizes.clear();
+                for (auto &s : list) sizes.push_back((size_t)strtod(s.c_str(), nullptr)); // accepts 1e5
+            } else if (arg.rfind("--pipelines=", 0) == 0) {
+                pipelines.clear();
+                split_tokens_list(arg.substr(12), pipelines);
+                for (auto &p : pipelines) parse_pipeline(p);
+            } else if (arg.rfind("--threads=", 0) == 0) {
+                threads = (unsigned)max(1, atoi(arg.c_str() + 10));
+            } else if (arg.rfind("--seed=", 0) == 0) {
+                seed = strtoull(arg.c_str() + 7, nullptr, 10);
+            } else if (arg.rfind("--limit=", 0) == 0) {
+                parse_limit_spec(arg.substr(8), limits);
+            } else if (arg.rfind("--csv=", 0) == 0) {
+                csvf = arg.substr(6);
+            } else if (arg.rfind("--json=", 0) == 0) {
+                jsonf = arg.substr(7);
+            } else if (arg.rfind("--emit=", 0) == 0) {
+                emitd = arg.substr(7);
+            } else {
+                cerr << "Opção desconhecida: " << arg << "\n";
+                cerr << "Uso: " << argv[0] << " [--families=f1,...] [--sizes=100,1000,...] [--pipelines=cnf,gnf,2nf] [--threads=N]"
+                     << " [--seed=S] [--limit=time=10s,memory=2G] [--csv=arquivo] [--json=arquivo] [--emit=pasta]\n";
+                cerr << "Famílias:";
+                for (auto &f : grammar_families()) cerr << " " << f.name;
+                cerr << "\n";
+                return 1;
+            }
+        }
+        if (families.empty())
+            for (auto &f : grammar_families()) families.push_back(f.name);
+        for (auto &f : families)
+            if (!find_family(f)) throw runtime_error("Família desconhecida: '" + f + "'");
+        if (!emitd.empty()) filesystem::create_directories(emitd);
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    ofstream csv_file, json_file;
+    if (!csvf.empty()) csv_file.open(csvf);
+    if (!jsonf.empty()) json_file.open(jsonf);
+    if ((!csvf.empty() && !csv_file) || (!jsonf.empty() && !json_file)) {
+        cerr << "Não foi possível criar os arquivos de resultado.\n";
+        return 1;
+    }
+    // CSV goes to stdout unless a file is given, so it can be piped; progress goes to stderr
+    ostream &csv = csvf.empty() ? cout : csv_file;
+    csv << csv_header() << "\n";
+
+    for (auto &fname : families) {
+        const GrammarFamily &family = *find_family(fname);
+        for (size_t size : sizes) {
+            auto tg = chrono::steady_clock::now();
+            Grammar G = family.make(size, seed);
+            BenchRow base;
+            base.family = family.name;
+            base.size = size;
+            base.productions = count_productions(G);
+            base.variables = G.V.size();
+            cerr << family.name << " " << size << ": " << base.productions << " produções, " << base.variables
+                 << " variáveis (gerada em " << fixed << setprecision(1) << ms_since(tg) << " ms)\n";
+            if (!emitd.empty())
+                write_grammar_file(emitd + "/" + family.name + "-" + to_string(size) + ".txt", G, GrammarFormat::Text);
+
+            vector<BenchRow> rows;
+            bench_analyses(G, threads, base, rows);
+            for (auto &p : pipelines) bench_pipeline(G, p, limits, threads, base, rows);
+            for (auto &r : rows) {
+                csv << to_csv(r) << "\n";
+                if (json_file.is_open()) json_file << to_json(r) << "\n";
+                if (r.stage == "(total)")
+                    cerr << "  " << r.pipeline << ": " << r.status << ", " << fixed << setprecision(1) << r.ms << " ms, "
+                         << r.productions_out << " produções, pico " << format_bytes(r.peak) << "\n";
+            }
+            csv.flush();
+        }
+    }
+    return 0;
+}
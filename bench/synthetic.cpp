@@ -0,0 +1,166 @@
+#include "synthetic.hpp"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+// Forward references go at most this far, so the dependency graph stays sparse at every size.
+constexpr size_t WINDOW = 64;
+// Unit chains and left-recursive cycles have a fixed length: the output of unit removal grows with the
+// square of the chain length, so longer chains would only measure the output.
+constexpr size_t CHAIN = 16;
+constexpr size_t CYCLE = 8;
+
+struct Builder {
+    Grammar G;
+    mt19937_64 rng;
+    vector<Symbol> roots;
+
+    explicit Builder(uint64_t seed) : rng(seed) { G.S = "S"; G.V.insert("S"); }
+
+    size_t pick(size_t n) { return (size_t)(rng() % n); }
+    Symbol var(const string &prefix, size_t i) {
+        Symbol X = prefix + to_string(i);
+        G.V.insert(X);
+        return X;
+    }
+    Symbol term(size_t i) {
+        Symbol t = "t" + to_string(i);
+        G.T.insert(t);
+        return t;
+    }
+    void rule(const Symbol &A, RHS rhs) { G.P[A].push_back(std::move(rhs)); }
+
+    // S -> R_0, R_k -> root_k R_k+1 | root_k
+    Grammar finish() {
+        for (size_t k = 0; k < roots.size(); ++k) {
+            Symbol R = var("R_", k);
+            if (k == 0) rule("S", { R });
+            if (k + 1 < roots.size()) rule(R, { roots[k], "R_" + to_string(k + 1) });
+            rule(R, { roots[k] });
+        }
+        if (roots.empty()) rule("S", { term(0) });
+        return std::move(G);
+    }
+};
+
+// Variables X0 .. Xn-1 whose bodies refer forward within WINDOW; every WINDOW-th one is a root.
+size_t forward(Builder &b, size_t i, size_t n) { return min(n - 1, i + 1 + b.pick(WINDOW)); }
+
+Grammar unit_chains(size_t productions, uint64_t seed) {
+    Builder b(seed);
+    size_t chains = max<size_t>(1, productions / (2 * CHAIN));
+    for (size_t c = 0; c < chains; ++c) {
+        string prefix = "C" + to_string(c) + "_";
+        b.roots.push_back(b.var(prefix, 0));
+        for (size_t j = 0; j < CHAIN; ++j) {
+            Symbol A = b.var(prefix, j);
+            if (j + 1 < CHAIN) b.rule(A, { b.var(prefix, j + 1) });
+            b.rule(A, { b.term(b.pick(8)) });
+        }
+    }
+    return b.finish();
+}
+
+// Optional variables O_k -> t | & inside bodies that always keep a terminal, so ε-removal multiplies the
+// bodies (up to 8 variants) without creating unit productions.
+Grammar optional_eps(size_t productions, uint64_t seed) {
+    Builder b(seed);
+    size_t n = max<size_t>(2, productions / 5), optional = max<size_t>(1, n / 4);
+    auto opt = [&]() { return b.var("O", b.pick(optional)); };
+    for (size_t k = 0; k < optional; ++k) {
+        b.rule("O" + to_string(k), { b.term(b.pick(8)) });
+        b.rule("O" + to_string(k), {});
+    }
+    for (size_t i = 0; i < n; ++i) {
+        Symbol A = b.var("X", i);
+        if (i % WINDOW == 0) b.roots.push_back(A);
+        b.rule(A, { b.term(b.pick(8)) });
+        b.rule(A, { opt(), b.term(b.pick(8)), opt() });
+        if (i + 1 < n) b.rule(A, { b.term(b.pick(8)), opt(), b.var("X", forward(b, i, n)), opt(), opt() });
+    }
+    return b.finish();
+}
+
+Grammar left_recursion(size_t productions, uint64_t seed) {
+    Builder b(seed);
+    size_t cycles = max<size_t>(1, productions / (2 * CYCLE + 1));
+    for (size_t c = 0; c < cycles; ++c) {
+        string prefix = "L" + to_string(c) + "_";
+        b.roots.push_back(b.var(prefix, 0));
+        // L_j -> L_j+1 t | t, and L_last -> L_0 t | L_last t | t: indirect and direct left recursion
+        for (size_t j = 0; j < CYCLE; ++j) {
+            Symbol A = b.var(prefix, j);
+            b.rule(A, { b.var(prefix, (j + 1) % CYCLE), b.term(b.pick(8)) });
+            if (j + 1 == CYCLE) b.rule(A, { A, b.term(b.pick(8)) });
+            b.rule(A, { b.term(b.pick(8)) });
+        }
+    }
+    return b.finish();
+}
+
+Grammar wide_alphabet(size_t productions, uint64_t seed) {
+    Builder b(seed);
+    size_t n = max<size_t>(2, productions / 4), k = max<size_t>(2, productions / 4);
+    for (size_t i = 0; i < n; ++i) {
+        Symbol A = b.var("X", i);
+        if (i % WINDOW == 0) b.roots.push_back(A);
+        b.rule(A, { b.term(b.pick(k)) });
+        b.rule(A, { b.term(b.pick(k)), b.term(b.pick(k)) });
+        if (i + 1 < n) {
+            b.rule(A, { b.term(b.pick(k)), b.var("X", forward(b, i, n)), b.term(b.pick(k)) });
+            b.rule(A, { b.var("X", forward(b, i, n)), b.var("X", forward(b, i, n)) });
+        }
+    }
+    return b.finish();
+}
+
+Grammar long_bodies(size_t productions, uint64_t seed) {
+    Builder b(seed);
+    size_t n = max<size_t>(2, productions / 2);
+    for (size_t i = 0; i < n; ++i) {
+        Symbol A = b.var("X", i);
+        if (i % WINDOW == 0) b.roots.push_back(A);
+        b.rule(A, { b.term(b.pick(8)) });
+        if (i + 1 == n) continue;
+        RHS rhs(8 + b.pick(9));
+        for (auto &X : rhs) X = b.pick(2) ? b.var("X", forward(b, i, n)) : b.term(b.pick(8));
+        b.rule(A, rhs);
+    }
+    return b.finish();
+}
+
+Grammar random_dag(size_t productions, uint64_t seed) {
+    Builder b(seed);
+    size_t n = max<size_t>(2, productions * 2 / 5);
+    for (size_t i = 0; i < n; ++i) {
+        Symbol A = b.var("X", i);
+        if (i % WINDOW == 0) b.roots.push_back(A);
+        size_t bodies = 1 + b.pick(4);
+        for (size_t r = 0; r < bodies; ++r) {
+            RHS rhs(b.pick(5));
+            for (auto &X : rhs) X = i + 1 < n && b.pick(2) ? b.var("X", forward(b, i, n)) : b.term(b.pick(16));
+            b.rule(A, rhs);
+        }
+    }
+    return b.finish();
+}
+}
+
+/// @brief All families, in the order the benchmark runs them.
+const vector<GrammarFamily> &grammar_families() {
+    static const vector<GrammarFamily> families = {
+        { "unit-chain", "cadeias de produções unitárias (comprimento 16)", unit_chains },
+        { "optional-eps", "variáveis opcionais (t | &) em corpos que sempre mantêm um terminal", optional_eps },
+        { "left-rec", "ciclos de recursão à esquerda direta e indireta (comprimento 8)", left_recursion },
+        { "wide-alphabet", "um terminal para cada quatro produções", wide_alphabet },
+        { "long-rhs", "corpos de 8 a 16 símbolos", long_bodies },
+        { "random-dag", "corpos aleatórios de 0 a 4 símbolos, dependências acíclicas", random_dag },
+    };
+    return families;
+}
+
+const GrammarFamily *find_family(const string &name) {
+    for (auto &f : grammar_families()) if (f.name == name) return &f;
+    return nullptr;
+}
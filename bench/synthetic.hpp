@@ -0,0 +1,24 @@
+#ifndef SYNTHETIC_HPP
+#define SYNTHETIC_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "grammar.hpp"
+
+using namespace std;
+
+// Parameterized grammar families for the benchmarks. Each generator builds a grammar of about `productions`
+// productions (the exact count is whatever G.P holds), deterministic for a given seed. The groups each family
+// is made of are tied to the start by S -> R_0, R_k -> root_k R_k+1 | root_k, so every group is reachable.
+struct GrammarFamily {
+    string name;
+    string description;
+    Grammar (*make)(size_t productions, uint64_t seed);
+};
+
+const vector<GrammarFamily> &grammar_families();
+const GrammarFamily *find_family(const string &name);
+
+#endif
@@ -0,0 +1,100 @@
+#include "alloc_stats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+// Blocks are counted by the size malloc reports for them, so no header is added to the block and delete
+// does not need the size the caller asked for. Each thread counts in its own counters and adds them to the
+// shared totals only when its live bytes have moved by FOLD, when it reads the totals and when a
+// parallel_for worker ends, so a small allocation touches no shared cache line.
+static constexpr long long FOLD = 64 << 10;
+
+struct ThreadCounts {
+    long long allocations = 0, bytes = 0, live = 0; // live may go negative: a block freed by another thread
+};
+static thread_local ThreadCounts t_counts;
+
+static size_t block_size(void *p) noexcept {
+#if defined(__APPLE__)
+    return malloc_size(p);
+#elif defined(_WIN32)
+    return _msize(p);
+#else
+    return malloc_usable_size(p);
+#endif
+}
+
+static atomic<long long> g_allocations{0}, g_bytes{0}, g_live{0}, g_peak{0};
+
+static void fold(ThreadCounts &c) noexcept {
+    if (c.allocations) g_allocations.fetch_add(c.allocations, memory_order_relaxed);
+    if (c.bytes) g_bytes.fetch_add(c.bytes, memory_order_relaxed);
+    long long live = g_live.fetch_add(c.live, memory_order_relaxed) + c.live;
+    long long peak = g_peak.load(memory_order_relaxed);
+    while (live > peak && !g_peak.compare_exchange_weak(peak, live, memory_order_relaxed)) {}
+    c = ThreadCounts();
+}
+
+static void *counted_alloc(size_t n) {
+    void *p = malloc(n ? n : 1);
+    if (!p) throw bad_alloc();
+    ThreadCounts &c = t_counts;
+    ++c.allocations;
+    c.bytes += (long long)n;
+    c.live += (long long)block_size(p);
+    if (c.live >= FOLD) fold(c);
+    return p;
+}
+
+static void counted_free(void *p) noexcept {
+    if (!p) return;
+    ThreadCounts &c = t_counts;
+    c.live -= (long long)block_size(p);
+    if (c.live <= -FOLD) fold(c);
+    free(p);
+}
+
+void *operator new(size_t n) { return counted_alloc(n); }
+void *operator new[](size_t n) { return counted_alloc(n); }
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t) noexcept { counted_free(p); }
+
+void fold_alloc_stats() {
+    fold(t_counts);
+}
+
+AllocStats alloc_stats() {
+    fold(t_counts);
+    auto unsigned_of = [](const atomic<long long> &x) { return (size_t)max(0LL, x.load(memory_order_relaxed)); };
+    AllocStats s;
+    s.allocations = unsigned_of(g_allocations);
+    s.bytes = unsigned_of(g_bytes);
+    s.live = unsigned_of(g_live);
+    s.peak = unsigned_of(g_peak);
+    return s;
+}
+
+void reset_alloc_peak() {
+    fold(t_counts);
+    g_peak.store(g_live.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+string format_bytes(size_t n) {
+    const char *unit[] = { "B", "KiB", "MiB", "GiB" };
+    double v = (double)n;
+    int u = 0;
+    while (v >= 1024 && u < 3) { v /= 1024; ++u; }
+    char buf[32];
+    snprintf(buf, sizeof buf, u ? "%.1f %s" : "%.0f %s", v, unit[u]);
+    return buf;
+}
@@ -0,0 +1,24 @@
+#ifndef ALLOC_STATS_HPP
+#define ALLOC_STATS_HPP
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+// Counters fed by the global operator new/delete replacement in alloc_stats.cpp. Each thread keeps its own
+// counts and folds them into these totals every 64 KiB of change in its live bytes, so the totals (and peak)
+// can lag by that much per running thread.
+struct AllocStats {
+    size_t allocations = 0; // number of calls to operator new
+    size_t bytes = 0;       // bytes requested in total
+    size_t live = 0;        // bytes currently allocated (as malloc sized the blocks)
+    size_t peak = 0;        // high-water mark of live since the last reset_alloc_peak()
+};
+
+AllocStats alloc_stats();      // folds the calling thread's counts first
+void reset_alloc_peak();
+void fold_alloc_stats();       // adds the calling thread's counts to the totals (a worker before it ends)
+string format_bytes(size_t n);
+
+#endif
@@ -0,0 +1,165 @@
+#include "ambiguity.hpp"
+#include "enumerator.hpp"
+#include "parallel.hpp"
+#include "terminal_classes.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+struct CnfIndex {
+    size_t nv = 0;
+    vector<Symbol> vars;
+    unordered_map<Symbol, uint32_t> token;  // terminal -> token id
+    vector<vector<uint32_t>> term_heads;    // token id -> every A with A -> t
+    vector<vector<pair<uint32_t, uint32_t>>> left; // left[B]: (C, A) for every A -> B C
+};
+
+// Counting CYK over one word. Counts are dense per (cell, variable) and saturate at 2; each cell also
+// lists the variables it has, so only those are combined and only those are cleared afterwards.
+struct Counter {
+    const CnfIndex &ix;
+    vector<uint8_t> count;
+    vector<vector<uint32_t>> present;
+    size_t n = 0;
+
+    explicit Counter(const CnfIndex &index) : ix(index) {}
+
+    size_t at(size_t i, size_t len) const { return i * (n + 1) + len; }
+
+    // variables deriving the whole word at least twice
+    void run(const vector<uint32_t> &tokens, vector<uint32_t> &ambiguous) {
+        n = tokens.size();
+        size_t cells = n * (n + 1);
+        if (present.size() < cells) {
+            present.resize(cells);
+            count.assign(cells * ix.nv, 0);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            size_t c = at(i, 1);
+            for (uint32_t A : ix.term_heads[tokens[i]]) {
+                uint8_t &x = count[c * ix.nv + A];
+                if (!x) present[c].push_back(A);
+                x = (uint8_t)min(2, x + 1);
+            }
+        }
+        for (size_t len = 2; len <= n; ++len)
+            for (size_t i = 0; i + len <= n; ++i) {
+                size_t o = at(i, len);
+                uint8_t *out = count.data() + o * ix.nv;
+                for (size_t k = 1; k < len; ++k) {
+                    size_t l = at(i, k), r = at(i + k, len - k);
+                    const uint8_t *L = count.data() + l * ix.nv, *R = count.data() + r * ix.nv;
+                    for (uint32_t B : present[l])
+                        for (auto &ca : ix.left[B]) {
+                            uint8_t cr = R[ca.first];
+                            if (!cr) continue;
+                            uint8_t &x = out[ca.second];
+                            if (!x) present[o].push_back(ca.second);
+                            x = (uint8_t)min(2, x + L[B] * cr);
+                        }
+                }
+            }
+        ambiguous.clear();
+        size_t top = at(0, n);
+        for (uint32_t A : present[top])
+            if (count[top * ix.nv + A] >= 2) ambiguous.push_back(A);
+        // clear what this word touched
+        for (size_t c = 0; c < cells; ++c) {
+            for (uint32_t A : present[c]) count[c * ix.nv + A] = 0;
+            present[c].clear();
+        }
+    }
+};
+}
+
+/// @brief Shortest witness of ambiguity for every variable, up to a length bound.
+/// @param G Grammar in CNF (S -> & is ignored: the empty word has at most one derivation).
+/// @param max_length Longest witness looked for.
+/// @param threads Workers for the counting charts.
+AmbiguityReport find_ambiguities(const Grammar &G, size_t max_length, unsigned threads) {
+    CnfIndex ix;
+    unordered_map<Symbol, uint32_t> id;
+    for (auto &A : G.V) {
+        id.emplace(A, (uint32_t)ix.nv++);
+        ix.vars.push_back(A);
+    }
+    ix.left.assign(ix.nv, {});
+    for (auto &t : G.T) {
+        if (t == "&") continue;
+        ix.token.emplace(t, (uint32_t)ix.term_heads.size());
+        ix.term_heads.emplace_back();
+    }
+    for (auto &pr : G.P) {
+        auto a = id.find(pr.first);
+        if (a == id.end()) continue;
+        for (auto &rhs : pr.second) {
+            if (rhs.empty() || rhs == RHS{ "&" }) continue;
+            if (rhs.size() == 1 && ix.token.count(rhs[0])) ix.term_heads[ix.token.at(rhs[0])].push_back(a->second);
+            else if (rhs.size() == 2 && id.count(rhs[0]) && id.count(rhs[1]))
+                ix.left[id.at(rhs[0])].emplace_back(id.at(rhs[1]), a->second);
+            else
+                throw runtime_error("Produção de '" + pr.first + "' fora da CNF: a análise de ambiguidade exige a gramática em CNF (use --passes=cnf).");
+        }
+    }
+
+    AmbiguityReport report;
+    report.max_length = max_length;
+    vector<char> resolved(ix.nv, 0);
+    size_t left_to_find = ix.nv;
+    // Terminals of one class have the same counts everywhere, so only words over the class
+    // representatives are checked. The representative is the smallest member, hence the first word
+    // found is still the first in terminal order among all the ambiguous ones.
+    TerminalClasses tc = compute_terminal_classes(G);
+    Grammar R = G;
+    for (auto &pr : R.P) {
+        auto &bodies = pr.second;
+        bodies.erase(remove_if(bodies.begin(), bodies.end(), [&](const RHS &rhs) {
+            if (rhs.size() != 1 || !ix.token.count(rhs[0])) return false;
+            return tc.representative[tc.class_of[tc.token_id.at(rhs[0])]] != rhs[0];
+        }), bodies.end());
+    }
+    Symbol top = "AMB_S";
+    while (G.V.count(top) || G.T.count(top)) top += "_";
+    const size_t BATCH = 4096;
+    threads = max(1u, threads);
+    vector<Counter> counters(threads, Counter(ix));
+    vector<vector<Symbol>> words;
+    vector<vector<uint32_t>> tokens(BATCH), found(BATCH);
+
+    for (size_t n = 1; n <= max_length && left_to_find; ++n) {
+        // words of length n of the variables still unresolved
+        Grammar H = R;
+        H.V.insert(top);
+        H.S = top;
+        auto &bodies = H.P[top];
+        for (uint32_t A = 0; A < ix.nv; ++A) if (!resolved[A]) bodies.push_back(RHS{ ix.vars[A] });
+        LanguageEnumerator en(H, n, n);
+        vector<char> resolved_now(resolved);
+        bool more = true;
+        while (more && left_to_find) {
+            words.clear();
+            vector<Symbol> w;
+            while (words.size() < BATCH && (more = en.next(w))) words.push_back(w);
+            parallel_for(words.size(), threads, [&](size_t begin, size_t end, unsigned worker) {
+                for (size_t j = begin; j < end; ++j) {
+                    tokens[j].clear();
+                    for (auto &t : words[j]) tokens[j].push_back(ix.token.at(t));
+                    counters[worker].run(tokens[j], found[j]);
+                }
+            });
+            report.words_checked += words.size();
+            // in enumeration order, so the first word found for a variable is its witness
+            for (size_t j = 0; j < words.size(); ++j)
+                for (uint32_t A : found[j]) {
+                    if (resolved_now[A]) continue;
+                    resolved_now[A] = 1;
+                    --left_to_find;
+                    report.witness.emplace(ix.vars[A], words[j]);
+                }
+        }
+        resolved.swap(resolved_now);
+    }
+    return report;
+}
@@ -0,0 +1,28 @@
+#ifndef AMBIGUITY_HPP
+#define AMBIGUITY_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "grammar.hpp"
+
+using namespace std;
+
+struct AmbiguityReport {
+    size_t max_length = 0;
+    size_t words_checked = 0; // words over the class representatives
+    map<Symbol, vector<Symbol>> witness; // ambiguous variable -> shortest word (then first in terminal order) with two derivations
+};
+
+// Bounded ambiguity check of a CNF grammar. For each length n up to max_length, the words of length n
+// derived by some variable not yet known to be ambiguous are enumerated in order (LanguageEnumerator on
+// the grammar plus a new start with a unit rule to each such variable), and each word gets a counting
+// CYK: derivations per (span, variable), saturated at 2, combining only the variables present in each
+// sub-span. A variable whose count over the whole word reaches 2 is ambiguous with that word as
+// witness. Terminals of one class (compute_terminal_classes) share their counts, so only the words over
+// the class representatives are enumerated. Words are checked in batches split among the threads.
+// Finding nothing is not a proof.
+AmbiguityReport find_ambiguities(const Grammar &G, size_t max_length, unsigned threads);
+
+#endif
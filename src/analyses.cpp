@@ -0,0 +1,257 @@
+#include "analyses.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "budget.hpp"
+#include "components.hpp"
+
+static void tick(Budget *budget) {
+    if (budget) budget->tick();
+}
+
+// Least fixpoint of "some rule of v has only symbols that pass": a variable passes once set, a terminal
+// when terminals_pass. Component by component, sinks first. A variable outside a cycle is decided by one look
+// at its rules; in a recursive component every live rule counts its symbols from the component still unset,
+// and a variable that gets set lowers the counts of the rules it occurs in (linear in the component's rules).
+static vector<char> component_fixpoint(const GrammarComponents &gc, bool terminals_pass, unsigned threads, Budget *budget) {
+    vector<char> set_(gc.vars.size(), 0);
+    const uint32_t DEAD = UINT32_MAX;
+    for_each_component(gc, threads, [&](uint32_t c, unsigned) {
+        // rules of the component: owner, symbols of the component still unset (DEAD: fails on a symbol below)
+        vector<uint32_t> owner, missing, queue;
+        vector<pair<uint32_t, uint32_t>> occurs; // (member, rule index) for each occurrence inside the component
+        for (uint32_t i = gc.member_off[c]; i < gc.member_off[c + 1]; ++i) {
+            uint32_t v = gc.members[i];
+            for (uint32_t r = gc.rule_off[v]; r < gc.rule_off[v + 1]; ++r) {
+                tick(budget);
+                uint32_t count = 0, idx = (uint32_t)owner.size();
+                for (uint32_t k = gc.body_off[r]; k < gc.body_off[r + 1] && count != DEAD; ++k) {
+                    uint32_t X = gc.body[k];
+                    if (X == GrammarComponents::TERMINAL) { if (!terminals_pass) count = DEAD; }
+                    else if (gc.comp[X] != c) { if (!set_[X]) count = DEAD; }
+                    else { ++count; occurs.emplace_back(X, idx); }
+                }
+                if (count == 0 && !set_[v]) { set_[v] = 1; queue.push_back(v); }
+                owner.push_back(v);
+                missing.push_back(count);
+            }
+        }
+        if (!gc.recursive[c] || queue.empty()) return;
+        sort(occurs.begin(), occurs.end());
+        for (size_t q = 0; q < queue.size(); ++q) {
+            uint32_t v = queue[q];
+            tick(budget);
+            auto it = lower_bound(occurs.begin(), occurs.end(), make_pair(v, 0u));
+            for (; it != occurs.end() && it->first == v; ++it) {
+                uint32_t r = it->second;
+                if (missing[r] == DEAD || --missing[r] != 0) continue;
+                uint32_t A = owner[r];
+                if (!set_[A]) { set_[A] = 1; queue.push_back(A); }
+            }
+        }
+    });
+    return set_;
+}
+
+// Nullable / generating: one sweep over G.V in order, each variable by its rules until one passes (the
+// first round of the plain fixpoint, cheap since most variables stop at an early rule), then the components
+// of the variables left undecided. Their rules go into a smaller grammar where a decided variable is a
+// terminal (generating) or is dropped from the body (nullable).
+static set<Symbol> flag_fixpoint(const Grammar &G, bool terminals_pass, unsigned threads, Budget *budget) {
+    set<Symbol> decided;
+    auto passes = [&](const Symbol &X) { return G.isTerminal(X) ? terminals_pass : decided.count(X) > 0; };
+    vector<Symbol> open;
+    for (auto &A : G.V) {
+        tick(budget);
+        auto pr = G.P.find(A);
+        bool ok = false;
+        if (pr != G.P.end())
+            for (auto &rhs : pr->second) {
+                ok = rhs == RHS{ "&" } || all_of(rhs.begin(), rhs.end(), passes);
+                if (ok) break;
+            }
+        if (ok) decided.insert(decided.end(), A);
+        else if (pr != G.P.end()) open.push_back(A);
+    }
+    if (open.empty()) return decided;
+
+    Grammar H;
+    H.T = G.T;
+    if (terminals_pass) H.T.insert(decided.begin(), decided.end());
+    for (auto &A : open) {
+        H.V.insert(H.V.end(), A);
+        auto &dst = H.P[A];
+        for (auto &rhs : G.P.at(A)) {
+            if (terminals_pass || rhs == RHS{ "&" }) { dst.push_back(rhs); continue; }
+            RHS kept;
+            for (auto &X : rhs) if (!decided.count(X)) kept.push_back(X);
+            dst.push_back(kept);
+        }
+    }
+    GrammarComponents gc = decompose_grammar(H);
+    vector<char> flags = component_fixpoint(gc, terminals_pass, threads, budget);
+    for (size_t v = 0; v < open.size(); ++v) if (flags[v]) decided.insert(gc.vars[v]);
+    return decided;
+}
+
+/// @brief Variables that derive the empty word.
+/// @param G Grammar to analyse.
+/// @param threads Workers for the components of one level.
+/// @param budget Limits checked while it runs (may be null).
+/// @return Set of nullable variables.
+set<Symbol> compute_nullable(const Grammar &G, unsigned threads, Budget *budget) {
+    return flag_fixpoint(G, false, threads, budget);
+}
+
+/// @brief Variables that derive at least one string of terminals.
+/// @param G Grammar to analyse.
+/// @param threads Workers for the components of one level.
+/// @param budget Limits checked while it runs (may be null).
+/// @return Set of generating variables.
+set<Symbol> compute_generating(const Grammar &G, unsigned threads, Budget *budget) {
+    return flag_fixpoint(G, true, threads, budget);
+}
+
+/// @brief Variables reachable from the start symbol.
+/// @param G Grammar to analyse.
+/// @param budget Limits checked while it runs (may be null).
+/// @return Set of reachable variables (always contains G.S).
+set<Symbol> compute_reachable(const Grammar &G, Budget *budget) {
+    set<Symbol> reach{ G.S };
+    vector<Symbol> work{ G.S };
+    while (!work.empty()) {
+        Symbol A = work.back();
+        work.pop_back();
+        tick(budget);
+        auto pr = G.P.find(A);
+        if (pr == G.P.end()) continue;
+        for (auto &rhs : pr->second)
+            for (auto &X : rhs)
+                if (!G.isTerminal(X) && reach.insert(X).second) work.push_back(X);
+    }
+    return reach;
+}
+
+/// @brief For every variable A, the set of B with A =>* B using unit productions only.
+/// A search from each variable that stops at the variables of lower components, whose closures are final.
+/// @param G Grammar to analyse.
+/// @param threads Workers for the components of one level.
+/// @param budget Limits checked while it runs (may be null).
+/// @return Map from each variable of G.V to its unit closure (contains A itself).
+map<Symbol, set<Symbol>> compute_unit_closure(const Grammar &G, unsigned threads, Budget *budget) {
+    GrammarComponents gc = decompose_grammar(G);
+    size_t nv = gc.vars.size();
+    vector<vector<uint32_t>> closure(nv);
+    // per worker: the variable whose search last saw each variable, and the search stack
+    vector<vector<uint32_t>> seen_by(max(1u, threads), vector<uint32_t>(nv, UINT32_MAX));
+    vector<vector<uint32_t>> stacks(max(1u, threads));
+    for_each_component(gc, threads, [&](uint32_t c, unsigned worker) {
+        vector<uint32_t> &seen = seen_by[worker], &stack = stacks[worker];
+        for (uint32_t i = gc.member_off[c]; i < gc.member_off[c + 1]; ++i) {
+            uint32_t A = gc.members[i];
+            vector<uint32_t> &out = closure[A];
+            stack.assign(1, A);
+            seen[A] = A;
+            while (!stack.empty()) {
+                uint32_t B = stack.back();
+                stack.pop_back();
+                tick(budget);
+                if (gc.comp[B] != c) {
+                    out.insert(out.end(), closure[B].begin(), closure[B].end());
+                    continue;
+                }
+                out.push_back(B);
+                for (uint32_t r = gc.rule_off[B]; r < gc.rule_off[B + 1]; ++r) {
+                    if (gc.body_off[r + 1] - gc.body_off[r] != 1) continue;
+                    uint32_t X = gc.body[gc.body_off[r]];
+                    if (X == GrammarComponents::TERMINAL || seen[X] == A) continue;
+                    seen[X] = A;
+                    stack.push_back(X);
+                }
+            }
+            sort(out.begin(), out.end());
+            out.erase(unique(out.begin(), out.end()), out.end());
+        }
+    });
+    map<Symbol, set<Symbol>> result;
+    uint32_t v = 0;
+    for (auto &A : G.V) {
+        auto &dst = result.emplace_hint(result.end(), A, set<Symbol>())->second;
+        for (uint32_t B : closure[v++]) dst.insert(dst.end(), gc.vars[B]);
+    }
+    return result;
+}
+
+string analysis_name(Analysis a) {
+    switch (a) {
+        case AN_NULLABLE: return "nullable";
+        case AN_UNIT_CLOSURE: return "unit-closure";
+        case AN_GENERATING: return "generating";
+        case AN_REACHABLE: return "reachable";
+        default: return "?";
+    }
+}
+
+static double ms_since(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+/// @brief Counts a cache hit or miss; on a miss the caller computes the analysis and marks it valid only once
+/// the result is stored, so an analysis that throws (a budget limit, bad_alloc) is computed again next time.
+bool AnalysisCache::hit(Analysis a) {
+    if (valid & a) { ++hits; return true; }
+    ++misses;
+    return false;
+}
+
+const set<Symbol> &AnalysisCache::nullable(const Grammar &G) {
+    if (!hit(AN_NULLABLE)) {
+        auto t0 = chrono::steady_clock::now();
+        nullable_ = compute_nullable(G, threads, budget);
+        ms += ms_since(t0);
+        mark(AN_NULLABLE);
+    }
+    return nullable_;
+}
+
+const set<Symbol> &AnalysisCache::generating(const Grammar &G) {
+    if (!hit(AN_GENERATING)) {
+        auto t0 = chrono::steady_clock::now();
+        generating_ = compute_generating(G, threads, budget);
+        ms += ms_since(t0);
+        mark(AN_GENERATING);
+    }
+    return generating_;
+}
+
+const set<Symbol> &AnalysisCache::reachable(const Grammar &G) {
+    if (!hit(AN_REACHABLE)) {
+        auto t0 = chrono::steady_clock::now();
+        reachable_ = compute_reachable(G, budget);
+        ms += ms_since(t0);
+        mark(AN_REACHABLE);
+    }
+    return reachable_;
+}
+
+const map<Symbol, set<Symbol>> &AnalysisCache::unit_closure(const Grammar &G) {
+    if (!hit(AN_UNIT_CLOSURE)) {
+        auto t0 = chrono::steady_clock::now();
+        unit_closure_ = compute_unit_closure(G, threads, budget);
+        ms += ms_since(t0);
+        mark(AN_UNIT_CLOSURE);
+    }
+    return unit_closure_;
+}
+
+void AnalysisCache::compute(unsigned mask, const Grammar &G) {
+    if (mask & AN_NULLABLE) nullable(G);
+    if (mask & AN_UNIT_CLOSURE) unit_closure(G);
+    if (mask & AN_GENERATING) generating(G);
+    if (mask & AN_REACHABLE) reachable(G);
+}
+
+void AnalysisCache::set_nullable(set<Symbol> s) { nullable_ = std::move(s); mark(AN_NULLABLE); }
+void AnalysisCache::set_generating(set<Symbol> s) { generating_ = std::move(s); mark(AN_GENERATING); }
+void AnalysisCache::set_reachable(set<Symbol> s) { reachable_ = std::move(s); mark(AN_REACHABLE); }
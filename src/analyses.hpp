@@ -0,0 +1,66 @@
+#ifndef ANALYSES_HPP
+#define ANALYSES_HPP
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include "grammar.hpp"
+
+using namespace std;
+
+class Budget;
+
+// Analyses the passes depend on. Passes declare which of them survive (bitmask).
+enum Analysis : unsigned {
+    AN_NONE         = 0,
+    AN_NULLABLE     = 1u << 0,
+    AN_UNIT_CLOSURE = 1u << 1,
+    AN_GENERATING   = 1u << 2,
+    AN_REACHABLE    = 1u << 3,
+    AN_ALL          = AN_NULLABLE | AN_UNIT_CLOSURE | AN_GENERATING | AN_REACHABLE
+};
+
+// Nullable, generating and the unit closure are computed per strongly connected component of the
+// dependency graph (components.hpp), the components of one level on `threads` workers. With a budget, every
+// variable looked at and every rule or search step counts as a unit of work (Budget::tick).
+set<Symbol> compute_nullable(const Grammar &G, unsigned threads = 1, Budget *budget = nullptr);
+set<Symbol> compute_generating(const Grammar &G, unsigned threads = 1, Budget *budget = nullptr);
+set<Symbol> compute_reachable(const Grammar &G, Budget *budget = nullptr);
+map<Symbol, set<Symbol>> compute_unit_closure(const Grammar &G, unsigned threads = 1, Budget *budget = nullptr);
+
+string analysis_name(Analysis a);
+
+// Lazily computed analysis results, valid until a pass invalidates them.
+struct AnalysisCache {
+    unsigned valid = AN_NONE;
+    int hits = 0, misses = 0;
+    double ms = 0;        // time spent computing the misses
+    unsigned threads = 1; // workers for the analyses (PassContext::threads)
+    Budget *budget = nullptr; // the run's limits (PassContext::budget), checked while an analysis runs
+
+    const set<Symbol> &nullable(const Grammar &G);
+    const set<Symbol> &generating(const Grammar &G);
+    const set<Symbol> &reachable(const Grammar &G);
+    const map<Symbol, set<Symbol>> &unit_closure(const Grammar &G);
+
+    // Passes that establish a result themselves store it here instead of recomputing it later.
+    void set_nullable(set<Symbol> s);
+    void set_generating(set<Symbol> s);
+    void set_reachable(set<Symbol> s);
+
+    // Make sure every analysis in mask is available.
+    void compute(unsigned mask, const Grammar &G);
+
+    bool has(Analysis a) const { return (valid & a) != 0; }
+    void invalidate(unsigned preserved) { valid &= preserved; }
+
+private:
+    set<Symbol> nullable_, generating_, reachable_;
+    map<Symbol, set<Symbol>> unit_closure_;
+    bool hit(Analysis a);
+    void mark(Analysis a) { valid |= a; }
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "bignat.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+BigNat::BigNat(uint64_t v) {
+    while (v) {
+        limbs_.push_back((uint32_t)v);
+        v >>= 32;
+    }
+}
+
+void BigNat::trim() {
+    while (!limbs_.empty() && limbs_.back() == 0) limbs_.pop_back();
+}
+
+BigNat &BigNat::operator+=(const BigNat &o) {
+    if (limbs_.size() < o.limbs_.size()) limbs_.resize(o.limbs_.size(), 0);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < limbs_.size(); ++i) {
+        uint64_t s = (uint64_t)limbs_[i] + (i < o.limbs_.size() ? o.limbs_[i] : 0) + carry;
+        limbs_[i] = (uint32_t)s;
+        carry = s >> 32;
+        if (!carry && i >= o.limbs_.size()) break;
+    }
+    if (carry) limbs_.push_back((uint32_t)carry);
+    return *this;
+}
+
+BigNat operator*(const BigNat &a, const BigNat &b) {
+    BigNat r;
+    if (a.is_zero() || b.is_zero()) return r;
+    r.limbs_.assign(a.limbs_.size() + b.limbs_.size(), 0);
+    for (size_t i = 0; i < a.limbs_.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b.limbs_.size(); ++j) {
+            uint64_t t = (uint64_t)a.limbs_[i] * b.limbs_[j] + r.limbs_[i + j] + carry;
+            r.limbs_[i + j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        r.limbs_[i + b.limbs_.size()] = (uint32_t)carry;
+    }
+    r.trim();
+    return r;
+}
+
+bool operator<(const BigNat &a, const BigNat &b) {
+    if (a.limbs_.size() != b.limbs_.size()) return a.limbs_.size() < b.limbs_.size();
+    return lexicographical_compare(a.limbs_.rbegin(), a.limbs_.rend(), b.limbs_.rbegin(), b.limbs_.rend());
+}
+
+// Top 64 bits are enough for a double.
+double BigNat::log2() const {
+    if (limbs_.empty()) return -numeric_limits<double>::infinity();
+    size_t n = limbs_.size();
+    double top = limbs_[n - 1];
+    if (n >= 2) top = top * 4294967296.0 + limbs_[n - 2];
+    if (n >= 3) top = top * 4294967296.0 + limbs_[n - 3];
+    return std::log2(top) + 32.0 * (double)(n - min<size_t>(n, 3));
+}
+
+string BigNat::to_string() const {
+    if (limbs_.empty()) return "0";
+    // repeated division by 10^9
+    vector<uint32_t> x = limbs_;
+    vector<uint32_t> parts;
+    while (!x.empty()) {
+        uint64_t rem = 0;
+        for (size_t i = x.size(); i-- > 0;) {
+            uint64_t cur = (rem << 32) | x[i];
+            x[i] = (uint32_t)(cur / 1000000000u);
+            rem = cur % 1000000000u;
+        }
+        parts.push_back((uint32_t)rem);
+        while (!x.empty() && x.back() == 0) x.pop_back();
+    }
+    string out = std::to_string(parts.back());
+    for (size_t i = parts.size() - 1; i-- > 0;) {
+        string p = std::to_string(parts[i]);
+        out += string(9 - p.size(), '0') + p;
+    }
+    return out;
+}
@@ -0,0 +1,31 @@
+#ifndef BIGNAT_HPP
+#define BIGNAT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Arbitrary-precision natural number (32-bit limbs, least significant first, no leading zero limbs).
+// Only what counting derivations needs: +=, *, comparison, decimal output and an approximate log2.
+class BigNat {
+public:
+    BigNat() = default;
+    BigNat(uint64_t v);
+
+    bool is_zero() const { return limbs_.empty(); }
+    BigNat &operator+=(const BigNat &o);
+    friend BigNat operator*(const BigNat &a, const BigNat &b);
+    friend bool operator<(const BigNat &a, const BigNat &b);
+    friend bool operator==(const BigNat &a, const BigNat &b) { return a.limbs_ == b.limbs_; }
+
+    double log2() const;      // -infinity for zero
+    string to_string() const; // decimal
+
+private:
+    vector<uint32_t> limbs_;
+    void trim();
+};
+
+#endif
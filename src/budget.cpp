@@ -0,0 +1,161 @@
+#include "budget.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+#include "alloc_stats.hpp"
+#include "pass_manager.hpp"
+#include "utility.hpp"
+
+namespace {
+// A measured value or limit: seconds for time, bytes for memory, a count otherwise.
+string amount(const string &resource, double v, bool human) {
+    ostringstream oss;
+    if (resource == "time") oss << v << (human ? " s" : "");
+    else if (human && resource == "memory") oss << format_bytes((size_t)v);
+    else oss << (unsigned long long)v;
+    return oss.str();
+}
+
+string message(const string &pass, const string &resource, bool global, double limit, double used) {
+    return "Limite excedido na etapa '" + pass + "': " + resource + " " + amount(resource, used, true) + " > "
+           + amount(resource, limit, true) + (global ? " (limite da execução)." : " (limite da etapa).");
+}
+
+// Productions and body symbols of G ("&" bodies count as empty).
+pair<long long, long long> grammar_counts(const Grammar &G) {
+    long long prods = 0, syms = 0;
+    for (auto &pr : G.P) {
+        prods += (long long)pr.second.size();
+        for (auto &rhs : pr.second) syms += rhs == RHS{ "&" } ? 0 : (long long)rhs.size();
+    }
+    return { prods, syms };
+}
+
+string limits_to_string(const Limits &l) {
+    ostringstream oss;
+    auto sep = [&]() { if (oss.tellp() > 0) oss << ", "; };
+    if (l.productions) { sep(); oss << "produções " << l.productions; }
+    if (l.symbols) { sep(); oss << "símbolos " << l.symbols; }
+    if (l.memory) { sep(); oss << "memória " << format_bytes(l.memory); }
+    if (l.seconds > 0) { sep(); oss << "tempo " << l.seconds << " s"; }
+    return oss.str();
+}
+}
+
+BudgetExceeded::BudgetExceeded(const string &pass, const string &resource, bool global, double limit, double used)
+    : runtime_error(message(pass, resource, global, limit, used)), pass(pass), resource(resource), global(global),
+      limit(limit), used(used) {}
+
+string BudgetExceeded::to_json() const {
+    ostringstream oss;
+    oss << "{\"error\":\"budget_exceeded\",\"pass\":\"" << pass << "\",\"scope\":\"" << (global ? "run" : "pass")
+        << "\",\"resource\":\"" << resource << "\",\"limit\":" << amount(resource, limit, false)
+        << ",\"used\":" << amount(resource, used, false) << "}";
+    return oss.str();
+}
+
+/// @brief The limits in force, for the log.
+string Budget::describe() const {
+    string s;
+    if (global.any()) s = "execução: " + limits_to_string(global);
+    for (auto &pl : per_pass) {
+        if (!s.empty()) s += "; ";
+        s += "'" + pl.first + "': " + limits_to_string(pl.second);
+    }
+    return s;
+}
+
+/// @brief Start counting for a pass: sizes from G, the pass clock and the memory baseline.
+void Budget::begin_pass(const string &name, const Grammar &G) {
+    pass_ = name;
+    auto it = per_pass.find(name);
+    pass_limits_ = it == per_pass.end() ? Limits() : it->second;
+    active_ = global.any() || pass_limits_.any();
+    if (!active_) return;
+    auto counts = grammar_counts(G);
+    productions_.store(counts.first, memory_order_relaxed);
+    symbols_.store(counts.second, memory_order_relaxed);
+    pass_start_ = chrono::steady_clock::now();
+    live_at_start_ = alloc_stats().live;
+    check();
+}
+
+/// @brief Check the limits with the exact sizes of the grammar the pass left.
+void Budget::end_pass(const Grammar &G) {
+    if (!active_) return;
+    auto counts = grammar_counts(G);
+    productions_.store(counts.first, memory_order_relaxed);
+    symbols_.store(counts.second, memory_order_relaxed);
+    check();
+    active_ = false;
+}
+
+/// @brief Compare the counters with the limits of the pass, then of the run; throws BudgetExceeded.
+void Budget::check() const {
+    auto over = [&](const char *resource, size_t pass_limit, size_t run_limit, double pass_used, double run_used) {
+        if (pass_limit && pass_used > (double)pass_limit) throw BudgetExceeded(pass_, resource, false, (double)pass_limit, pass_used);
+        if (run_limit && run_used > (double)run_limit) throw BudgetExceeded(pass_, resource, true, (double)run_limit, run_used);
+    };
+    double prods = (double)max(0LL, productions_.load(memory_order_relaxed));
+    double syms = (double)max(0LL, symbols_.load(memory_order_relaxed));
+    over("productions", pass_limits_.productions, global.productions, prods, prods);
+    over("symbols", pass_limits_.symbols, global.symbols, syms, syms);
+    if (pass_limits_.memory || global.memory) {
+        size_t live = alloc_stats().live;
+        over("memory", pass_limits_.memory, global.memory, live > live_at_start_ ? (double)(live - live_at_start_) : 0.0,
+             (double)live);
+    }
+    if (pass_limits_.seconds > 0 || global.seconds > 0) {
+        auto now = chrono::steady_clock::now();
+        double in_pass = chrono::duration<double>(now - pass_start_).count();
+        double in_run = chrono::duration<double>(now - start_).count();
+        if (pass_limits_.seconds > 0 && in_pass > pass_limits_.seconds)
+            throw BudgetExceeded(pass_, "time", false, pass_limits_.seconds, in_pass);
+        if (global.seconds > 0 && in_run > global.seconds) throw BudgetExceeded(pass_, "time", true, global.seconds, in_run);
+    }
+}
+
+/// @brief Read one --limit option into the budget.
+/// @param spec "[pass:]resource=value,..." with resource productions, symbols, memory or time.
+/// @param budget Budget whose global or per-pass limits are set.
+void parse_limit_spec(const string &spec, Budget &budget) {
+    string body = spec;
+    Limits *target = &budget.global;
+    auto colon = spec.find(':');
+    if (colon != string::npos) {
+        string pass = to_lower_copy(trim(spec.substr(0, colon)));
+        if (!find_pass(pass)) throw runtime_error("Etapa desconhecida em --limit: '" + pass + "'");
+        target = &budget.per_pass[pass];
+        body = spec.substr(colon + 1);
+    }
+    stringstream items(body);
+    string item;
+    while (getline(items, item, ',')) {
+        item = trim(item);
+        if (item.empty()) continue;
+        auto eq = item.find('=');
+        if (eq == string::npos) throw runtime_error("Limite inválido (use recurso=valor): '" + item + "'");
+        string resource = to_lower_copy(trim(item.substr(0, eq))), value = trim(item.substr(eq + 1));
+        char *end = nullptr;
+        double v = strtod(value.c_str(), &end);
+        string unit = to_lower_copy(trim(string(end)));
+        if (end == value.c_str() || !(v > 0) || !isfinite(v)) throw runtime_error("Valor inválido em --limit: '" + item + "'");
+        if (resource == "productions" || resource == "symbols") {
+            if (!unit.empty()) throw runtime_error("Valor inválido em --limit: '" + item + "'");
+            (resource == "productions" ? target->productions : target->symbols) = (size_t)v;
+        } else if (resource == "memory") {
+            double scale = unit.empty() || unit == "b" ? 1 : unit == "k" ? 1024.0 : unit == "m" ? 1024.0 * 1024
+                         : unit == "g" ? 1024.0 * 1024 * 1024 : -1;
+            if (scale < 0) throw runtime_error("Unidade de memória inválida em --limit (use K, M ou G): '" + item + "'");
+            target->memory = (size_t)(v * scale);
+        } else if (resource == "time") {
+            if (unit == "ms") v /= 1000;
+            else if (!unit.empty() && unit != "s") throw runtime_error("Unidade de tempo inválida em --limit (use s ou ms): '" + item + "'");
+            target->seconds = v;
+        } else {
+            throw runtime_error("Recurso desconhecido em --limit (productions, symbols, memory, time): '" + resource + "'");
+        }
+    }
+}
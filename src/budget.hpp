@@ -0,0 +1,86 @@
+#ifndef BUDGET_HPP
+#define BUDGET_HPP
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "grammar.hpp"
+
+using namespace std;
+
+// What a pass (or the whole run) may use; 0 means no limit.
+struct Limits {
+    size_t productions = 0;
+    size_t symbols = 0; // symbols in all bodies
+    size_t memory = 0;  // live bytes: in total for the run, above what was live at its start for a pass
+    double seconds = 0;
+
+    bool any() const { return productions || symbols || memory || seconds > 0; }
+};
+
+// Thrown when a limit is exceeded: the pass that was running, the resource, the limit and what was measured.
+struct BudgetExceeded : runtime_error {
+    string pass, resource;
+    bool global; // limit of the whole run (--limit=...) or of the pass (--limit=pass:...)
+    double limit, used;
+
+    BudgetExceeded(const string &pass, const string &resource, bool global, double limit, double used);
+    string to_json() const; // one line, for callers that parse stderr
+};
+
+// Limits of one run, checked by the passes while they work. The hot loops report how much the grammar grew
+// (grow) or that they did a unit of work (tick); both cost an atomic add or a counter when some limit is set
+// and nothing otherwise. Every STRIDE calls per thread, and at the end of each pass with the exact sizes,
+// the counters are compared with the limits of the run and of the current pass, and BudgetExceeded is
+// thrown (from any worker: parallel_for rethrows it in the caller).
+class Budget {
+public:
+    static constexpr unsigned STRIDE = 1024;
+
+    Limits global;
+    map<string, Limits> per_pass;
+
+    Budget() : start_(chrono::steady_clock::now()) {}
+
+    bool enabled() const { return global.any() || !per_pass.empty(); }
+    // The limits of another budget (read from --limit); the clock is this budget's own.
+    void copy_limits(const Budget &from) {
+        global = from.global;
+        per_pass = from.per_pass;
+    }
+    string describe() const;
+
+    // Called by run_pipeline around each pass.
+    void begin_pass(const string &name, const Grammar &G);
+    void end_pass(const Grammar &G);
+
+    void grow(long long productions, long long symbols) {
+        if (!active_) return;
+        productions_.fetch_add(productions, memory_order_relaxed);
+        symbols_.fetch_add(symbols, memory_order_relaxed);
+        tick();
+    }
+    void tick() {
+        if (!active_) return;
+        thread_local unsigned n = 0;
+        if (++n % STRIDE == 0) check();
+    }
+    void check() const;
+
+private:
+    chrono::steady_clock::time_point start_, pass_start_;
+    string pass_;
+    Limits pass_limits_;
+    bool active_ = false;
+    size_t live_at_start_ = 0;
+    atomic<long long> productions_{0}, symbols_{0};
+};
+
+// "productions=N,symbols=N,memory=512M,time=2.5" for the whole run, or the same after "pass:" for one pass.
+// Memory takes K, M or G (powers of 1024), time s or ms (seconds by default).
+void parse_limit_spec(const string &spec, Budget &budget);
+
+#endif
@@ -0,0 +1,200 @@
+#include "codegen.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+string identifier_from_path(const string &path) {
+    size_t b = path.find_last_of("/\\");
+    string stem = path.substr(b == string::npos ? 0 : b + 1);
+    size_t e = stem.find('.');
+    if (e != string::npos && e > 0) stem.resize(e);
+    string id;
+    for (unsigned char c : stem) id += isalnum(c) ? (char)c : '_';
+    if (id.empty() || isdigit((unsigned char)id[0])) id = "g_" + id;
+    return id;
+}
+
+static string cpp_string(const string &s) {
+    ostringstream oss;
+    oss << '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') oss << '\\' << c;
+        else if (c < 32 || c >= 127) oss << "\\" << oct << setw(3) << setfill('0') << (int)c << dec;
+        else oss << c;
+    }
+    oss << '"';
+    return oss.str();
+}
+
+// "{ 0x..., 0x... }" for one bitset row of `words` words
+static string mask_row(const vector<uint64_t> &m) {
+    ostringstream oss;
+    oss << "{ ";
+    for (size_t w = 0; w < m.size(); ++w) oss << (w ? ", " : "") << "0x" << hex << m[w] << dec << "ull";
+    oss << " }";
+    return oss.str();
+}
+
+// Arrays are emitted with one extra entry (pad) so that none of them has size zero.
+template <class T, class F>
+static void emit_array(ostringstream &oss, const string &decl, const vector<T> &items, F &&item, bool pad = true) {
+    oss << "    static constexpr " << decl << " = {";
+    size_t col = 0, total = items.size() + pad;
+    for (size_t i = 0; i < total; ++i) {
+        string s = i < items.size() ? item(items[i]) : string("{}");
+        if (col + s.size() > 100) { oss << "\n       "; col = 0; }
+        oss << " " << s << (i + 1 < total ? "," : "");
+        col += s.size() + 2;
+    }
+    oss << " };\n";
+}
+
+/// @brief Emit the tables of rec and a recognizer templated on them.
+/// @param rec Recognizer built from the normalized grammar (CNF or 2NF).
+/// @param ns Namespace of the generated code.
+/// @param source Name of the grammar file, for the header comment.
+string generate_recognizer_header(const Recognizer &rec, const string &ns, const string &source) {
+    if (!rec.seeds_.empty())
+        throw runtime_error("codegen: a gramática usa super-terminais (etapa 'regular'), que não são gerados.");
+    const TerminalClasses &tc = rec.tc_;
+    size_t W = rec.words_;
+    // pairs (B, C) with the union of the closures of their heads, grouped by B; heads are kept as
+    // id lists (dense masks would take PAIRS x W words)
+    vector<uint32_t> pair_off(rec.ns_ + 1, 0), pair_right, head_off{ 0 }, heads;
+    for (size_t B = 0; B < rec.ns_; ++B) {
+        map<int, vector<uint32_t>> by_right;
+        for (auto &ca : rec.left_[B]) {
+            auto &h = by_right[ca.first];
+            for (int X : rec.up_[ca.second]) h.push_back((uint32_t)X);
+        }
+        for (auto &e : by_right) {
+            sort(e.second.begin(), e.second.end());
+            e.second.erase(unique(e.second.begin(), e.second.end()), e.second.end());
+            pair_right.push_back((uint32_t)e.first);
+            heads.insert(heads.end(), e.second.begin(), e.second.end());
+            head_off.push_back((uint32_t)heads.size());
+        }
+        pair_off[B + 1] = (uint32_t)pair_right.size();
+    }
+    vector<uint64_t> has_pairs(W, 0);
+    for (size_t B = 0; B < rec.ns_; ++B)
+        if (pair_off[B + 1] > pair_off[B]) has_pairs[B >> 6] |= 1ull << (B & 63);
+
+    vector<Symbol> names(rec.nv_);
+    for (auto &e : rec.id_) if (e.second < (int)rec.nv_) names[e.second] = e.first;
+    vector<uint32_t> order(tc.by_length.begin(), tc.by_length.end());
+    vector<vector<uint64_t>> base;
+    for (size_t c = 0; c < tc.count(); ++c)
+        base.emplace_back(rec.base_.begin() + c * W, rec.base_.begin() + (c + 1) * W);
+
+    string guard = ns;
+    for (auto &ch : guard) ch = (char)toupper((unsigned char)ch);
+    guard += "_RECOGNIZER_HPP";
+
+    ostringstream oss;
+    oss << "// Gerado por glc_norm (modo codegen) a partir de " << source << ". Não editar.\n"
+        << "// Reconhecedor CYK com células de " << W << " palavra(s) de 64 bits; " << rec.nv_ << " variáveis, "
+        << tc.count() << " classes de terminais, " << pair_right.size() << " pares (B, C).\n"
+        << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+        << "#include <array>\n#include <cctype>\n#include <cstddef>\n#include <cstdint>\n#include <string_view>\n#include <vector>\n\n"
+        << "namespace " << ns << " {\n\n"
+        << "struct Tables {\n"
+        << "    static constexpr std::size_t NV = " << rec.nv_ << ";      // variáveis: ids [0, NV)\n"
+        << "    static constexpr std::size_t NS = " << rec.ns_ << ";      // classes de terminais: ids [NV, NS)\n"
+        << "    static constexpr std::size_t W = " << W << ";       // palavras de 64 bits por célula\n"
+        << "    static constexpr std::size_t TOKENS = " << order.size() << ";\n"
+        << "    static constexpr std::size_t PAIRS = " << pair_right.size() << ";\n"
+        << "    static constexpr std::size_t HEADS = " << heads.size() << ";\n"
+        << "    static constexpr int START = " << rec.start_ << ";   // -1: sem símbolo inicial\n"
+        << "    static constexpr bool START_NULLABLE = " << (rec.start_nullable_ ? "true" : "false") << ";\n\n"
+        << "    // terminais do mais longo para o mais curto (casamento mais longo) e a classe de cada um\n";
+    emit_array(oss, "const char *token[TOKENS + 1]", order, [&](uint32_t t){ return cpp_string(tc.tokens[t]); });
+    emit_array(oss, "std::uint32_t token_class[TOKENS + 1]", order,
+               [&](uint32_t t){ return to_string(rec.nv_ + tc.class_of[t]); });
+    oss << "    // célula fechada (fecho unitário aplicado) de cada classe de terminal\n";
+    emit_array(oss, "std::uint64_t base[NS - NV + 1][W]", base, mask_row);
+    auto num = [](uint32_t x){ return to_string(x); };
+    oss << "    // pares (B, C) de B em [pair_off[B], pair_off[B + 1]); o par p tem C = pair_right[p] e as cabeças\n"
+        << "    // head[head_off[p] .. head_off[p + 1]) (fecho unitário de todo A -> B C)\n";
+    emit_array(oss, "std::uint32_t pair_off[NS + 1]", pair_off, num, false);
+    emit_array(oss, "std::uint32_t pair_right[PAIRS + 1]", pair_right, num);
+    emit_array(oss, "std::uint32_t head_off[PAIRS + 1]", head_off, num, false);
+    emit_array(oss, "std::uint32_t head[HEADS + 1]", heads, num);
+    oss << "    // símbolos que aparecem à esquerda de algum par\n"
+        << "    static constexpr std::uint64_t left_mask[W] = " << mask_row(has_pairs) << ";\n";
+    emit_array(oss, "const char *variable[NV + 1]", names, cpp_string);
+    oss << "};\n\n";
+
+    oss << R"(// Reconhecedor especializado: G fornece as tabelas (normalmente Tables); W é constante de compilação,
+// então as operações sobre células são laços de tamanho fixo que o compilador desenrola.
+template <class G = Tables>
+class Recognizer {
+public:
+    using Cell = std::array<std::uint64_t, G::W>;
+
+    // Classes dos terminais da palavra (casamento mais longo, espaços ignorados); false se algo não é terminal.
+    static bool tokenize(std::string_view word, std::vector<std::uint32_t> &symbols) {
+        symbols.clear();
+        std::size_t p = 0;
+        while (p < word.size()) {
+            if (std::isspace((unsigned char)word[p])) { ++p; continue; }
+            std::size_t t = 0;
+            for (; t < G::TOKENS; ++t) {
+                std::string_view s(G::token[t]);
+                if (word.compare(p, s.size(), s) == 0) { p += s.size(); break; }
+            }
+            if (t == G::TOKENS) return false;
+            symbols.push_back(G::token_class[t]);
+        }
+        return true;
+    }
+
+    // CYK sobre células de bits; symbols vem de tokenize.
+    static bool accepts(const std::vector<std::uint32_t> &symbols) {
+        const std::size_t n = symbols.size();
+        if constexpr (G::START < 0) return false;
+        if (n == 0) return G::START_NULLABLE;
+        std::vector<Cell> chart(n * (n + 1), Cell{});
+        auto cell = [&](std::size_t i, std::size_t len) -> Cell & { return chart[i * (n + 1) + len]; };
+        for (std::size_t i = 0; i < n; ++i) {
+            if (symbols[i] < G::NV || symbols[i] >= G::NS) return false;
+            const std::uint64_t *b = G::base[symbols[i] - G::NV];
+            for (std::size_t w = 0; w < G::W; ++w) cell(i, 1)[w] = b[w];
+        }
+        for (std::size_t len = 2; len <= n; ++len) {
+            for (std::size_t i = 0; i + len <= n; ++i) {
+                Cell &out = cell(i, len);
+                for (std::size_t k = 1; k < len; ++k) {
+                    const Cell &L = cell(i, k), &R = cell(i + k, len - k);
+                    for (std::size_t w = 0; w < G::W; ++w) {
+                        for (std::uint64_t bits = L[w] & G::left_mask[w]; bits; bits &= bits - 1) {
+                            std::size_t B = w * 64 + (std::size_t)__builtin_ctzll(bits);
+                            for (std::uint32_t p = G::pair_off[B]; p < G::pair_off[B + 1]; ++p) {
+                                std::uint32_t C = G::pair_right[p];
+                                if (!(R[C >> 6] >> (C & 63) & 1)) continue;
+                                for (std::uint32_t h = G::head_off[p]; h < G::head_off[p + 1]; ++h)
+                                    out[G::head[h] >> 6] |= 1ull << (G::head[h] & 63);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        constexpr std::size_t S = G::START < 0 ? 0 : (std::size_t)G::START;
+        return cell(0, n)[S >> 6] >> (S & 63) & 1;
+    }
+
+    static bool accepts(std::string_view word) {
+        std::vector<std::uint32_t> symbols;
+        return tokenize(word, symbols) && accepts(symbols);
+    }
+};
+
+)";
+    oss << "} // namespace " << ns << "\n\n#endif\n";
+    return oss.str();
+}
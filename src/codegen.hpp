@@ -0,0 +1,20 @@
+#ifndef CODEGEN_HPP
+#define CODEGEN_HPP
+
+#include <string>
+
+#include "recognizer.hpp"
+
+using namespace std;
+
+// Self-contained C++17 header for the grammar indexed by rec: constexpr tables (tokens, terminal
+// classes, closed base cells, pairs (B, C) -> closed head masks in CSR by B) in a struct
+// `Tables`, and `template <class G = Tables> class Recognizer` whose cell width is a compile-time
+// constant. `ns` is the namespace of the generated code, `source` only goes into the header comment.
+// Throws if rec uses super-terminals (their DFAs are not emitted).
+string generate_recognizer_header(const Recognizer &rec, const string &ns, const string &source);
+
+// Identifier made from a file name (letters, digits and '_'), usable as namespace or include guard.
+string identifier_from_path(const string &path);
+
+#endif
@@ -0,0 +1,88 @@
+#include "components.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "grammar_sets.hpp"
+
+/// @brief Dense ids, rules and components of the dependency graph, with the levels of the condensation.
+/// @param G Grammar to decompose; rules of symbols outside G.V are not looked at, and repeated bodies are kept.
+GrammarComponents decompose_grammar(const Grammar &G) {
+    GrammarComponents gc;
+    auto intern = [&](const Symbol &s) {
+        auto ins = gc.var_id.emplace(s, (uint32_t)gc.vars.size());
+        if (ins.second) gc.vars.push_back(s);
+        return ins.first->second;
+    };
+    gc.var_id.reserve(G.V.size() + G.T.size() + 1);
+    for (auto &A : G.V) intern(A);
+    size_t nv_read = gc.vars.size();
+    // one lookup per body symbol: terminals are in the same table (and win, as in Grammar::isTerminal)
+    for (auto &t : G.T) gc.var_id[t] = GrammarComponents::TERMINAL;
+    gc.var_id["&"] = GrammarComponents::TERMINAL;
+
+    // edges of v are collected while its rules are read; last_from[w] == v drops repeated ones
+    vector<uint32_t> off{ 0 }, adj, last_from(nv_read, UINT32_MAX);
+    gc.rule_off.push_back(0);
+    gc.body_off.push_back(0);
+    for (size_t v = 0; v < nv_read; ++v) {
+        auto pr = G.P.find(gc.vars[v]);
+        if (pr != G.P.end())
+            for (auto &rhs : pr->second) {
+                gc.rule_rhs.push_back(&rhs);
+                if (rhs != RHS{ "&" })
+                    for (auto &X : rhs) {
+                        uint32_t w = intern(X);
+                        gc.body.push_back(w);
+                        if (w == GrammarComponents::TERMINAL) continue;
+                        if (w >= last_from.size()) last_from.resize(w + 1, UINT32_MAX);
+                        if (last_from[w] != v) { last_from[w] = (uint32_t)v; adj.push_back(w); }
+                    }
+                gc.body_off.push_back((uint32_t)gc.body.size());
+            }
+        gc.rule_off.push_back((uint32_t)gc.rule_rhs.size());
+        off.push_back((uint32_t)adj.size());
+    }
+    size_t nv = gc.vars.size();
+    gc.rule_off.resize(nv + 1, gc.rule_off.back()); // symbols only seen in bodies have no rules
+    off.resize(nv + 1, off.back());
+
+    size_t count = strongly_connected_components(nv, off, adj, gc.comp);
+    component_members(gc.comp, count, gc.member_off, gc.members);
+
+    // sinks first, so every component it uses already has its level
+    gc.recursive.assign(count, 0);
+    vector<uint32_t> level(count, 0);
+    uint32_t top = 0;
+    for (uint32_t c = 0; c < count; ++c) {
+        if (gc.member_off[c + 1] - gc.member_off[c] > 1) gc.recursive[c] = 1;
+        for (uint32_t i = gc.member_off[c]; i < gc.member_off[c + 1]; ++i) {
+            uint32_t v = gc.members[i];
+            for (uint32_t e = off[v]; e < off[v + 1]; ++e) {
+                uint32_t d = gc.comp[adj[e]];
+                if (d == c) gc.recursive[c] = 1;
+                else level[c] = max(level[c], level[d] + 1);
+            }
+        }
+        top = max(top, level[c]);
+    }
+    gc.level_off.assign(count ? top + 2 : 1, 0);
+    for (uint32_t c = 0; c < count; ++c) ++gc.level_off[level[c] + 1];
+    for (size_t l = 0; l + 1 < gc.level_off.size(); ++l) gc.level_off[l + 1] += gc.level_off[l];
+    gc.by_level.resize(count);
+    vector<uint32_t> fill(gc.level_off.begin(), gc.level_off.end() - 1);
+    for (uint32_t c = 0; c < count; ++c) gc.by_level[fill[level[c]]++] = c;
+    return gc;
+}
+
+string components_summary(const GrammarComponents &gc) {
+    size_t recursive = 0, largest = 0;
+    for (size_t c = 0; c < gc.components(); ++c) {
+        recursive += gc.recursive[c];
+        largest = max<size_t>(largest, gc.member_off[c + 1] - gc.member_off[c]);
+    }
+    ostringstream oss;
+    oss << gc.components() << " componentes (" << recursive << " recursivas, maior: " << largest << " variáveis) em "
+        << gc.levels() << " níveis";
+    return oss.str();
+}
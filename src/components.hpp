@@ -0,0 +1,54 @@
+#ifndef COMPONENTS_HPP
+#define COMPONENTS_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "grammar.hpp"
+#include "parallel.hpp"
+
+using namespace std;
+
+// Dependency graph of a grammar over dense ids (A -> B when B occurs in a body of A), split into strongly
+// connected components. Components are numbered sinks first and grouped into levels: the level of a
+// component is one more than the highest level among the components it uses, so the components of one
+// level are independent of each other. An analysis that only looks down the graph can then run level by
+// level, in parallel within a level, and only needs a fixpoint inside the recursive components.
+struct GrammarComponents {
+    static constexpr uint32_t TERMINAL = UINT32_MAX; // body entry that is a terminal
+
+    vector<Symbol> vars;                  // G.V in order (ids 0 .. |V| - 1), then the symbols only seen in bodies
+    unordered_map<Symbol, uint32_t> var_id; // body symbol -> id; terminals and "&" map to TERMINAL
+    vector<uint32_t> rule_off;            // rules of v: [rule_off[v], rule_off[v + 1]), in the order of G.P
+    vector<const RHS *> rule_rhs;         // body of each rule in G.P (valid while G is not changed)
+    vector<uint32_t> body_off, body;      // symbols of rule r: body[body_off[r] .. body_off[r + 1]); "&" is empty
+    vector<uint32_t> comp;                // variable -> component
+    vector<uint32_t> member_off, members; // component c: members[member_off[c] .. member_off[c + 1])
+    vector<char> recursive;               // component with a cycle (several members or a self-reference)
+    vector<uint32_t> level_off, by_level; // level l: components by_level[level_off[l] .. level_off[l + 1])
+
+    size_t components() const { return member_off.size() - 1; }
+    size_t levels() const { return level_off.size() - 1; }
+};
+
+GrammarComponents decompose_grammar(const Grammar &G);
+
+// "N componentes (R recursivas, maior: k variáveis) em L níveis".
+string components_summary(const GrammarComponents &gc);
+
+/// @brief Run fn(c, worker) for every component, level by level from the sinks. The components of a level are split
+/// among the threads when there are enough of them to pay for starting the threads.
+template <class F>
+void for_each_component(const GrammarComponents &gc, unsigned threads, F fn) {
+    const size_t MIN_PARALLEL = 64;
+    for (size_t l = 0; l < gc.levels(); ++l) {
+        size_t lo = gc.level_off[l], n = gc.level_off[l + 1] - lo;
+        parallel_for(n, n >= MIN_PARALLEL ? threads : 1, [&](size_t begin, size_t end, unsigned worker) {
+            for (size_t k = begin; k < end; ++k) fn(gc.by_level[lo + k], worker);
+        });
+    }
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "dfa.hpp"
+
+#include <algorithm>
+#include <map>
+
+#include "budget.hpp"
+
+uint32_t Nfa::label_of(const Symbol &t) {
+    auto it = label.find(t);
+    if (it != label.end()) return it->second;
+    alphabet.push_back(t);
+    return label[t] = (uint32_t)alphabet.size() - 1;
+}
+
+// ε-closure of a sorted state set, returned sorted.
+static void epsilon_closure(const Nfa &nfa, vector<uint32_t> &set, vector<char> &in) {
+    vector<uint32_t> stack(set.begin(), set.end());
+    for (uint32_t s : set) in[s] = 1;
+    while (!stack.empty()) {
+        uint32_t s = stack.back();
+        stack.pop_back();
+        for (auto &e : nfa.edges[s]) {
+            if (e.first != Nfa::EPS || in[e.second]) continue;
+            in[e.second] = 1;
+            set.push_back(e.second);
+            stack.push_back(e.second);
+        }
+    }
+    for (uint32_t s : set) in[s] = 0;
+    sort(set.begin(), set.end());
+}
+
+/// @brief Subset construction with an explicit dead state (the empty set).
+/// @param nfa Automaton to determinize.
+/// @param max_states Give up above this many DFA states.
+/// @param out Complete DFA over nfa.alphabet.
+/// @param budget Limits checked while it runs (may be null).
+/// @return False if the limit was hit.
+bool determinize(const Nfa &nfa, size_t max_states, Dfa &out, Budget *budget) {
+    size_t k = nfa.alphabet.size();
+    out = Dfa();
+    out.alphabet = nfa.alphabet;
+    for (uint32_t c = 0; c < k; ++c) out.column.emplace(out.alphabet[c], c);
+
+    map<vector<uint32_t>, uint32_t> index;
+    vector<vector<uint32_t>> sets;
+    vector<char> in(nfa.size(), 0);
+    auto intern = [&](vector<uint32_t> &s) {
+        auto it = index.find(s);
+        if (it != index.end()) return it->second;
+        uint32_t id = (uint32_t)sets.size();
+        index.emplace(s, id);
+        sets.push_back(s);
+        return id;
+    };
+    vector<uint32_t> empty;
+    out.dead = intern(empty);
+    vector<uint32_t> s0{ nfa.start };
+    epsilon_closure(nfa, s0, in);
+    out.start = intern(s0);
+
+    vector<vector<uint32_t>> moves(k);
+    for (uint32_t d = 0; d < sets.size(); ++d) {
+        if (sets.size() > max_states) return false;
+        for (auto &m : moves) m.clear();
+        for (uint32_t s : sets[d])
+            for (auto &e : nfa.edges[s])
+                if (e.first != Nfa::EPS) moves[e.first].push_back(e.second);
+        out.next.resize(sets.size() * k);
+        for (uint32_t c = 0; c < k; ++c) {
+            if (budget) budget->tick();
+            auto &m = moves[c];
+            sort(m.begin(), m.end());
+            m.erase(unique(m.begin(), m.end()), m.end());
+            epsilon_closure(nfa, m, in);
+            uint32_t target = intern(m);
+            out.next.resize(sets.size() * k);
+            out.next[d * k + c] = target;
+        }
+    }
+    out.states = sets.size();
+    out.accepting.assign(out.states, 0);
+    for (uint32_t d = 0; d < out.states; ++d)
+        for (uint32_t s : sets[d]) if (nfa.accepting[s]) { out.accepting[d] = 1; break; }
+    return true;
+}
+
+/// @brief Minimal equivalent DFA: states are split by (block, blocks of the successors) until stable.
+Dfa minimize(const Dfa &d, Budget *budget) {
+    size_t k = d.alphabet.size();
+    vector<uint32_t> block(d.states);
+    for (uint32_t s = 0; s < d.states; ++s) block[s] = d.accepting[s];
+    size_t blocks = 0;
+    while (true) {
+        map<vector<uint32_t>, uint32_t> split;
+        vector<uint32_t> next(d.states), sig(k + 1);
+        for (uint32_t s = 0; s < d.states; ++s) {
+            if (budget) budget->tick();
+            sig[0] = block[s];
+            for (uint32_t c = 0; c < k; ++c) sig[c + 1] = block[d.step(s, c)];
+            next[s] = split.emplace(sig, (uint32_t)split.size()).first->second;
+        }
+        block.swap(next);
+        if (split.size() == blocks) break;
+        blocks = split.size();
+    }
+    Dfa m;
+    m.alphabet = d.alphabet;
+    m.column = d.column;
+    m.states = blocks;
+    m.start = block[d.start];
+    m.dead = block[d.dead];
+    m.next.assign(blocks * k, 0);
+    m.accepting.assign(blocks, 0);
+    for (uint32_t s = 0; s < d.states; ++s) {
+        m.accepting[block[s]] = d.accepting[s];
+        for (uint32_t c = 0; c < k; ++c) m.next[block[s] * k + c] = block[d.step(s, c)];
+    }
+    return m;
+}
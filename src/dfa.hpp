@@ -0,0 +1,56 @@
+#ifndef DFA_HPP
+#define DFA_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "grammar.hpp"
+
+using namespace std;
+
+class Budget;
+
+// Automaton with ε moves over terminal symbols; labels index `alphabet`.
+struct Nfa {
+    static const uint32_t EPS = UINT32_MAX;
+
+    uint32_t start = 0;
+    vector<char> accepting;
+    vector<vector<pair<uint32_t, uint32_t>>> edges; // per state: (label, target)
+    vector<Symbol> alphabet;
+    unordered_map<Symbol, uint32_t> label;
+
+    uint32_t add_state() { edges.emplace_back(); accepting.push_back(0); return (uint32_t)edges.size() - 1; }
+    void add_edge(uint32_t from, uint32_t lab, uint32_t to) { edges[from].emplace_back(lab, to); }
+    uint32_t label_of(const Symbol &t);
+    size_t size() const { return edges.size(); }
+};
+
+// Complete DFA with a dense transition table (one row per state, one column per alphabet symbol).
+// Symbols outside the alphabet lead to `dead`, which loops on itself and never accepts.
+struct Dfa {
+    vector<Symbol> alphabet;
+    unordered_map<Symbol, uint32_t> column;
+    size_t states = 0;
+    uint32_t start = 0, dead = 0;
+    vector<uint32_t> next;    // states * alphabet.size()
+    vector<char> accepting;
+
+    uint32_t step(uint32_t s, uint32_t col) const { return next[s * alphabet.size() + col]; }
+};
+
+// Subset construction; false if more than max_states DFA states would be needed. Each transition computed
+// is a unit of work for the budget, as is each state of each refinement round in minimize.
+bool determinize(const Nfa &nfa, size_t max_states, Dfa &out, Budget *budget = nullptr);
+// Merge equivalent states (Moore partition refinement).
+Dfa minimize(const Dfa &d, Budget *budget = nullptr);
+
+// A variable whose language is regular, matched as one terminal `name` by `dfa`.
+struct SuperTerminal {
+    Symbol name, variable;
+    Dfa dfa;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "enumerator.hpp"
+
+#include <algorithm>
+
+/// @param G Grammar whose bodies have at most two symbols ('&' and empty bodies are ε).
+/// @param min_length Shortest length enumerated.
+/// @param max_length Longest length enumerated.
+LanguageEnumerator::LanguageEnumerator(const Grammar &G, size_t min_length, size_t max_length)
+    : chart_(G, max_length), tc_(chart_.classes()), max_(max_length), n_(min_length) {}
+
+/// @brief Is the prefix the start of some word with exactly `remaining` more symbols?
+bool LanguageEnumerator::viable(size_t remaining) {
+    ++tested_;
+    chart_.compute_tails(remaining);
+    return chart_.completes(remaining);
+}
+
+void LanguageEnumerator::pop() {
+    prefix_.pop_back();
+    chart_.pop();
+}
+
+// Resets the walk for words of length n_; false if there are none.
+bool LanguageEnumerator::start_length() {
+    while (!prefix_.empty()) pop();
+    next_token_.assign(n_ + 1, 0);
+    class_viable_.assign(n_ + 1, vector<int8_t>(tc_.count(), -1));
+    return viable(n_);
+}
+
+bool LanguageEnumerator::next(string &word) {
+    vector<Symbol> tokens;
+    if (!next(tokens)) return false;
+    word.clear();
+    for (auto &t : tokens) word += t;
+    return true;
+}
+
+/// @brief Depth-first walk over the viable prefixes of the current length, resumed where the last call
+/// stopped; moves on to the next length when the tree is exhausted.
+bool LanguageEnumerator::next(vector<Symbol> &word) {
+    if (!begun_) {
+        begun_ = true;
+        active_ = n_ <= max_ && start_length();
+    }
+    while (n_ <= max_) {
+        if (active_) {
+            size_t d = prefix_.size();
+            if (d == n_) {
+                word.clear();
+                for (uint32_t t : prefix_) word.push_back(tc_.tokens[t]);
+                if (d == 0) active_ = false;
+                else pop();
+                return true;
+            }
+            bool descended = false;
+            while (next_token_[d] < tc_.tokens.size()) {
+                uint32_t t = next_token_[d]++;
+                int8_t &v = class_viable_[d][tc_.class_of[t]];
+                if (v == 0) continue;
+                prefix_.push_back(t);
+                chart_.push(tc_.class_of[t]);
+                if (v < 0) v = viable(n_ - d - 1);
+                if (v) {
+                    next_token_[d + 1] = 0;
+                    fill(class_viable_[d + 1].begin(), class_viable_[d + 1].end(), -1);
+                    descended = true;
+                    break;
+                }
+                pop();
+            }
+            if (descended) continue;
+            if (d > 0) { pop(); continue; }
+        }
+        // every word of this length is out: next length
+        if (++n_ > max_) break;
+        active_ = start_length();
+    }
+    return false;
+}
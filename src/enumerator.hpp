@@ -0,0 +1,43 @@
+#ifndef ENUMERATOR_HPP
+#define ENUMERATOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "grammar.hpp"
+#include "prefix_chart.hpp"
+
+using namespace std;
+
+// Pull iterator over the words of a grammar in binary normal form (CNF included) in
+// length-lexicographic order (by length, then by the sorted order of the terminals), each word exactly
+// once. It walks the tree of prefixes depth first and only descends into a prefix w when some word of
+// the current length starts with w (PrefixChart). Terminals of one class lead to the same answer, so
+// the test runs once per class and position. Memory is O(n^2) cells for length n.
+class LanguageEnumerator {
+public:
+    LanguageEnumerator(const Grammar &G, size_t min_length, size_t max_length);
+
+    // Next word (terminals concatenated); false once every length up to max_length is done.
+    bool next(string &word);
+    // Same, as the sequence of its terminals.
+    bool next(vector<Symbol> &word);
+    size_t length() const { return n_; }       // length of the words being produced
+    size_t prefixes_tested() const { return tested_; }
+
+private:
+    PrefixChart chart_;
+    const TerminalClasses &tc_;
+    size_t max_ = 0, n_ = 0, tested_ = 0;
+    bool begun_ = false, active_ = false;     // active_: the current length still has words to give
+    vector<uint32_t> prefix_;                 // token ids
+    vector<uint32_t> next_token_;             // per depth: next token id to try
+    vector<vector<int8_t>> class_viable_;     // per depth and class: -1 unknown, 0/1
+
+    bool viable(size_t remaining);
+    void pop();
+    bool start_length();
+};
+
+#endif
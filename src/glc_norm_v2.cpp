@@ -1,425 +1,627 @@
 // glc_norm.cpp
-// Compilar: g++ -std=c++17 -O2 glc_norm.cpp -o glc_norm
-// Uso: ./glc_norm gramatica.txt [cnf|gnf] log.txt
+// Compilar: g++ -std=c++17 -O2 src/*.cpp -o glc_norm
+// Uso: ./glc_norm gramatica.txt [cnf|gnf|2nf|scaling|first|ll1|codegen|sample|enum|verify|ambiguity|parse|incremental] log.txt [--passes=eps,unit,useless,term,bin]
+//      [--threads=N] [--words=palavras.txt] [--k=N] [--header=reconhecedor.hpp]
+//      [--count=N] [--length=A..B] [--seed=S] [--samples=palavras.txt] [--delta=d1.txt,d2.txt]
+//      [--limit=[etapa:]productions=N,symbols=N,memory=512M,time=10s] [--output=gramatica.txt|.jsonl] [--format=txt|jsonl]
 
 #include <bits/stdc++.h>
 #include "utility.hpp"
 #include "grammar.hpp"
 #include "io_handling.hpp"
+#include "pass_manager.hpp"
+#include "passes.hpp"
+#include "recognizer.hpp"
+#include "grammar_sets.hpp"
+#include "ll1.hpp"
+#include "codegen.hpp"
+#include "sampler.hpp"
+#include "enumerator.hpp"
+#include "verify.hpp"
+#include "ambiguity.hpp"
+#include "pcfg.hpp"
+#include "incremental.hpp"
 
 using namespace std;
 
 
-// Compute nullable set
-static set<Symbol> compute_nullable(const Grammar &G) {
-    set<Symbol> nullable;
-    bool changed=true;
-    while (changed) {
-        changed=false;
-        for (auto &A : G.V) {
-            if (nullable.count(A)) continue;
-            if (!G.P.count(A)) continue;
-            for (auto &rhs : G.P.at(A)) /*precisa de at() pq é const*/ {
-                if (rhs == RHS{"&"}) { nullable.insert(A); changed=true; break; }
-                bool allnull=true;
-                for (auto &X : rhs) {
-                    if (G.isTerminal(X) || !nullable.count(X)) { allnull=false; break; }
-                }
-                if (allnull) { nullable.insert(A); changed=true; break; }
-            }
-        }
-    }
-    return nullable;
+// Convert to CNF
+static void to_cnf(Grammar &G, PassContext &ctx, const vector<const Pass*> &pipeline) {
+    ctx.log.snapshot("Gramática original", G);
+    run_pipeline(G, pipeline, ctx);
+    ctx.log.info("CNF: etapas concluídas.");
+    ctx.log.snapshot("Gramática em (aproximação de) CNF", G);
 }
 
-// Remove epsilon-productions (fixed, safe). Preserves language; introduces new start S0 if original start nullable.
-static void remove_epsilon(Grammar &G, Logger &log) {
-    log.info("Remoção de regras-ε: início.");
-    auto nullable = compute_nullable(G);
-    log.info("Variáveis nulas (nullable):");
-    for (auto &x : nullable) log.info("  " + x);
-
-    bool start_nullable = nullable.count(G.S);
-    Symbol originalStart = G.S;
-    if (start_nullable) {
-        // create new start symbol S0 not colliding
-        Symbol S0;
-        int k = 0;
-        do { S0 = originalStart + "_S0_" + to_string(++k); } while (G.V.count(S0));
-        G.V.insert(S0);
-        // add S0 -> originalStart and S0 -> &
-        G.P[S0].push_back(RHS{ originalStart });
-        G.P[S0].push_back(RHS{"&"});
-        G.S = S0;
-        log.info("Start era nullable: criado novo start '" + S0 + "' com " + S0 + "->" + originalStart + " e " + S0 + "->&");
-    }
-
-    // Make a copy of productions to iterate safely
-    Productions oldP = G.P;
-    Productions newP;
+// Minimal practical GNF attempt (kept simple)
+static void to_gnf(Grammar &G, PassContext &ctx, const vector<const Pass*> &pipeline) {
+    ctx.log.snapshot("Gramática original", G);
+    run_pipeline(G, pipeline, ctx);
+    ctx.log.info("GNF (tentativa): etapas concluídas.");
+}
 
-    // For each production A -> X1 X2 ... Xn (non-empty or empty)
-    for (auto &A : G.V) {
-        set<vector<Symbol>> accum;
-        // ensure we process original productions only (if A had none, skip)
-        if (!oldP.count(A)) continue;
-        for (auto &rhs : oldP[A]) {
-            if (rhs.empty()) {
-                // explicit epsilon: we'll drop it unless it's for the current start symbol G.S (created above)
-                continue;
-            }
-            // find positions that are nullable
-            vector<int> nullablePos;
-            for (size_t i=0;i<rhs.size();++i) {
-                if (!G.isTerminal(rhs[i]) && nullable.count(rhs[i])) nullablePos.push_back((int)i);
-            }
-            // enumerate subsets of nullable positions
-            int m = (int)nullablePos.size();
-            int combos = 1 << m;
-            for (int mask = 0; mask < combos; ++mask) {
-                vector<Symbol> newrhs;
-                for (size_t i = 0; i < rhs.size(); ++i) {
-                    bool remove = false;
-                    for (int j = 0; j < m; ++j) if ((mask>>j)&1) if ((int)i == nullablePos[j]) { remove = true; break; }
-                    if (!remove) newrhs.push_back(rhs[i]);
-                }
-                // If newrhs becomes [A] (single symbol same as LHS), skip to avoid self unit-production A->A
-                if (newrhs.size()==1 && newrhs[0] == A) continue;
-                accum.insert(newrhs);
-            }
-        }
-        // Copy accum into newP
-        for (auto &v : accum) {
-            newP[A].push_back(v);
-        }
-    }
+// Binary normal form: at most two symbols per body, ε and unit productions kept
+static void to_2nf(Grammar &G, PassContext &ctx, const vector<const Pass*> &pipeline) {
+    ctx.log.snapshot("Gramática original", G);
+    run_pipeline(G, pipeline, ctx);
+    ctx.log.info("2NF: etapas concluídas.");
+    ctx.log.snapshot("Gramática em 2NF", G);
+}
 
-    // Remove any explicit epsilon productions except the newly created start (if any)
-    // (Note: if we created S0 it already has an epsilon production in G.P[S0] from above)
-    // Overwrite G.P with newP for processed variables; keep productions for possible new start
-    for (auto &A : G.V) {
-        G.P[A].clear();
-    }
-    for (auto &pr : newP) {
-        for (auto &rhs : pr.second) G.P[pr.first].push_back(rhs);
-    }
-    // ensure if we created S0, keep its epsilon (it is already registered)
-    // if original grammar didn't have start nullable, we must ensure no variable has epsilon production
-    // Remove empty RHS entries (epsilon) that may accidentally remain (shouldn't, but be safe)
-    for (auto &A : G.V) {
-        auto &vec = G.P[A];
-        vec.erase(remove_if(vec.begin(), vec.end(), [](const RHS &r){ return r.empty(); }), vec.end());
+// Checks every line of wordsf with rec (Recognizer or LL1Parser).
+template <class R>
+static void check_words(const R &rec, const string &wordsf, Logger &log) {
+    ifstream in(wordsf);
+    if (!in) throw runtime_error("Não foi possível abrir " + wordsf);
+    log.info("Reconhecimento (" + to_string(rec.variable_count()) + " variáveis, " + to_string(rec.classes().count())
+             + " classes de terminais para " + to_string(rec.classes().tokens.size()) + " terminais):");
+    string line;
+    vector<uint32_t> tokens;
+    size_t accepted = 0, total = 0;
+    while (getline(in, line)) {
+        line = trim(line);
+        if (line == "&") line.clear(); // palavra vazia
+        bool ok = rec.tokenize(line, tokens) && rec.accepts(tokens);
+        accepted += ok;
+        ++total;
+        string msg = "  " + (line.empty() ? string("&") : line) + ": " + (ok ? "aceita" : "rejeitada");
+        cout << msg << "\n";
+        log.info(msg);
     }
+    log.info(to_string(accepted) + " de " + to_string(total) + " palavras aceitas.");
+}
 
-    log.info("Remoção de regras-ε: finalizada.");
-    log.snapshot("Após remoção de ε-productions", G);
+// Specialized recognizer of the normalized grammar, written as a self-contained header.
+static void write_header(const Grammar &G, PassContext &ctx, const string &infile, const string &headerf) {
+    Recognizer rec(G, ctx.super_terminals);
+    string code = generate_recognizer_header(rec, identifier_from_path(headerf), infile);
+    ofstream out(headerf);
+    if (!out) throw runtime_error("Não foi possível escrever " + headerf);
+    out << code;
+    string msg = "Reconhecedor especializado gravado em " + headerf + " (namespace " + identifier_from_path(headerf)
+                 + ", " + to_string(code.size()) + " bytes).";
+    cout << msg << "\n";
+    ctx.log.info(msg);
 }
 
-// Remove unit-productions A -> B (single nonterminal)
-static void remove_unit_productions(Grammar &G, Logger &log) {
-    log.info("Remoção de unit-productions: início.");
-    // compute unit closures
-    map<Symbol, set<Symbol>> closure;
-    for (auto &A : G.V) {
-        closure[A].insert(A);
-        bool changed = true;
-        while (changed) {
-            changed = false;
-            for (auto &B : vector<Symbol>(closure[A].begin(), closure[A].end())) {
-                if (!G.P.count(B)) continue;
-                for (auto &rhs : G.P[B]) {
-                    if (rhs.size() == 1 && !G.isTerminal(rhs[0])) {
-                        if (!closure[A].count(rhs[0])) { closure[A].insert(rhs[0]); changed = true; }
-                    }
-                }
-            }
-        }
+// Count tables of the CNF grammar, then `count` uniform sentences with lengths in [min_len, max_len]
+// (to samplesf, or to stdout when it is empty).
+static void run_sampler(const Grammar &G, size_t count, size_t min_len, size_t max_len, uint64_t seed,
+                        unsigned threads, const string &samplesf, Logger &log) {
+    if (min_len > max_len) throw runtime_error("--length: mínimo maior que o máximo.");
+    auto t0 = chrono::steady_clock::now();
+    Sampler sampler(G, max_len, threads);
+    auto t1 = chrono::steady_clock::now();
+    ostringstream oss;
+    oss << "Tabelas de contagem até o comprimento " << max_len << ": " << sampler.table_entries() << " escolhas, "
+        << fixed << setprecision(2) << chrono::duration<double, milli>(t1 - t0).count() << " ms.\n";
+    for (size_t n = min_len; n <= max_len; ++n)
+        oss << "  comprimento " << n << ": " << sampler.derivations(n).to_string() << " derivação(ões)\n";
+    log.info(oss.str());
+
+    ofstream file;
+    if (!samplesf.empty()) {
+        file.open(samplesf);
+        if (!file) throw runtime_error("Não foi possível escrever " + samplesf);
     }
-    Productions newP;
-    for (auto &A : G.V) {
-        set<vector<Symbol>> acc;
-        for (auto &B : closure[A]) {
-            if (!G.P.count(B)) continue;
-            for (auto &rhs : G.P[B]) {
-                if (rhs.size() == 1 && !G.isTerminal(rhs[0])) continue;
-                acc.insert(rhs);
-            }
-        }
-        for (auto &rhs : acc) newP[A].push_back(rhs);
+    ostream &out = samplesf.empty() ? cout : file;
+    SampleStats st = write_samples(sampler, count, min_len, max_len, seed, threads, out);
+    out.flush();
+    auto t2 = chrono::steady_clock::now();
+    double secs = chrono::duration<double>(t2 - t1).count();
+    size_t written = st.sentences;
+    ostringstream msg;
+    if (written == 0) msg << "Nenhuma sentença com comprimento entre " << min_len << " e " << max_len << ".";
+    else msg << written << " sentença(s) em " << fixed << setprecision(3) << secs << " s ("
+             << setprecision(0) << (secs > 0 ? written / secs : 0.0) << " por segundo, " << threads << " thread(s), "
+             << st.draws << " derivação(ões) sorteadas).";
+    ostream &report = samplesf.empty() ? cerr : cout;
+    report << msg.str() << "\n";
+    log.info(msg.str());
+    if (st.ambiguous) {
+        string w;
+        for (auto &t : st.witness) w += t;
+        ostringstream warn;
+        warn << "Aviso: a gramática é ambígua nos comprimentos sorteados ('" << w << "' tem " << setprecision(0) << fixed
+             << st.witness_derivations << " derivações); " << st.ambiguous << " sorteio(s) de palavras ambíguas, "
+             << "corrigidos por rejeição.";
+        if (st.capped)
+            warn << " " << st.capped << " sentença(s) mantidas após " << Sampler::MAX_DRAWS
+                 << " rejeições seguem a distribuição das derivações, não a uniforme.";
+        report << warn.str() << "\n";
+        log.info(warn.str());
     }
-    G.P = newP;
-    log.info("Remoção de unit-productions: finalizada.");
-    log.snapshot("Após remoção de unit-productions", G);
 }
 
-// Remove useless symbols (non-generating and non-reachable)
-static void remove_useless_symbols(Grammar &G, Logger &log) {
-    log.info("Remoção de símbolos inúteis: início.");
-    // generating variables: those that derive a string of terminals
-    set<Symbol> gen;
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (auto &A : G.V) {
-            if (gen.count(A)) continue; // A já é gerador
-            if (!G.P.count(A)) continue; // A não gera nada
-            for (auto &rhs : G.P[A]) { 
-                bool ok = true;
-                for (auto &X : rhs) {
-                    if (!G.isTerminal(X) && !gen.count(X)) {
-                        ok = false;
-                        break;
-                    }
-                }
-                if (ok) { gen.insert(A); changed = true; break; }
-            }
-        }
-    }
-    log.info("Geradores:");
-    for (auto &x : gen) log.info("  " + x);
+// Compares the language of the grammar as read with the normalized one on every word up to max_len;
+// both are brought to 2NF first (the passes of '2nf' keep the language). False if they differ.
+static bool run_verify(const Grammar &original, const Grammar &normalized, size_t max_len, unsigned threads, Logger &log) {
+    Logger quiet("/dev/null");
+    quiet.enabled = false;
+    Grammar A = original, B = normalized;
+    PassContext ca(quiet), cb(quiet);
+    run_pipeline(A, parse_pipeline("2nf"), ca);
+    run_pipeline(B, parse_pipeline("2nf"), cb);
+    auto t0 = chrono::steady_clock::now();
+    EquivalenceReport r = compare_languages(A, B, max_len, threads);
+    auto t1 = chrono::steady_clock::now();
+    ostringstream oss;
+    oss << "Verificação até o comprimento " << max_len << ": " << r.prefixes << " prefixo(s) comparados em " << fixed
+        << setprecision(3) << chrono::duration<double>(t1 - t0).count() << " s (" << threads << " thread(s)).\n";
+    if (r.found)
+        oss << "DIFERENÇA: '" << (r.counterexample.empty() ? "&" : r.counterexample) << "' é aceita só pela gramática "
+            << (r.accepted_by_first ? "original" : "normalizada") << " (contraexemplo mais curto).\n";
+    else
+        oss << "As linguagens coincidem em todas as palavras de comprimento até " << max_len << ".\n";
+    cout << oss.str();
+    log.info(oss.str());
+    return !r.found;
+}
 
-    // remove productions that contain non-generating variables
-    for (auto it = G.P.begin(); it != G.P.end();) {
-        if (!gen.count(it->first)) { it = G.P.erase(it); continue; }
-        auto &vec = it->second;
-        vec.erase(remove_if(vec.begin(), vec.end(), [&](const RHS &r){
-            for (auto &X : r) if (!G.isTerminal(X) && !gen.count(X)) return true;
-            return false;
-        }), vec.end());
-        ++it;
+// Words of the CNF grammar with lengths in [min_len, max_len] in length-lexicographic order, at most
+// `limit` of them, streamed to samplesf (or stdout).
+static void run_enumerator(const Grammar &G, size_t limit, size_t min_len, size_t max_len, const string &samplesf,
+                           Logger &log) {
+    if (min_len > max_len) throw runtime_error("--length: mínimo maior que o máximo.");
+    auto t0 = chrono::steady_clock::now();
+    LanguageEnumerator en(G, min_len, max_len);
+    ofstream file;
+    if (!samplesf.empty()) {
+        file.open(samplesf);
+        if (!file) throw runtime_error("Não foi possível escrever " + samplesf);
     }
-    // keep only V that are generating
-    set<Symbol> newV;
-    for (auto &x : gen) newV.insert(x);
-    G.V = newV;    
-
-    // reachable from start
-    set<Symbol> reach;
-    reach.insert(G.S);
-    changed = true;
-
-    while (changed) {
-        changed = false;
-        for (auto &A : vector<Symbol>(reach.begin(), reach.end())) {
-            if (!G.P.count(A)) continue;
-            for (auto &rhs : G.P[A]) {
-                for (auto &X : rhs) {
-                    if (!G.isTerminal(X) && !reach.count(X)) { reach.insert(X); changed = true; }
-                }
-            }
-        }
+    ostream &out = samplesf.empty() ? cout : file;
+    string word;
+    size_t written = 0;
+    map<size_t, size_t> per_length;
+    while (written < limit && en.next(word)) {
+        out << (word.empty() ? "&" : word) << '\n';
+        ++per_length[en.length()];
+        ++written;
     }
-    log.info("Alcançáveis:");
-    for (auto &x : reach) log.info("  " + x);
+    out.flush();
+    auto t1 = chrono::steady_clock::now();
+    ostringstream oss;
+    oss << written << " palavra(s) em " << fixed << setprecision(3) << chrono::duration<double>(t1 - t0).count()
+        << " s (" << en.prefixes_tested() << " prefixos testados).";
+    for (auto &e : per_length) log.info("  comprimento " + to_string(e.first) + ": " + to_string(e.second) + " palavra(s)");
+    (samplesf.empty() ? cerr : cout) << oss.str() << "\n";
+    log.info(oss.str());
+}
 
-    // intersection
-    set<Symbol> finalV;
-    for (auto &x : G.V) if (reach.count(x)) finalV.insert(x);
-    G.V = finalV;
-    // remove productions with LHS not in V
-    for (auto it = G.P.begin(); it != G.P.end();) {
-        if (!G.V.count(it->first)) it = G.P.erase(it);
-        else ++it;
+// Bounded ambiguity check of the CNF grammar: every variable with two derivations of some word of
+// length up to max_len, with its shortest witness. Variables in the log, summary on stdout.
+static void run_ambiguity(const Grammar &G, size_t max_len, unsigned threads, Logger &log) {
+    auto t0 = chrono::steady_clock::now();
+    AmbiguityReport r = find_ambiguities(G, max_len, threads);
+    auto t1 = chrono::steady_clock::now();
+    auto show = [](const vector<Symbol> &w) {
+        string s;
+        for (auto &t : w) s += t;
+        return s;
+    };
+    ostringstream oss;
+    oss << "Ambiguidade até o comprimento " << max_len << ": " << r.words_checked << " palavra(s) analisadas em "
+        << fixed << setprecision(3) << chrono::duration<double>(t1 - t0).count() << " s (" << threads
+        << " thread(s)).\n";
+    if (r.witness.empty())
+        oss << "Nenhuma variável ambígua encontrada (o que não prova que a gramática seja não ambígua).\n";
+    else {
+        oss << r.witness.size() << " de " << G.V.size() << " variável(is) ambígua(s).\n";
+        auto s = r.witness.find(G.S);
+        if (s != r.witness.end())
+            oss << "A GRAMÁTICA É AMBÍGUA: '" << show(s->second) << "' tem duas derivações a partir de " << G.S << ".\n";
+        else
+            oss << "O símbolo inicial " << G.S << " não mostrou ambiguidade até esse comprimento.\n";
     }
-
-    log.info("Remoção de símbolos inúteis: finalizada.");
-    log.snapshot("Após remoção de símbolos inúteis", G);
+    cout << oss.str();
+    log.info(oss.str());
+    for (auto &e : r.witness)
+        log.info("  " + e.first + ": '" + show(e.second) + "' (" + to_string(e.second.size()) + " símbolo(s))");
 }
 
-// Replace terminals in RHS length >=2 with fresh variables
-static void replace_terminals_in_long_productions(Grammar &G, Logger &log) {
-    log.info("Substituição de terminais em produções longas: início.");
-    map<Symbol, Symbol> termVar;
-    int cnt = 0;
-    // collect productions to modify
-    Productions newP = G.P;
-    for (auto &A : vector<Symbol>(G.V.begin(), G.V.end())) {
-        if (!G.P.count(A)) continue;
-        for (auto &rhs : G.P[A]) {
-            if (rhs.size() >= 2) {
-                for (auto &X : rhs) {
-                    if (G.isTerminal(X)) {
-                        if (!termVar.count(X)) {
-                            Symbol Vn;
-                            do { Vn = "T_" + to_string(++cnt); } while (G.V.count(Vn));
-                            G.V.insert(Vn);
-                            termVar[X] = Vn;
-                            newP[Vn].push_back(RHS{X});
-                        }
-                    }
-                }
-            }
-        }
+// Probabilistic parse of every sentence of wordsf with the CNF grammar (rule probabilities from [p], or
+// uniform): log-probability (inside) and best derivation (Viterbi) per sentence, and the expected uses of
+// every rule over the file (inside-outside) in the log. Sentences are split among the threads.
+static void run_parse(const Grammar &G, const string &wordsf, unsigned threads, Logger &log) {
+    if (wordsf.empty()) throw runtime_error("parse: informe as sentenças com --words=arquivo.");
+    ifstream in(wordsf);
+    if (!in) throw runtime_error("Não foi possível abrir " + wordsf);
+    PcfgParser parser(G);
+    vector<string> lines;
+    string line;
+    while (getline(in, line)) {
+        line = trim(line);
+        if (line == "&") line.clear(); // palavra vazia
+        lines.push_back(line);
     }
-    // apply replacements
-    for (auto &A : vector<Symbol>(G.V.begin(), G.V.end())) {
-        for (auto &rhs : newP[A]) {
-            if (rhs.size() >= 2) {
-                for (auto &X : rhs) if (G.isTerminal(X)) X = termVar[X];
-            }
+    vector<double> counts;
+    auto t0 = chrono::steady_clock::now();
+    vector<PcfgParse> results = parse_sentences(parser, lines, threads, &counts);
+    auto t1 = chrono::steady_clock::now();
+
+    size_t parsed = 0, total_tokens = 0;
+    for (size_t k = 0; k < lines.size(); ++k) {
+        total_tokens += results[k].length;
+        ostringstream msg;
+        msg << "  " << (lines[k].empty() ? "&" : lines[k]) << ": ";
+        if (results[k].parsed) {
+            ++parsed;
+            msg << "log P = " << setprecision(6) << results[k].log_prob << ", melhor derivação " << results[k].best_log_prob
+                << " " << results[k].tree;
+        } else {
+            msg << "rejeitada";
         }
+        cout << msg.str() << "\n";
+        log.info(msg.str());
     }
-    G.P = newP;
-    log.info("Substituição de terminais em produções longas: finalizada.");
-    log.snapshot("Após substituição de terminais em produções longas", G);
+    double secs = chrono::duration<double>(t1 - t0).count();
+    ostringstream oss;
+    oss << parsed << " de " << lines.size() << " sentença(s) analisadas (" << total_tokens << " tokens) em " << fixed
+        << setprecision(3) << secs << " s: " << setprecision(1) << (secs > 0 ? lines.size() / secs : 0.0)
+        << " sentenças/s (" << threads << " thread(s), " << parser.variable_count() << " variáveis, "
+        << parser.rule_count() << " regras).";
+    cout << oss.str() << "\n";
+    log.info(oss.str());
+    log.info("Usos esperados das regras (inside-outside):");
+    for (size_t r = 0; r < counts.size(); ++r)
+        if (counts[r] > 0) log.info("  " + parser.rule_name(r) + ": " + to_string(counts[r]));
 }
 
-// Binarize RHS length > 2
-static void binarize(Grammar &G, Logger &log) {
-    log.info("Binarização: início.");
-    Productions newP;
-    int cnt = 0;
-    for (auto &A : vector<Symbol>(G.V.begin(), G.V.end())) {
-        if (!G.P.count(A)) continue;
-        for (auto &rhs : G.P[A]) {
-            if (rhs.size() <= 2) {
-                newP[A].push_back(rhs);
-                continue;
-            }
-            // create chain
-            // A -> X0 Y1
-            // Y1 -> X1 Y2
-            // ...
-            // Yk -> Xk-1 Xk
-            vector<Symbol> sym = rhs;
-            Symbol current = A;
-            for (size_t i = 0; i + 2 < sym.size(); ++i) {
-                Symbol Yi;
-                do { Yi = "N_" + to_string(++cnt); } while (G.V.count(Yi));
-                G.V.insert(Yi);
-                // production for current -> sym[i] Yi
-                newP[current].push_back(RHS{ sym[i], Yi });
-                current = Yi;
-            }
-            // last two
-            size_t m = sym.size();
-            newP[current].push_back(RHS{ sym[m-2], sym[m-1] });
+// Normalizes G to CNF once, then applies every delta file in turn, timing the incremental update against a
+// full run over the edited grammar and checking that both give the same grammar. Returns false on a difference;
+// G ends as the last normalized grammar.
+static bool run_incremental(Grammar &G, const string &deltas, unsigned threads, const Budget &limits, Logger &log) {
+    if (deltas.empty()) throw runtime_error("incremental: informe as alterações com --delta=arquivo[,arquivo...].");
+    auto ms_since = [](chrono::steady_clock::time_point t0) {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    };
+    auto t0 = chrono::steady_clock::now();
+    IncrementalNormalizer inc(G, threads, limits);
+    ostringstream head;
+    head << "Normalização inicial: " << fixed << setprecision(2) << ms_since(t0) << " ms.\n";
+    cout << head.str();
+    log.info(head.str());
+
+    bool identical = true;
+    stringstream files(deltas);
+    string file;
+    while (getline(files, file, ',')) {
+        if (file.empty()) continue;
+        GrammarDelta delta = read_grammar_delta(file, inc.input());
+        auto ta = chrono::steady_clock::now();
+        IncrementalStats st = inc.apply(delta);
+        double apply_ms = ms_since(ta);
+        auto tb = chrono::steady_clock::now();
+        Grammar updated = inc.result();
+        double result_ms = ms_since(tb);
+
+        Grammar full = inc.input();
+        Logger quiet("/dev/null");
+        quiet.enabled = false;
+        PassContext ctx(quiet);
+        ctx.threads = threads;
+        ctx.budget.copy_limits(limits);
+        auto tc = chrono::steady_clock::now();
+        run_pipeline(full, parse_pipeline("cnf"), ctx);
+        double full_ms = ms_since(tc);
+        bool same = full.V == updated.V && full.T == updated.T && full.S == updated.S && full.P == updated.P;
+        identical = identical && same;
+
+        ostringstream oss;
+        oss << file << ": +" << delta.added.size() << " -" << delta.removed.size() << " produção(ões), "
+            << st.changed << " variável(is) alterada(s). Incremental " << fixed << setprecision(2) << apply_ms
+            << " ms + " << result_ms << " ms (term, bin); completa " << full_ms << " ms. "
+            << (same ? "Gramática idêntica." : "ERRO: a gramática difere da normalização completa!") << "\n";
+        cout << oss.str();
+        log.info(oss.str());
+        if (st.rebuilt) {
+            log.info("  decisão global alterada (símbolo inicial ou etapa pulada): refeito a partir da entrada.");
+        } else {
+            log.info("  nullable: " + to_string(st.nullable) + " revista(s), " + to_string(st.nullable_changed) + " alterada(s)");
+            log.info("  sem ε: " + to_string(st.eps) + " revista(s), " + to_string(st.eps_changed) + " alterada(s)");
+            log.info("  fechos unitários: " + to_string(st.closure) + " revisto(s), " + to_string(st.closure_changed) +
+                     " alterado(s); " + to_string(st.unit_changed) + " variável(is) com produções novas");
+            log.info("  geradoras: " + to_string(st.generating) + " revista(s), " + to_string(st.generating_changed) + " alterada(s)");
+            log.info("  alcançáveis: " + to_string(st.reachable) + " revista(s), " + to_string(st.reachable_changed) + " alterada(s)");
+            log.info("  gramática sem inúteis: " + to_string(st.useful_changed) + " variável(is) alterada(s)");
         }
+        G = std::move(updated);
     }
-    // also preserve productions for variables that didn't have entries in newP (ensure presence)
-    for (auto &v : G.V) {
-        if (newP.count(v) == 0) {
-            // keep existing if any
-            if (G.P.count(v)) {
-                for (auto &rhs : G.P[v]) if (rhs.size() <= 2) newP[v].push_back(rhs);
-            }
-        }
-    }
-    G.P = newP;
-    log.info("Binarização: finalizada.");
-    log.snapshot("Após binarização (CNF-ready)", G);
+    log.snapshot("Gramática após as alterações (CNF)", G);
+    return identical;
 }
 
-// Convert to CNF
-static void to_cnf(Grammar &G, Logger &log) {
-    log.snapshot("Gramática original", G);
-    remove_epsilon(G, log);
-    remove_unit_productions(G, log);
-    remove_useless_symbols(G, log);
-    replace_terminals_in_long_productions(G, log);
-    binarize(G, log);
-    log.info("CNF: etapas concluídas.");
-    log.snapshot("Gramática em (aproximação de) CNF", G);
+// FIRST/FOLLOW/FIRST_k report: summary on stdout, one line per variable in the log.
+static void report_sets(const Grammar &G, unsigned k, Logger &log) {
+    auto t0 = chrono::steady_clock::now();
+    GrammarSets gs = compute_grammar_sets(G, k);
+    auto t1 = chrono::steady_clock::now();
+    ostringstream oss;
+    oss << grammar_sets_summary(gs) << "Conjuntos calculados em " << fixed << setprecision(2)
+        << chrono::duration<double, milli>(t1 - t0).count() << " ms.\n";
+    cout << oss.str();
+    log.info(oss.str());
+    log.info(grammar_sets_report(gs));
 }
 
-// Minimal practical GNF attempt (kept simple)
-static void to_gnf(Grammar &G, Logger &log) {
-    log.snapshot("Gramática original", G);
-    remove_epsilon(G, log);
-    remove_unit_productions(G, log);
-    remove_useless_symbols(G, log);
-    replace_terminals_in_long_productions(G, log);
-
-    log.info("Início do processo prático para GNF (Greibach Normal Form - Forma Normal de Greibach).\n");
-
-    std::vector<std::string> vars;
-    vars.reserve(G.P.size());
-    for (auto &p : G.P) vars.push_back(p.first);
+static string body_to_string(const RHS &body) {
+    if (body.empty()) return "&";
+    string out;
+    for (auto &X : body) out += (out.empty() ? "" : " ") + X;
+    return out;
+}
 
-    if (vars.empty()) {
-        log.info("Nenhum não-terminal encontrado. Nada a ordenar.\n");
-        return;
+// LL(1) table of G; words go to the table-driven parser, or to the chart recognizer (on a 2NF copy)
+// when the grammar has conflicts. Returns false if the grammar is not LL(1).
+static bool run_ll1(const Grammar &G, const string &wordsf, Logger &log) {
+    auto t0 = chrono::steady_clock::now();
+    LL1Parser ll1(G);
+    auto t1 = chrono::steady_clock::now();
+    ostringstream oss;
+    oss << "Tabela LL(1): " << ll1.variable_count() << " variáveis x " << ll1.column_count() << " colunas ("
+        << ll1.classes().count() << " classes de terminais + $), " << ll1.filled_entries() << " entradas, "
+        << fixed << setprecision(2) << chrono::duration<double, milli>(t1 - t0).count() << " ms.\n";
+    if (ll1.is_ll1()) {
+        oss << "A gramática é LL(1).\n";
+    } else {
+        oss << "A gramática não é LL(1): " << ll1.conflicts().size() << " conflito(s).\n";
+        size_t shown = 0;
+        for (auto &c : ll1.conflicts()) {
+            if (shown++ == 20) { oss << "  ...\n"; break; }
+            oss << "  " << c.var << ", " << c.lookahead << ": " << c.var << " -> " << body_to_string(c.first)
+                << " | " << body_to_string(c.second) << "\n";
+        }
     }
-
-    // 2. Ordenar alfabeticamente (ABCD..., ou S,A,B,C se S vem primeiro)
-    std::sort(vars.begin(), vars.end());
-
-    std::map<std::string, int> order_index;
-    int cnt = 0;
-    for(auto& v : vars) {
-        order_index[v] = cnt++;
+    cout << oss.str();
+    log.info(oss.str());
+    log.info(ll1.table_to_string());
+    if (wordsf.empty()) return ll1.is_ll1();
+    if (ll1.is_ll1()) {
+        check_words(ll1, wordsf, log);
+    } else {
+        log.info("Usando o reconhecedor geral (2NF) para as palavras.");
+        Grammar H = G;
+        Logger quiet("/dev/null");
+        quiet.enabled = false;
+        PassContext ctx(quiet);
+        run_pipeline(H, parse_pipeline("2nf"), ctx);
+        check_words(Recognizer(H), wordsf, log);
     }
+    return ll1.is_ll1();
+}
 
+// Times every pass of the pipeline with 1, 2, 4, ... up to max_threads workers through run_pipeline (the
+// analyses a pass computes are taken out of its time and summed in row "(análises)"; a pass whose no-op check
+// holds is marked as skipped) and checks that all runs produce the same grammar. The limits apply to each run.
+static bool run_scaling(const Grammar &G0, const vector<const Pass*> &pipeline, unsigned max_threads,
+                        const Budget &limits, Logger &log) {
+    vector<unsigned> counts;
+    for (unsigned t = 1; t < max_threads; t *= 2) counts.push_back(t);
+    counts.push_back(max(1u, max_threads));
+
+    vector<vector<double>> ms(pipeline.size() + 1); // one row per pass (a pass may appear twice), then the analyses
+    vector<bool> skipped(pipeline.size());
+    string reference;
+    bool identical = true;
+    for (unsigned t : counts) {
+        Grammar G = G0;
+        Logger quiet("/dev/null");
+        quiet.enabled = false;
+        PassContext ctx(quiet);
+        ctx.threads = t;
+        ctx.budget.copy_limits(limits);
+        double analyses_ms = 0;
+        size_t i = 0;
+        ctx.on_pass = [&](const PassReport &r) {
+            ms[i].push_back(r.ms - r.analyses_ms);
+            analyses_ms += r.analyses_ms;
+            if (r.status == "skipped") skipped[i] = true;
+            ++i;
+        };
+        run_pipeline(G, pipeline, ctx);
+        ms.back().push_back(analyses_ms);
+        string out = grammar_to_string(G);
+        if (reference.empty()) reference = out;
+        else if (out != reference) identical = false;
+    }
 
-    log.info("Ordem escolhida para variáveis:");
-    for (auto &v : vars) log.info("  " + v);
-    log.info("");
-    log.snapshot("Após order_variables (GNF)", G);
-
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        
-        for (auto &p : G.P) {
-            Symbol A = p.first;
-            auto &rhs_list = p.second;
-            
-            std::vector<RHS> new_list;
-            for (auto &rhs : rhs_list) {
-
-                Symbol X = rhs[0];
-                
-                
-                if(G.P.count(X) && G.P.at(X).size() == 1 && G.isTerminal(G.P.at(X)[0][0]) ) {
-                    RHS expanded = G.P.at(X)[0];
-                    expanded.insert(expanded.end(), rhs.begin() + 1, rhs.end());
-                    new_list.push_back(expanded);
-                    continue;
-                }
-
-                // se começa com variável, expandir
-                if (!G.isTerminal(X) && order_index[X] < order_index[A]) {
-                    changed = true;
-                    for (RHS &prod_of_X : G.P[X]) {
-                        RHS expanded = prod_of_X;
-                        expanded.insert(expanded.end(), rhs.begin() + 1, rhs.end());
-                        new_list.push_back(expanded);
-                    }
-                } else {
-                    new_list.push_back(rhs);
-                }
-            }
+    ostringstream oss;
+    oss << "etapa";
+    for (unsigned t : counts) oss << "\t" << t << "T(ms)";
+    oss << "\tspeedup\n";
+    for (size_t i = 0; i < ms.size(); ++i) {
+        auto &v = ms[i];
+        if (i < pipeline.size()) oss << pipeline[i]->name << (skipped[i] ? " (ignorada)" : "");
+        else oss << "(análises)";
+        for (double x : v) oss << "\t" << fixed << setprecision(2) << x;
+        oss << "\t" << setprecision(2) << (v.back() > 0 ? v.front() / v.back() : 0.0) << "x\n";
+    }
+    oss << (identical ? "Saída idêntica para todas as quantidades de threads.\n"
+                      : "ERRO: a saída difere entre quantidades de threads!\n");
+    cout << oss.str();
+    log.info(oss.str());
+    return identical;
+}
 
-            rhs_list = std::move(new_list);
-        }
+// Reports the error that stopped a mode: a BudgetExceeded also gets a JSON line on stderr and exit code 3,
+// so that a supervisor can tell an aborted run from a bad input (exit code 1).
+static int report_error(const exception &e, Logger &log) {
+    cerr << e.what() << "\n";
+    log.info(e.what());
+    log.out.close();
+    if (auto *b = dynamic_cast<const BudgetExceeded*>(&e)) {
+        cerr << b->to_json() << "\n";
+        return 3;
     }
-    log.snapshot("Após eliminação de prefixos variáveis (GNF)", G);
-    log.info("GNF (tentativa): etapas concluídas.");
+    return 1;
 }
 
 int main(int argc, char** argv) {
     if (argc < 4) {
-        cerr << "Uso: " << argv[0] << " gramatica.txt [cnf|gnf] output_log.txt\n";
+        cerr << "Uso: " << argv[0] << " gramatica.txt [cnf|gnf|2nf|scaling|first|ll1|codegen|sample|enum|verify|ambiguity|parse|incremental] output_log.txt [--passes=p1,p2,...] [--threads=N] [--words=arquivo] [--k=N] [--header=arquivo.hpp] [--count=N] [--length=A..B] [--seed=S] [--samples=arquivo] [--delta=arquivo,...] [--limit=[etapa:]recurso=valor,...] [--output=arquivo] [--format=txt|jsonl]\n";
+        cerr << "Etapas disponíveis:";
+        for (auto &p : pass_registry()) cerr << " " << p.name;
+        cerr << "\n";
         return 1;
     }
     string infile = argv[1];
     string mode = argv[2];
     string logf = argv[3];
+    string passes = (mode == "scaling" || mode == "codegen" || mode == "sample" || mode == "enum" || mode == "verify" || mode == "ambiguity" || mode == "parse") ? "cnf" : (mode == "first" || mode == "ll1" || mode == "incremental") ? "" : mode;
+    unsigned threads = 1, k = 1;
+    string wordsf, headerf = identifier_from_path(infile) + "_recognizer.hpp", samplesf, deltaf, outputf, formatn;
+    vector<string> limits;
+    size_t sample_count = SIZE_MAX, min_len = 1, max_len = 10; // count: 10 samples, or every word (enum)
+    uint64_t seed = 1;
+    for (int i = 4; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--passes=", 0) == 0) passes = arg.substr(9);
+        else if (arg.rfind("--threads=", 0) == 0) {
+            threads = (unsigned)max(1, atoi(arg.c_str() + 10));
+        } else if (arg.rfind("--words=", 0) == 0) {
+            wordsf = arg.substr(8);
+        } else if (arg.rfind("--k=", 0) == 0) {
+            k = (unsigned)max(1, atoi(arg.c_str() + 4));
+        } else if (arg.rfind("--header=", 0) == 0) {
+            headerf = arg.substr(9);
+        } else if (arg.rfind("--count=", 0) == 0) {
+            sample_count = (size_t)strtoull(arg.c_str() + 8, nullptr, 10);
+        } else if (arg.rfind("--length=", 0) == 0) {
+            string r = arg.substr(9);
+            size_t dots = r.find("..");
+            min_len = (size_t)strtoull(r.c_str(), nullptr, 10);
+            max_len = dots == string::npos ? min_len : (size_t)strtoull(r.c_str() + dots + 2, nullptr, 10);
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            seed = strtoull(arg.c_str() + 7, nullptr, 10);
+        } else if (arg.rfind("--samples=", 0) == 0) {
+            samplesf = arg.substr(10);
+        } else if (arg.rfind("--delta=", 0) == 0) {
+            deltaf = arg.substr(8);
+        } else if (arg.rfind("--limit=", 0) == 0) {
+            limits.push_back(arg.substr(8));
+        } else if (arg.rfind("--output=", 0) == 0) {
+            outputf = arg.substr(9);
+        } else if (arg.rfind("--format=", 0) == 0) {
+            formatn = arg.substr(9);
+        } else {
+            cerr << "Opção desconhecida: " << arg << "\n";
+            return 1;
+        }
+    }
+    if (mode != "cnf" && mode != "gnf" && mode != "2nf" && mode != "scaling" && mode != "first" && mode != "ll1"
+        && mode != "codegen" && mode != "sample" && mode != "enum" && mode != "verify"
+        && mode != "ambiguity" && mode != "parse" && mode != "incremental") {
+        cerr << "Modo desconhecido: use cnf, gnf, 2nf, scaling, first, ll1, codegen, sample, enum, verify, ambiguity, parse ou incremental\n";
+        return 1;
+    }
+    vector<const Pass*> pipeline;
+    Budget limits_read; // --limit, checked before the grammar is read; the run's clock starts with ctx
+    GrammarFormat format = GrammarFormat::Text;
+    try {
+        if (!passes.empty()) pipeline = parse_pipeline(passes);
+        for (auto &l : limits) parse_limit_spec(l, limits_read);
+        format = grammar_format(formatn, outputf);
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
     Grammar G;
     read_grammar(infile, G);
+    if (!G.weight.empty())
+        for (auto *p : pipeline)
+            if (!p->keeps_weights) {
+                cerr << "A gramática tem probabilidades e a etapa '" << p->name << "' não as propaga (use eps, unit, useless, term e bin).\n";
+                return 1;
+            }
     Logger logger(logf);
-    if (mode == "cnf") {
-        to_cnf(G, logger);
-        logger.info("NORMALIZACAO: CNF finalizada.");
-    } else if (mode == "gnf") {
-        to_gnf(G, logger);
-        logger.info("NORMALIZACAO: GNF (tentativa) finalizada. Revise o log.");
-    } else {
-        cerr << "Modo desconhecido: use cnf ou gnf\n";
-        return 1;
+    PassContext ctx(logger);
+    ctx.threads = threads;
+    ctx.budget.copy_limits(limits_read);
+    try {
+        if (mode == "scaling") {
+            bool ok = run_scaling(G, pipeline, threads, limits_read, logger);
+            logger.out.close();
+            return ok ? 0 : 2;
+        }
+        if (mode == "incremental") {
+            // the pipeline is always cnf: the passes it keeps up to date
+            if (!pipeline.empty()) throw runtime_error("incremental: o pipeline é sempre cnf (não use --passes).");
+            if (!run_incremental(G, deltaf, threads, limits_read, logger)) {
+                logger.out.close();
+                return 2;
+            }
+        } else if (mode == "ll1") {
+            // table of the grammar as read, or after the pipeline given with --passes
+            if (!pipeline.empty()) run_pipeline(G, pipeline, ctx);
+            if (!ctx.super_terminals.empty() && !wordsf.empty())
+                throw runtime_error("ll1: a gramática usa super-terminais (etapa 'regular'), que a tabela trata como terminais comuns.");
+            run_ll1(G, wordsf, logger);
+            wordsf.clear();
+        } else if (mode == "first") {
+            // sets of the grammar as read, or after the pipeline given with --passes
+            if (!pipeline.empty()) run_pipeline(G, pipeline, ctx);
+            report_sets(G, k, logger);
+        } else if (mode == "cnf") {
+            to_cnf(G, ctx, pipeline);
+            logger.info("NORMALIZACAO: CNF finalizada.");
+        } else if (mode == "codegen") {
+            to_cnf(G, ctx, pipeline);
+            write_header(G, ctx, infile, headerf);
+        } else if (mode == "sample") {
+            to_cnf(G, ctx, pipeline);
+            if (!ctx.super_terminals.empty())
+                throw runtime_error("sample: a gramática usa super-terminais (etapa 'regular'), cujas palavras não são contadas.");
+            run_sampler(G, sample_count == SIZE_MAX ? 10 : sample_count, min_len, max_len, seed, threads, samplesf, logger);
+        } else if (mode == "verify") {
+            Grammar original = G;
+            to_cnf(G, ctx, pipeline);
+            if (!ctx.super_terminals.empty())
+                throw runtime_error("verify: a gramática normalizada usa super-terminais (etapa 'regular'), que não são comparados.");
+            if (!run_verify(original, G, max_len, threads, logger)) {
+                logger.out.close();
+                return 2;
+            }
+        } else if (mode == "enum") {
+            to_cnf(G, ctx, pipeline);
+            if (!ctx.super_terminals.empty())
+                throw runtime_error("enum: a gramática usa super-terminais (etapa 'regular'), cujas palavras não são enumeradas.");
+            run_enumerator(G, sample_count, min_len, max_len, samplesf, logger);
+        } else if (mode == "ambiguity") {
+            to_cnf(G, ctx, pipeline);
+            if (!ctx.super_terminals.empty())
+                throw runtime_error("ambiguity: a gramática usa super-terminais (etapa 'regular'), cujas derivações não são contadas.");
+            run_ambiguity(G, max_len, threads, logger);
+        } else if (mode == "parse") {
+            to_cnf(G, ctx, pipeline);
+            if (!ctx.super_terminals.empty())
+                throw runtime_error("parse: a gramática usa super-terminais (etapa 'regular'), sem probabilidades.");
+            run_parse(G, wordsf, threads, logger);
+            wordsf.clear();
+        } else if (mode == "2nf") {
+            to_2nf(G, ctx, pipeline);
+            logger.info("NORMALIZACAO: 2NF finalizada.");
+        } else {
+            to_gnf(G, ctx, pipeline);
+            logger.info("NORMALIZACAO: GNF (tentativa) finalizada. Revise o log.");
+        }
+        if (!wordsf.empty()) {
+            check_words(Recognizer(G, ctx.super_terminals), wordsf, logger);
+        }
+        if (!outputf.empty()) {
+            if (!ctx.super_terminals.empty())
+                throw runtime_error("--output: a gramática usa super-terminais (etapa 'regular'), cujos autômatos não são gravados.");
+            size_t n = write_grammar_file(outputf, G, format);
+            logger.info("Gramática final gravada em " + outputf + " (" + to_string(n) + " produções, "
+                        + (format == GrammarFormat::JsonLines ? "jsonl" : "txt") + ").");
+        }
+    } catch (const exception &e) {
+        return report_error(e, logger);
     }
     logger.out.close();
-    cout << "Processo finalizado. Log em: " << logf << "\n";
+    // words written to stdout stay alone there, so they can be piped
+    bool words_on_stdout = (mode == "sample" || mode == "enum") && samplesf.empty();
+    (words_on_stdout ? cerr : cout) << "Processo finalizado. Log em: " << logf << "\n";
 
     return 0;
 }
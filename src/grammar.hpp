@@ -18,10 +18,19 @@ struct Grammar {
     set<Symbol> T; // terminais
     Symbol S; // start
     Productions P;
+    map<Symbol, Symbol> alias; // terminal -> terminal standing for its class (set by the 'tclass' pass)
+    map<Symbol, map<RHS, double>> weight; // A -> body -> probability (rules read with [p]); empty: unweighted
 
     bool isTerminal(const Symbol &s) const {
         return T.count(s) > 0 || s == "&";  // & representa epsilon
     }
 };
 
+// Productions added to and removed from a grammar (read_grammar_delta); symbols the grammar does not have yet
+// are listed apart.
+struct GrammarDelta {
+    vector<pair<Symbol, RHS>> added, removed;
+    set<Symbol> new_variables, new_terminals;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "grammar_sets.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+/// @brief Iterative Tarjan, so that deep recursion chains of long grammars do not overflow the stack.
+/// @param n Number of nodes.
+/// @param off CSR offsets (n + 1 entries).
+/// @param adj CSR targets.
+/// @param comp Output: component of every node, numbered in reverse topological order (sinks first).
+/// @return Number of components.
+size_t strongly_connected_components(size_t n, const vector<uint32_t> &off, const vector<uint32_t> &adj,
+                                     vector<uint32_t> &comp) {
+    const uint32_t NONE = UINT32_MAX;
+    vector<uint32_t> index(n, NONE), low(n, 0), next_edge(n, 0), stack, call;
+    vector<char> on_stack(n, 0);
+    comp.assign(n, NONE);
+    uint32_t counter = 0;
+    size_t count = 0;
+    auto visit = [&](uint32_t v) {
+        index[v] = low[v] = counter++;
+        next_edge[v] = off[v];
+        stack.push_back(v);
+        on_stack[v] = 1;
+        call.push_back(v);
+    };
+    for (uint32_t s = 0; s < n; ++s) {
+        if (index[s] != NONE) continue;
+        visit(s);
+        while (!call.empty()) {
+            uint32_t v = call.back();
+            if (next_edge[v] < off[v + 1]) {
+                uint32_t w = adj[next_edge[v]++];
+                if (index[w] == NONE) visit(w);
+                else if (on_stack[w]) low[v] = min(low[v], index[w]);
+                continue;
+            }
+            call.pop_back();
+            if (!call.empty()) low[call.back()] = min(low[call.back()], low[v]);
+            if (low[v] != index[v]) continue;
+            uint32_t w;
+            do {
+                w = stack.back();
+                stack.pop_back();
+                on_stack[w] = 0;
+                comp[w] = (uint32_t)count;
+            } while (w != v);
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Sorted, deduplicated pairs -> CSR adjacency over n nodes.
+static void build_csr(size_t n, vector<pair<uint32_t, uint32_t>> &edges, vector<uint32_t> &off, vector<uint32_t> &adj) {
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+    off.assign(n + 1, 0);
+    for (auto &e : edges) ++off[e.first + 1];
+    for (size_t i = 0; i < n; ++i) off[i + 1] += off[i];
+    adj.resize(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i) adj[i] = edges[i].second;
+}
+
+// Nodes of each component, components in the order given by comp (counting sort).
+void component_members(const vector<uint32_t> &comp, size_t count, vector<uint32_t> &off, vector<uint32_t> &members) {
+    off.assign(count + 1, 0);
+    for (uint32_t c : comp) ++off[c + 1];
+    for (size_t i = 0; i < count; ++i) off[i + 1] += off[i];
+    members.resize(comp.size());
+    vector<uint32_t> fill(off.begin(), off.end() - 1);
+    for (uint32_t v = 0; v < comp.size(); ++v) members[fill[comp[v]]++] = v;
+}
+
+/// @brief rows[v] |= rows[w] for every edge v -> w, up to the fixpoint.
+/// One sweep over the components, sinks first: members of a component end with the same row.
+static void propagate(BitRows &rows, size_t n, const vector<uint32_t> &off, const vector<uint32_t> &adj) {
+    vector<uint32_t> comp, coff, members;
+    size_t count = strongly_connected_components(n, off, adj, comp);
+    component_members(comp, count, coff, members);
+    vector<uint64_t> acc(rows.words);
+    for (uint32_t c = 0; c < count; ++c) {
+        fill(acc.begin(), acc.end(), 0);
+        for (uint32_t i = coff[c]; i < coff[c + 1]; ++i) {
+            uint32_t v = members[i];
+            const uint64_t *r = rows.row(v);
+            for (size_t w = 0; w < rows.words; ++w) acc[w] |= r[w];
+            for (uint32_t e = off[v]; e < off[v + 1]; ++e) {
+                if (comp[adj[e]] == c) continue;
+                const uint64_t *s = rows.row(adj[e]);
+                for (size_t w = 0; w < rows.words; ++w) acc[w] |= s[w];
+            }
+        }
+        for (uint32_t i = coff[c]; i < coff[c + 1]; ++i) copy(acc.begin(), acc.end(), rows.row(members[i]));
+    }
+}
+
+static const uint64_t PAYLOAD = (1ull << 60) - 1;
+static inline unsigned seq_len(uint64_t s) { return (unsigned)(s >> 60); }
+
+// First k symbols of x followed by y.
+static inline uint64_t seq_concat(uint64_t x, uint64_t y, unsigned k, unsigned bits) {
+    unsigned lx = seq_len(x), m = min(k - lx, seq_len(y));
+    uint64_t tail = m ? (y & ((1ull << (m * bits)) - 1)) : 0;
+    return (x & PAYLOAD) | (tail << (lx * bits)) | ((uint64_t)(lx + m) << 60);
+}
+
+string GrammarSets::sequence_to_string(uint64_t seq) const {
+    unsigned n = seq_len(seq);
+    if (n == 0) return "&";
+    string out;
+    for (unsigned i = 0; i < n; ++i) {
+        uint64_t t = (seq >> (i * seq_bits)) & ((1ull << seq_bits) - 1);
+        if (i) out += " ";
+        out += terms[t - 1];
+    }
+    return out;
+}
+
+/// @brief FIRST_k by fixpoint inside each component of the body-dependency graph, sinks first.
+static void compute_first_k(GrammarSets &gs, const vector<uint32_t> &head, const vector<uint32_t> &boff,
+                            const vector<uint32_t> &body) {
+    size_t nv = gs.vars.size(), nt = gs.terms.size();
+    unsigned k = gs.k, bits = 1;
+    while ((1ull << bits) <= nt) ++bits;
+    if (k > 15 || k * bits > 60)
+        throw runtime_error("FIRST_" + to_string(k) + ": k grande demais para " + to_string(nt) + " terminais.");
+    gs.seq_bits = bits;
+
+    // dependency graph: A -> every variable in a body of A; productions grouped by head
+    vector<pair<uint32_t, uint32_t>> edges;
+    vector<pair<uint32_t, uint32_t>> by_head;
+    for (uint32_t p = 0; p + 1 < boff.size(); ++p) {
+        by_head.push_back({ head[p], p });
+        for (uint32_t i = boff[p]; i < boff[p + 1]; ++i)
+            if (body[i] < nv) edges.push_back({ head[p], body[i] });
+    }
+    sort(by_head.begin(), by_head.end());
+    vector<uint32_t> off, adj, comp, coff, members;
+    build_csr(nv, edges, off, adj);
+    size_t count = strongly_connected_components(nv, off, adj, comp);
+    component_members(comp, count, coff, members);
+    vector<uint32_t> poff(nv + 1, 0);
+    for (auto &h : by_head) ++poff[h.first + 1];
+    for (size_t i = 0; i < nv; ++i) poff[i + 1] += poff[i];
+
+    auto &fk = gs.first_k;
+    fk.assign(nv, {});
+    vector<uint64_t> cur, nxt, merged;
+    for (uint32_t c = 0; c < count; ++c) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (uint32_t m = coff[c]; m < coff[c + 1]; ++m) {
+                uint32_t A = members[m];
+                for (uint32_t q = poff[A]; q < poff[A + 1]; ++q) {
+                    uint32_t p = by_head[q].second;
+                    cur.assign(1, 0); // {ε}
+                    for (uint32_t i = boff[p]; i < boff[p + 1] && !cur.empty(); ++i) {
+                        bool done = true;
+                        for (uint64_t x : cur) if (seq_len(x) < k) { done = false; break; }
+                        if (done) break;
+                        uint32_t X = body[i];
+                        nxt.clear();
+                        if (X >= nv) {
+                            uint64_t t = (uint64_t)(X - nv + 1) | (1ull << 60);
+                            for (uint64_t x : cur) nxt.push_back(seq_concat(x, t, k, bits));
+                        } else {
+                            for (uint64_t x : cur) {
+                                if (seq_len(x) == k) { nxt.push_back(x); continue; }
+                                for (uint64_t y : fk[X]) nxt.push_back(seq_concat(x, y, k, bits));
+                            }
+                        }
+                        sort(nxt.begin(), nxt.end());
+                        nxt.erase(unique(nxt.begin(), nxt.end()), nxt.end());
+                        cur.swap(nxt);
+                    }
+                    merged.clear();
+                    set_union(fk[A].begin(), fk[A].end(), cur.begin(), cur.end(), back_inserter(merged));
+                    if (merged.size() != fk[A].size()) { fk[A].swap(merged); changed = true; }
+                }
+            }
+            if (coff[c + 1] - coff[c] == 1) {
+                // a single variable without a cycle through itself is final after one round
+                bool self = false;
+                uint32_t A = members[coff[c]];
+                for (uint32_t e = off[A]; e < off[A + 1]; ++e) self |= adj[e] == A;
+                if (!self) break;
+            }
+        }
+    }
+}
+
+/// @brief Nullable, FIRST, FOLLOW, left-corner components and (k >= 2) FIRST_k.
+/// @param G Grammar; "&" in a body is the empty word.
+/// @param k Length of the FIRST_k sequences (1: only FIRST).
+/// @return Sets over dense variable and terminal ids.
+GrammarSets compute_grammar_sets(const Grammar &G, unsigned k) {
+    GrammarSets gs;
+    gs.k = max(1u, k);
+    gs.var_id.reserve(G.V.size() + 1);
+    auto var = [&](const Symbol &A) {
+        auto it = gs.var_id.find(A);
+        if (it != gs.var_id.end()) return it->second;
+        gs.vars.push_back(A);
+        return gs.var_id.emplace(A, (uint32_t)gs.vars.size() - 1).first->second;
+    };
+    // while flattening, terminals live in the same table as TERM | t (one lookup per symbol)
+    const uint32_t TERM = 1u << 31;
+    for (auto &t : G.T) {
+        if (t == "&") continue;
+        gs.term_id.emplace(t, (uint32_t)gs.terms.size());
+        gs.var_id.emplace(t, TERM | (uint32_t)gs.terms.size());
+        gs.terms.push_back(t);
+    }
+    for (auto &A : G.V) var(A);
+    if (!G.S.empty()) var(G.S);
+
+    // productions flattened: variable v -> v, terminal t -> nv + t
+    vector<uint32_t> head, boff{ 0 }, body;
+    for (auto &pr : G.P) {
+        uint32_t A = var(pr.first);
+        for (auto &rhs : pr.second) {
+            for (auto &X : rhs) if (X != "&") body.push_back(var(X));
+            head.push_back(A);
+            boff.push_back((uint32_t)body.size());
+        }
+    }
+    for (auto &t : gs.terms) gs.var_id.erase(t);
+    size_t nv = gs.vars.size(), nt = gs.terms.size();
+    for (auto &X : body) if (X & TERM) X = (uint32_t)(nv + (X & ~TERM));
+    size_t np = head.size();
+
+    // nullable: worklist over the number of not-yet-nullable symbols left in each body
+    gs.nullable.assign(nv, 0);
+    vector<uint32_t> remaining(np), occ_off(nv + 1, 0), occ, queue;
+    for (uint32_t p = 0; p < np; ++p) {
+        remaining[p] = boff[p + 1] - boff[p];
+        for (uint32_t i = boff[p]; i < boff[p + 1]; ++i) {
+            if (body[i] >= nv) { remaining[p] = UINT32_MAX; break; }
+        }
+        if (remaining[p] == UINT32_MAX) continue;
+        for (uint32_t i = boff[p]; i < boff[p + 1]; ++i) ++occ_off[body[i] + 1];
+    }
+    for (size_t i = 0; i < nv; ++i) occ_off[i + 1] += occ_off[i];
+    occ.resize(occ_off[nv]);
+    {
+        vector<uint32_t> fill(occ_off.begin(), occ_off.end() - 1);
+        for (uint32_t p = 0; p < np; ++p) {
+            if (remaining[p] == UINT32_MAX) continue;
+            for (uint32_t i = boff[p]; i < boff[p + 1]; ++i) occ[fill[body[i]]++] = p;
+        }
+    }
+    for (uint32_t p = 0; p < np; ++p) {
+        if (remaining[p] == 0 && !gs.nullable[head[p]]) { gs.nullable[head[p]] = 1; queue.push_back(head[p]); }
+    }
+    while (!queue.empty()) {
+        uint32_t B = queue.back();
+        queue.pop_back();
+        for (uint32_t i = occ_off[B]; i < occ_off[B + 1]; ++i) {
+            uint32_t p = occ[i];
+            if (--remaining[p] == 0 && !gs.nullable[head[p]]) { gs.nullable[head[p]] = 1; queue.push_back(head[p]); }
+        }
+    }
+
+    // left corners and the terminals that start a body directly
+    gs.first.init(nv, nt);
+    vector<pair<uint32_t, uint32_t>> edges;
+    for (uint32_t p = 0; p < np; ++p) {
+        for (uint32_t i = boff[p]; i < boff[p + 1]; ++i) {
+            uint32_t X = body[i];
+            if (X >= nv) { gs.first.set(head[p], X - nv); break; }
+            edges.push_back({ head[p], X });
+            if (!gs.nullable[X]) break;
+        }
+    }
+    build_csr(nv, edges, gs.lc_off, gs.lc_adj);
+    gs.lc_components = strongly_connected_components(nv, gs.lc_off, gs.lc_adj, gs.lc_comp);
+    vector<uint32_t> comp_size(gs.lc_components, 0);
+    for (uint32_t c : gs.lc_comp) ++comp_size[c];
+    gs.left_recursive.assign(nv, 0);
+    for (uint32_t A = 0; A < nv; ++A) {
+        if (comp_size[gs.lc_comp[A]] > 1) { gs.left_recursive[A] = 1; continue; }
+        for (uint32_t e = gs.lc_off[A]; e < gs.lc_off[A + 1]; ++e) if (gs.lc_adj[e] == A) gs.left_recursive[A] = 1;
+    }
+    propagate(gs.first, nv, gs.lc_off, gs.lc_adj);
+
+    // FOLLOW: scan every body right to left keeping FIRST of the rest; X -> A when the rest is nullable
+    gs.follow.init(nv, nt + 1);
+    if (!G.S.empty()) gs.follow.set(gs.var_id.at(G.S), gs.end_marker());
+    edges.clear();
+    vector<uint64_t> rest(gs.follow.words);
+    for (uint32_t p = 0; p < np; ++p) {
+        fill(rest.begin(), rest.end(), 0);
+        bool rest_nullable = true;
+        for (uint32_t i = boff[p + 1]; i-- > boff[p];) {
+            uint32_t X = body[i];
+            if (X >= nv) {
+                fill(rest.begin(), rest.end(), 0);
+                rest[(X - nv) >> 6] |= 1ull << ((X - nv) & 63);
+                rest_nullable = false;
+                continue;
+            }
+            uint64_t *f = gs.follow.row(X);
+            for (size_t w = 0; w < rest.size(); ++w) f[w] |= rest[w];
+            if (rest_nullable && X != head[p]) edges.push_back({ X, head[p] });
+            if (!gs.nullable[X]) {
+                fill(rest.begin(), rest.end(), 0);
+                rest_nullable = false;
+            }
+            const uint64_t *fx = gs.first.row(X);
+            for (size_t w = 0; w < gs.first.words; ++w) rest[w] |= fx[w];
+        }
+    }
+    vector<uint32_t> foff, fadj;
+    build_csr(nv, edges, foff, fadj);
+    propagate(gs.follow, nv, foff, fadj);
+
+    if (gs.k >= 2) compute_first_k(gs, head, boff, body);
+    return gs;
+}
+
+static string bits_to_string(const GrammarSets &gs, const BitRows &rows, size_t v, size_t nbits) {
+    string out = "{";
+    bool sep = false;
+    for (size_t b = 0; b < nbits; ++b) {
+        if (!rows.test(v, b)) continue;
+        out += (sep ? ", " : "") + (b == gs.terms.size() ? string("$") : gs.terms[b]);
+        sep = true;
+    }
+    return out + "}";
+}
+
+string grammar_sets_summary(const GrammarSets &gs) {
+    size_t nullable = 0, left_rec = 0, largest = 0;
+    vector<uint32_t> size(gs.lc_components, 0);
+    for (size_t A = 0; A < gs.vars.size(); ++A) {
+        nullable += gs.nullable[A];
+        left_rec += gs.left_recursive[A];
+        largest = max<size_t>(largest, ++size[gs.lc_comp[A]]);
+    }
+    ostringstream oss;
+    oss << "Variáveis: " << gs.vars.size() << ", terminais: " << gs.terms.size() << ", anuláveis: " << nullable
+        << ".\nCantos à esquerda: " << gs.lc_adj.size() << " arestas, " << gs.lc_components << " componentes (maior: "
+        << largest << "), " << left_rec << " variáveis recursivas à esquerda.\n";
+    return oss.str();
+}
+
+string grammar_sets_report(const GrammarSets &gs) {
+    vector<uint32_t> order(gs.vars.size());
+    for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return gs.vars[a] < gs.vars[b]; });
+    ostringstream oss;
+    for (uint32_t A : order) {
+        oss << gs.vars[A] << ":";
+        if (gs.nullable[A]) oss << " anulável;";
+        if (gs.left_recursive[A]) oss << " recursiva à esquerda;";
+        oss << " FIRST = " << bits_to_string(gs, gs.first, A, gs.terms.size())
+            << "; FOLLOW = " << bits_to_string(gs, gs.follow, A, gs.terms.size() + 1);
+        if (gs.k >= 2) {
+            vector<string> seqs;
+            for (uint64_t s : gs.first_k[A]) seqs.push_back(gs.sequence_to_string(s));
+            sort(seqs.begin(), seqs.end());
+            oss << "; FIRST_" << gs.k << " = {";
+            for (size_t i = 0; i < seqs.size(); ++i) oss << (i ? ", " : "") << seqs[i];
+            oss << "}";
+        }
+        oss << "\n";
+    }
+    return oss.str();
+}
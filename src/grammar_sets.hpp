@@ -0,0 +1,62 @@
+#ifndef GRAMMAR_SETS_HPP
+#define GRAMMAR_SETS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "grammar.hpp"
+
+using namespace std;
+
+// Fixed-width bitsets, one row per index, stored back to back.
+struct BitRows {
+    size_t words = 0;
+    vector<uint64_t> bits;
+
+    void init(size_t rows, size_t nbits) { words = (nbits + 63) / 64; bits.assign(rows * words, 0); }
+    uint64_t *row(size_t i) { return bits.data() + i * words; }
+    const uint64_t *row(size_t i) const { return bits.data() + i * words; }
+    bool test(size_t i, size_t b) const { return (row(i)[b >> 6] >> (b & 63)) & 1; }
+    void set(size_t i, size_t b) { row(i)[b >> 6] |= 1ull << (b & 63); }
+};
+
+// Strongly connected components of the graph with edges adj[off[v] .. off[v+1]) (iterative Tarjan).
+// Components are numbered sinks first: every edge v -> w has comp[v] >= comp[w].
+size_t strongly_connected_components(size_t n, const vector<uint32_t> &off, const vector<uint32_t> &adj,
+                                     vector<uint32_t> &comp);
+// Nodes of each component, components in the order given by comp: members[off[c] .. off[c+1]).
+void component_members(const vector<uint32_t> &comp, size_t count, vector<uint32_t> &off, vector<uint32_t> &members);
+
+// FIRST, FOLLOW, FIRST_k and the left-corner relation of a grammar, over dense ids.
+// FOLLOW uses the extra terminal id end_marker() for "$" (end of input).
+struct GrammarSets {
+    vector<Symbol> vars, terms;
+    unordered_map<Symbol, uint32_t> var_id, term_id;
+
+    vector<char> nullable;
+    BitRows first;   // variable -> terminals
+    BitRows follow;  // variable -> terminals and end marker
+
+    // A -> B when A -> αBβ with α nullable; components of this graph, left-recursive variables
+    vector<uint32_t> lc_off, lc_adj;
+    vector<uint32_t> lc_comp;
+    size_t lc_components = 0;
+    vector<char> left_recursive;
+
+    // FIRST_k (k >= 2): sorted packed sequences of at most k terminals per variable
+    unsigned k = 1, seq_bits = 0; // a sequence: length in bits 60..63, terminal i (id + 1) at bits [i*seq_bits, ...)
+    vector<vector<uint64_t>> first_k;
+
+    uint32_t end_marker() const { return (uint32_t)terms.size(); }
+    string sequence_to_string(uint64_t seq) const;
+};
+
+GrammarSets compute_grammar_sets(const Grammar &G, unsigned k = 1);
+
+// Human readable summary and per-variable table.
+string grammar_sets_summary(const GrammarSets &gs);
+string grammar_sets_report(const GrammarSets &gs);
+
+#endif
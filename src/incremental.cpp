@@ -0,0 +1,510 @@
+#include "incremental.hpp"
+
+#include <stdexcept>
+#include <unordered_map>
+
+#include "analyses.hpp"
+#include "io_handling.hpp"
+#include "pass_manager.hpp"
+#include "passes.hpp"
+
+namespace {
+const vector<RHS> NO_RULES;
+
+const vector<RHS> &rules_of(const Productions &P, const Symbol &A) {
+    auto it = P.find(A);
+    return it == P.end() ? NO_RULES : it->second;
+}
+
+bool is_unit(const Grammar &G, const RHS &rhs) { return rhs.size() == 1 && !G.isTerminal(rhs[0]); }
+
+// Variables in the bodies (only the unit ones with unit_only).
+set<Symbol> body_variables(const Grammar &G, const vector<RHS> &rules, bool unit_only) {
+    set<Symbol> out;
+    for (auto &rhs : rules) {
+        if (unit_only && !is_unit(G, rhs)) continue;
+        for (auto &X : rhs) if (!G.isTerminal(X)) out.insert(X);
+    }
+    return out;
+}
+
+// Move A from the user lists of the variables of its old bodies to those of its new ones.
+void reindex(map<Symbol, set<Symbol>> &users, const Grammar &G, const Symbol &A, const vector<RHS> &before,
+             const vector<RHS> &after, bool unit_only = false) {
+    set<Symbol> b = body_variables(G, before, unit_only), a = body_variables(G, after, unit_only);
+    for (auto &X : b) if (!a.count(X)) {
+        auto it = users.find(X);
+        if (it != users.end() && it->second.erase(A) && it->second.empty()) users.erase(it);
+    }
+    for (auto &X : a) if (!b.count(X)) users[X].insert(A);
+}
+
+void index_all(map<Symbol, set<Symbol>> &users, const Grammar &G, const Productions &P, bool unit_only = false) {
+    users.clear();
+    for (auto &pr : P) reindex(users, G, pr.first, NO_RULES, pr.second, unit_only);
+}
+
+// `from` and every variable with a path to one of them through `users`.
+set<Symbol> ancestors(const map<Symbol, set<Symbol>> &users, const set<Symbol> &from) {
+    set<Symbol> seen(from);
+    vector<Symbol> work(from.begin(), from.end());
+    while (!work.empty()) {
+        Symbol X = work.back();
+        work.pop_back();
+        auto it = users.find(X);
+        if (it == users.end()) continue;
+        for (auto &A : it->second) if (seen.insert(A).second) work.push_back(A);
+    }
+    return seen;
+}
+
+// Rank a body gives its variable: 1 + the highest rank of its variables, or 0 when one of them is not
+// flagged with a rank below `below` (or, with terminals_ok false, when it has a terminal). ε bodies give 1.
+size_t body_rank(const Grammar &G, const RHS &rhs, const RankedFlags &f, size_t below, bool terminals_ok) {
+    if (rhs.empty() || rhs == RHS{ "&" }) return 1;
+    size_t top = 0;
+    for (auto &X : rhs) {
+        if (G.isTerminal(X)) {
+            if (!terminals_ok) return 0;
+            continue;
+        }
+        auto it = f.rank.find(X);
+        if (it == f.rank.end() || it->second >= below) return 0;
+        top = max(top, it->second);
+    }
+    return top + 1;
+}
+
+// Smallest rank the productions of A give it (0: none), with flagged variables of rank below `below`.
+size_t rules_rank(const Grammar &G, const vector<RHS> &rules, const RankedFlags &f, size_t below, bool terminals_ok) {
+    size_t best = 0;
+    for (auto &rhs : rules) {
+        size_t r = body_rank(G, rhs, f, below, terminals_ok);
+        if (r && (!best || r < best)) best = r;
+    }
+    return best;
+}
+
+// Nullable (terminals_ok false) or generating variables of P from scratch, ranked by the worklist order: each
+// body counts down the variable occurrences it still waits for.
+RankedFlags ranked_fixpoint(const Grammar &G, const Productions &P, bool terminals_ok) {
+    RankedFlags f;
+    vector<const Symbol*> owner;
+    vector<size_t> waiting, top;
+    unordered_map<Symbol, vector<size_t>> waiters;
+    vector<const Symbol*> work;
+    auto flag = [&](const Symbol &A, size_t r) {
+        if (!f.on.insert(A).second) return;
+        f.rank[A] = r;
+        work.push_back(&*f.on.find(A));
+    };
+    for (auto &pr : P)
+        for (auto &rhs : pr.second) {
+            size_t b = owner.size(), count = 0;
+            bool dead = false;
+            if (!(rhs == RHS{ "&" }))
+                for (auto &X : rhs) {
+                    if (G.isTerminal(X)) { dead = dead || !terminals_ok; continue; }
+                    ++count;
+                }
+            if (dead) continue;
+            owner.push_back(&pr.first);
+            waiting.push_back(count);
+            top.push_back(0);
+            if (!count) { flag(pr.first, 1); continue; }
+            for (auto &X : rhs) if (!G.isTerminal(X)) waiters[X].push_back(b);
+        }
+    for (size_t i = 0; i < work.size(); ++i) { // FIFO: ranks do not decrease along the list
+        const Symbol &X = *work[i];
+        size_t r = f.rank[X];
+        auto it = waiters.find(X);
+        if (it == waiters.end()) continue;
+        for (size_t b : it->second) {
+            top[b] = max(top[b], r);
+            if (--waiting[b] == 0) flag(*owner[b], top[b] + 1);
+        }
+    }
+    return f;
+}
+
+// Bring the flags up to date after the reasons of `seeds` may have changed. support(A, below) is the
+// smallest rank A gets from flagged variables of rank below `below` (0: none); next(A, fn) calls fn on the
+// variables whose reason may use A. The flagged variables left without a reason of smaller rank are
+// unflagged first, following next(); then every unflagged variable met is flagged again where it can be.
+// Returns the variables whose flag changed and adds the ones looked at to `looked`.
+template <class Support, class Next>
+set<Symbol> update_ranked(RankedFlags &f, const set<Symbol> &seeds, Support support, Next next, size_t &looked,
+                          Budget &budget) {
+    set<Symbol> met(seeds), lost, gained;
+    vector<Symbol> work;
+    for (auto &A : seeds) if (f.on.count(A)) work.push_back(A);
+    while (!work.empty()) {
+        Symbol A = std::move(work.back());
+        work.pop_back();
+        budget.tick();
+        auto it = f.rank.find(A);
+        if (it == f.rank.end() || support(A, it->second)) continue;
+        f.rank.erase(it);
+        f.on.erase(A);
+        lost.insert(A);
+        next(A, [&](const Symbol &B) {
+            met.insert(B);
+            if (f.on.count(B)) work.push_back(B);
+        });
+    }
+    for (auto &A : met) if (!f.on.count(A)) work.push_back(A);
+    while (!work.empty()) {
+        Symbol A = std::move(work.back());
+        work.pop_back();
+        budget.tick();
+        if (f.on.count(A)) continue;
+        size_t r = support(A, SIZE_MAX);
+        if (!r) continue;
+        f.on.insert(A);
+        f.rank[A] = r;
+        if (!lost.erase(A)) gained.insert(A);
+        next(A, [&](const Symbol &B) {
+            met.insert(B);
+            if (!f.on.count(B)) work.push_back(B);
+        });
+    }
+    looked += met.size();
+    lost.insert(gained.begin(), gained.end());
+    return lost;
+}
+
+// next() for update_ranked: the variables a reverse index lists for A.
+struct IndexNext {
+    const map<Symbol, set<Symbol>> &users;
+    template <class F> void operator()(const Symbol &A, F fn) const {
+        auto it = users.find(A);
+        if (it != users.end()) for (auto &U : it->second) fn(U);
+    }
+};
+
+set<Symbol> unit_closure_of(const Grammar &G, const Symbol &A) {
+    set<Symbol> cl{ A };
+    vector<Symbol> work{ A };
+    while (!work.empty()) {
+        Symbol B = work.back();
+        work.pop_back();
+        for (auto &rhs : rules_of(G.P, B))
+            if (is_unit(G, rhs) && cl.insert(rhs[0]).second) work.push_back(rhs[0]);
+    }
+    return cl;
+}
+
+// Bodies of a generating variable without the ones that use a non-generating variable.
+vector<RHS> keep_generating(const Grammar &G, const vector<RHS> &rules, const set<Symbol> &gen) {
+    vector<RHS> out;
+    for (auto &rhs : rules) {
+        bool ok = true;
+        for (auto &X : rhs) if (!G.isTerminal(X) && !gen.count(X)) { ok = false; break; }
+        if (ok) out.push_back(rhs);
+    }
+    return out;
+}
+
+// Set (or drop, when `rules` is null) the productions of A; true if they changed.
+bool set_rules(Productions &P, const Symbol &A, const vector<RHS> *rules) {
+    auto it = P.find(A);
+    if (!rules) {
+        if (it == P.end()) return false;
+        P.erase(it);
+        return true;
+    }
+    if (it != P.end() && it->second == *rules) return false;
+    P[A] = *rules;
+    return true;
+}
+
+void run_passes(Grammar &G, PassContext &ctx, const string &spec) {
+    run_pipeline(G, parse_pipeline(spec), ctx);
+}
+}
+
+/// @brief Normalize G once, keeping the intermediate grammars and analyses.
+/// @param G Grammar as read (unweighted).
+/// @param threads Workers for the passes and analyses.
+/// @param limits Limits (--limit) of the first normalization and of each later step.
+IncrementalNormalizer::IncrementalNormalizer(const Grammar &G, unsigned threads, const Budget &limits)
+    : threads_(threads), in_(G) {
+    if (!G.weight.empty()) throw runtime_error("A renormalização incremental não aceita gramáticas com probabilidades.");
+    limits_.copy_limits(limits);
+    rebuild();
+}
+
+/// @brief Everything from the input, with the same passes as a full run.
+void IncrementalNormalizer::rebuild() {
+    Logger quiet("/dev/null");
+    quiet.enabled = false;
+    PassContext ctx(quiet);
+    ctx.threads = threads_;
+    ctx.budget.copy_limits(limits_);
+
+    eps_ = in_;
+    nullable_ = ranked_fixpoint(in_, in_.P, false);
+    ctx.analyses.set_nullable(nullable_.on);
+    ran_eps_ = !epsilon_is_noop(eps_, ctx);
+    run_passes(eps_, ctx, "eps");
+
+    unit_ = eps_;
+    ran_unit_ = !unit_is_noop(unit_, ctx);
+    closure_.clear();
+    if (ran_unit_) closure_ = ctx.analyses.unit_closure(unit_);
+    run_passes(unit_, ctx, "unit");
+
+    generating_ = ranked_fixpoint(unit_, unit_.P, true);
+    kept_.clear();
+    for (auto &pr : unit_.P)
+        if (generating_.on.count(pr.first)) kept_[pr.first] = keep_generating(unit_, pr.second, generating_.on);
+    // reachable: ranked by the distance from the start
+    reachable_ = RankedFlags();
+    reachable_.on.insert(unit_.S);
+    reachable_.rank[unit_.S] = 1;
+    vector<Symbol> layer{ unit_.S };
+    for (size_t r = 2; !layer.empty(); ++r) {
+        vector<Symbol> below;
+        for (auto &A : layer) {
+            auto it = kept_.find(A);
+            if (it == kept_.end()) continue;
+            for (auto &X : body_variables(unit_, it->second, false))
+                if (reachable_.on.insert(X).second) {
+                    reachable_.rank[X] = r;
+                    below.push_back(X);
+                }
+        }
+        layer.swap(below);
+    }
+    useful_ = unit_;
+    ran_useless_ = useless_would_run();
+    run_passes(useful_, ctx, "useless");
+
+    index_all(users_in_, in_, in_.P);
+    index_all(unit_parents_, eps_, eps_.P, true);
+    index_all(users_unit_, unit_, unit_.P);
+    index_all(users_kept_, unit_, kept_);
+    unit_rules_ = 0;
+    for (auto &pr : eps_.P)
+        for (auto &rhs : pr.second) unit_rules_ += is_unit(eps_, rhs);
+}
+
+/// @brief epsilon_is_noop over the kept analyses: some variable is nullable, other than a start that no body uses.
+bool IncrementalNormalizer::eps_would_run() const {
+    if (nullable_.on.empty()) return false;
+    if (nullable_.on.size() != 1 || !nullable_.on.count(in_.S)) return true;
+    return users_in_.count(in_.S) > 0;
+}
+
+/// @brief useless_is_noop over the kept analyses.
+bool IncrementalNormalizer::useless_would_run() const {
+    if (generating_.on.size() != unit_.V.size()) return true;
+    for (auto &A : unit_.V) if (!reachable_.on.count(A)) return true;
+    for (auto &pr : unit_.P) if (!unit_.V.count(pr.first)) return true;
+    return false;
+}
+
+/// @brief Apply the edits and bring every kept grammar and analysis up to date.
+/// @param delta Productions to add and remove; new symbols are added to the input first.
+/// @return What had to be looked at again.
+IncrementalStats IncrementalNormalizer::apply(const GrammarDelta &delta) {
+    IncrementalStats st;
+    Budget budget;
+    budget.copy_limits(limits_);
+    budget.begin_pass("incremental", useful_);
+    // 1) the input
+    bool must_rebuild = false;
+    for (auto &t : delta.new_terminals) in_.T.insert(t);
+    for (auto &v : delta.new_variables) {
+        in_.V.insert(v);
+        // the fresh start of eps takes the first free name S_S0_k
+        if (v.compare(0, in_.S.size() + 4, in_.S + "_S0_") == 0) must_rebuild = true;
+    }
+    map<Symbol, vector<RHS>> before;
+    auto touch = [&](const Symbol &A) { if (!before.count(A)) before[A] = rules_of(in_.P, A); };
+    for (auto &rm : delta.removed) {
+        touch(rm.first);
+        auto it = in_.P.find(rm.first);
+        if (it != in_.P.end()) it->second.erase(remove(it->second.begin(), it->second.end(), rm.second), it->second.end());
+    }
+    for (auto &add : delta.added) {
+        touch(add.first);
+        auto &list = in_.P[add.first];
+        if (find(list.begin(), list.end(), add.second) == list.end()) list.push_back(add.second);
+    }
+    set<Symbol> changed(delta.new_variables);
+    for (auto &b : before) {
+        if (b.second == rules_of(in_.P, b.first)) continue;
+        changed.insert(b.first);
+        reindex(users_in_, in_, b.first, b.second, rules_of(in_.P, b.first));
+    }
+    st.changed = changed.size();
+    if (must_rebuild) {
+        rebuild();
+        st.rebuilt = true;
+        return st;
+    }
+
+    // 2) nullable, from the edited variables
+    auto nullable_support = [&](const Symbol &A, size_t below) {
+        return rules_rank(in_, rules_of(in_.P, A), nullable_, below, false);
+    };
+    set<Symbol> flipped = update_ranked(nullable_, changed, nullable_support, IndexNext{ users_in_ }, st.nullable, budget);
+    st.nullable_changed = flipped.size();
+    bool start_nullable = nullable_.on.count(in_.S) > 0;
+    if (eps_would_run() != ran_eps_ || (ran_eps_ && start_nullable != (eps_.S != in_.S))) {
+        rebuild();
+        st.rebuilt = true;
+        return st;
+    }
+
+    // 3) ε-free productions of the edited variables and of the users of the ones whose nullability changed
+    set<Symbol> targets(changed);
+    for (auto &X : flipped) {
+        auto it = users_in_.find(X);
+        if (it != users_in_.end()) targets.insert(it->second.begin(), it->second.end());
+    }
+    eps_.T = in_.T;
+    set<Symbol> eps_changed;
+    for (auto &A : targets) {
+        if (!in_.V.count(A)) continue;
+        eps_.V.insert(A);
+        vector<RHS> old = rules_of(eps_.P, A);
+        const vector<RHS> *now = nullptr;
+        vector<RHS> fresh;
+        if (ran_eps_) {
+            fresh = epsilon_free_productions(A, rules_of(in_.P, A), nullable_.on, budget);
+            now = &fresh; // every variable has an entry after eps, possibly empty
+        } else if (in_.P.count(A)) {
+            now = &in_.P.at(A);
+        }
+        ++st.eps;
+        if (!set_rules(eps_.P, A, now)) continue;
+        eps_changed.insert(A);
+        for (auto &rhs : old) unit_rules_ -= is_unit(eps_, rhs);
+        for (auto &rhs : rules_of(eps_.P, A)) unit_rules_ += is_unit(eps_, rhs);
+        reindex(unit_parents_, eps_, A, old, rules_of(eps_.P, A), true);
+    }
+    st.eps_changed = eps_changed.size();
+    if ((unit_rules_ > 0) != ran_unit_) {
+        rebuild();
+        st.rebuilt = true;
+        return st;
+    }
+
+    // 4) unit closures of the unit ancestors, and their unit-free productions
+    unit_.V = eps_.V;
+    unit_.T = eps_.T;
+    set<Symbol> unit_changed;
+    if (ran_unit_) {
+        for (auto &A : ancestors(unit_parents_, eps_changed)) {
+            if (!eps_.V.count(A)) continue;
+            budget.tick();
+            set<Symbol> cl = unit_closure_of(eps_, A);
+            ++st.closure;
+            auto &cur = closure_[A];
+            if (cur != cl) { ++st.closure_changed; cur.swap(cl); }
+            vector<RHS> old = rules_of(unit_.P, A);
+            vector<RHS> fresh = unit_free_productions(eps_, cur);
+            if (set_rules(unit_.P, A, fresh.empty() ? nullptr : &fresh)) {
+                unit_changed.insert(A);
+                reindex(users_unit_, unit_, A, old, fresh);
+            }
+        }
+    } else {
+        for (auto &A : eps_changed) {
+            vector<RHS> old = rules_of(unit_.P, A);
+            if (set_rules(unit_.P, A, eps_.P.count(A) ? &eps_.P.at(A) : nullptr)) {
+                unit_changed.insert(A);
+                reindex(users_unit_, unit_, A, old, rules_of(unit_.P, A));
+            }
+        }
+    }
+    st.unit_changed = unit_changed.size();
+
+    // 5) generating, from the variables with new productions, then the bodies kept for reachability
+    auto generating_support = [&](const Symbol &A, size_t below) {
+        return rules_rank(unit_, rules_of(unit_.P, A), generating_, below, true);
+    };
+    set<Symbol> gen_flipped =
+        update_ranked(generating_, unit_changed, generating_support, IndexNext{ users_unit_ }, st.generating, budget);
+    st.generating_changed = gen_flipped.size();
+    set<Symbol> kept_targets(unit_changed);
+    kept_targets.insert(gen_flipped.begin(), gen_flipped.end());
+    for (auto &X : gen_flipped) {
+        auto it = users_unit_.find(X);
+        if (it != users_unit_.end()) kept_targets.insert(it->second.begin(), it->second.end());
+    }
+    set<Symbol> kept_changed, edges_changed;
+    for (auto &A : kept_targets) {
+        budget.tick();
+        vector<RHS> old = rules_of(kept_, A);
+        vector<RHS> fresh;
+        bool now = generating_.on.count(A) && unit_.P.count(A);
+        if (now) fresh = keep_generating(unit_, unit_.P.at(A), generating_.on);
+        if (!set_rules(kept_, A, now ? &fresh : nullptr)) continue;
+        kept_changed.insert(A);
+        reindex(users_kept_, unit_, A, old, fresh);
+        for (auto &X : body_variables(unit_, old, false)) edges_changed.insert(X);
+        for (auto &X : body_variables(unit_, fresh, false)) edges_changed.insert(X);
+    }
+
+    // 6) reachable, from the variables that gained or lost a parent: the reason of a variable is a
+    //    reachable parent closer to the start
+    auto reachable_support = [&](const Symbol &A, size_t below) -> size_t {
+        if (A == unit_.S) return 1;
+        size_t best = 0;
+        auto it = users_kept_.find(A);
+        if (it != users_kept_.end())
+            for (auto &P : it->second) {
+                auto r = reachable_.rank.find(P);
+                if (r != reachable_.rank.end() && r->second < below && (!best || r->second + 1 < best)) best = r->second + 1;
+            }
+        return best;
+    };
+    auto children = [&](const Symbol &A, auto fn) {
+        auto it = kept_.find(A);
+        if (it != kept_.end()) for (auto &X : body_variables(unit_, it->second, false)) fn(X);
+    };
+    set<Symbol> reach_flipped = update_ranked(reachable_, edges_changed, reachable_support, children, st.reachable, budget);
+    st.reachable_changed = reach_flipped.size();
+    if (useless_would_run() != ran_useless_) {
+        rebuild();
+        st.rebuilt = true;
+        return st;
+    }
+
+    // 7) the trimmed grammar: generating and reachable variables with their kept bodies
+    useful_.T = unit_.T;
+    useful_.S = unit_.S;
+    if (!ran_useless_) {
+        useful_.V = unit_.V;
+        for (auto &A : unit_changed)
+            st.useful_changed += set_rules(useful_.P, A, unit_.P.count(A) ? &unit_.P.at(A) : nullptr);
+        budget.end_pass(useful_);
+        return st;
+    }
+    set<Symbol> useful_targets(kept_changed);
+    useful_targets.insert(reach_flipped.begin(), reach_flipped.end());
+    useful_targets.insert(gen_flipped.begin(), gen_flipped.end());
+    for (auto &A : useful_targets) {
+        bool in = generating_.on.count(A) && reachable_.on.count(A);
+        if (in) useful_.V.insert(A);
+        else useful_.V.erase(A);
+        st.useful_changed += set_rules(useful_.P, A, in && kept_.count(A) ? &kept_.at(A) : nullptr);
+    }
+    budget.end_pass(useful_);
+    return st;
+}
+
+/// @brief The CNF grammar: term and bin over the kept trimmed grammar.
+Grammar IncrementalNormalizer::result() const {
+    Logger quiet("/dev/null");
+    quiet.enabled = false;
+    PassContext ctx(quiet);
+    ctx.threads = threads_;
+    ctx.budget.copy_limits(limits_);
+    Grammar G = useful_;
+    run_passes(G, ctx, "term,bin");
+    return G;
+}
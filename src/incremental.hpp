@@ -0,0 +1,71 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "budget.hpp"
+#include "grammar.hpp"
+
+using namespace std;
+
+// What one IncrementalNormalizer::apply touched: variables looked at again and, of those, the ones that
+// changed.
+struct IncrementalStats {
+    bool rebuilt = false; // a global decision changed (start nullable, a pass skipped or not): redone from the input
+    size_t changed = 0;   // variables whose productions the delta changed
+    size_t nullable = 0, nullable_changed = 0;
+    size_t eps = 0, eps_changed = 0;         // ε-free productions
+    size_t closure = 0, closure_changed = 0; // unit closures
+    size_t unit_changed = 0;                 // unit-free productions
+    size_t generating = 0, generating_changed = 0;
+    size_t reachable = 0, reachable_changed = 0;
+    size_t useful_changed = 0;               // productions of the trimmed grammar
+};
+
+// A least-fixpoint flag (nullable, generating, reachable) with a rank per flagged variable: each one has a
+// reason (a body, or a parent for reachability) made only of flagged variables of smaller rank.
+struct RankedFlags {
+    set<Symbol> on;
+    map<Symbol, size_t> rank;
+};
+
+// The "cnf" pipeline (eps, unit, useless, term, bin) kept up to date while productions are added and
+// removed. The grammars after eps, unit and useless are kept with the analyses they came from and the
+// reverse indexes (who uses a variable, who has a unit production to it), so that a delta only revisits the
+// edited variables and, for nullable, generating and reachable, the ones whose reason was lost or that can
+// now be flagged; the unit closures are redone for the unit ancestors of the edited variables. term and bin
+// are linear renaming passes whose fresh names depend on the whole grammar, so result() runs them over the
+// kept trimmed grammar.
+// When an edit changes a global decision (the start becomes nullable or stops being, or a pass goes from
+// skipped to run) everything is rebuilt from the input, which is what a full run would do.
+// The result is the same grammar a full run over input() gives. Weighted grammars are not supported.
+// The limits of `limits` bound the first normalization, and then each apply and each result on its own: the
+// passes they run check them as in run_pipeline, and apply checks the limits of the run (as step
+// "incremental") while it revisits variables.
+class IncrementalNormalizer {
+public:
+    explicit IncrementalNormalizer(const Grammar &G, unsigned threads = 1, const Budget &limits = Budget());
+
+    IncrementalStats apply(const GrammarDelta &delta);
+    Grammar result() const;
+    const Grammar &input() const { return in_; }
+
+private:
+    unsigned threads_;
+    Budget limits_;
+    Grammar in_, eps_, unit_, useful_; // the input and the grammars after eps, unit and useless
+    bool ran_eps_ = false, ran_unit_ = false, ran_useless_ = false;
+    RankedFlags nullable_, generating_, reachable_; // of in_, of unit_, of kept_ from the start
+    map<Symbol, set<Symbol>> closure_;               // unit closures in eps_ (when unit ran)
+    Productions kept_;                               // generating variables of unit_, without non-generating bodies
+    map<Symbol, set<Symbol>> users_in_, unit_parents_, users_unit_, users_kept_;
+    size_t unit_rules_ = 0;                          // unit productions in eps_
+
+    void rebuild();
+    bool eps_would_run() const;
+    bool useless_would_run() const;
+};
+
+#endif
@@ -1,19 +1,103 @@
 #include "io_handling.hpp"
 
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <unordered_set>
+
+#include "weights.hpp"
+
 Logger::Logger(const string &fname) {
     out.open(fname);
     if (!out) throw runtime_error("Não foi possível criar log em " + fname);
 }
 void Logger::snapshot(const string &title, const Grammar &G) {
+    if (!enabled) return;
     out << "==== [" << title << "] ====\n";
-    out << grammar_to_string(G) << "\n\n";
+    write_grammar(out, G);
+    out << "\n\n";
 }
 void Logger::info(const string &s) {
+    if (!enabled) return;
     out << s << "\n";
 }
 
+namespace {
+// Symbols grouped by length, longest first, for longest-match splitting of the bodies.
+struct SymbolIndex {
+    map<size_t, unordered_set<string>, greater<size_t>> by_length;
+
+    void add(const string &s) { by_length[s.size()].insert(s); }
+    const string *match(const string &text, size_t p) const {
+        for (auto &bucket : by_length) {
+            if (text.size() - p < bucket.first) continue;
+            auto it = bucket.second.find(text.substr(p, bucket.first));
+            if (it != bucket.second.end()) return &*it;
+        }
+        return nullptr;
+    }
+};
+}
+
+// Split an alternative into symbols: variables longest-first, then terminals longest-first, else a single
+// character, which is a new terminal (added to `terms` and passed to new_terminal).
+static RHS split_alternative(const string &alt, const SymbolIndex &vars, SymbolIndex &terms,
+                             const function<void(const string &)> &new_terminal) {
+    RHS r;
+    size_t p = 0;
+    while (p < alt.size()) {
+        const string *m = vars.match(alt, p);
+        if (!m) m = terms.match(alt, p);
+        if (m) {
+            r.push_back(*m);
+            p += m->size();
+            continue;
+        }
+        string t(1, alt[p]);
+        terms.add(t);
+        new_terminal(t);
+        r.push_back(t);
+        p++;
+    }
+    return r;
+}
+
+// Split "A -> x | y" into the left side and the trimmed alternatives; false if there is no arrow.
+static bool split_rule_line(const string &ln, string &lhs, vector<string> &alts) {
+    auto arrow = ln.find("->");
+    if (arrow == string::npos) return false;
+    lhs = trim(ln.substr(0, arrow));
+    string rhsall = trim(ln.substr(arrow + 2));
+    alts.clear();
+    if (lhs.empty() || rhsall.empty()) return true;
+    string cur;
+    for (char c : rhsall) {
+        if (c == '|') { alts.push_back(trim(cur)); cur.clear(); }
+        else cur.push_back(c);
+    }
+    if (!cur.empty()) alts.push_back(trim(cur));
+    return true;
+}
+
+// Strip a trailing probability "[p]" from an alternative; -1 if there is none. A bracketed text that is
+// not a number is left alone (brackets may be terminals).
+static double take_weight(string &alt) {
+    if (alt.empty() || alt.back() != ']') return -1;
+    size_t lb = alt.rfind('[');
+    if (lb == string::npos) return -1;
+    string num = trim(alt.substr(lb + 1, alt.size() - lb - 2));
+    char *end = nullptr;
+    double w = strtod(num.c_str(), &end);
+    if (num.empty() || *end != '\0') return -1;
+    if (!(w >= 0) || std::isinf(w)) throw runtime_error("Probabilidade inválida na regra: '" + alt + "'");
+    alt = trim(alt.substr(0, lb));
+    return w;
+}
+
 // Tolerant: accepts accents, multiple lines, automatic additions with warnings.
 /// @brief Robust parser for the format with blocks: Variaveis = {...}, Alfabeto = {...}, Inicial = X, Regras: A -> A01B | & 
+/// Alternatives may end with a probability, A -> aB [0.3] | b [0.7]; each variable's probabilities are normalized to 1.
 /// @param filename File to read from
 /// @param G Grammar object to populate
 void read_grammar(const string &filename, Grammar &G)
@@ -146,99 +230,390 @@ void read_grammar(const string &filename, Grammar &G)
     if (idx == -1) idx = find_line_idx("regra");
     if (idx == -1) throw runtime_error("Formato inválido: seção 'Regras' não encontrada.");
 
+    SymbolIndex vars_index, terms_index;
+    bool weighted = false;
+    map<Symbol, vector<pair<RHS, double>>> read_weights; // -1: rule without [p]
+    for (auto &v : G.V) vars_index.add(v);
+    for (auto &t : G.T) terms_index.add(t);
+
     for (int i = idx+1; i < (int)lines.size(); ++i) {
         string ln = trim(lines[i]);
         if (ln.empty()) continue;
-        auto arrow = ln.find("->");
-        if (arrow == string::npos) continue;
-        string lhs = trim(ln.substr(0, arrow));
-        string rhsall = trim(ln.substr(arrow+2));
-        if (lhs.empty() || rhsall.empty()) continue;
+        string lhs;
+        vector<string> alts;
+        if (!split_rule_line(ln, lhs, alts) || alts.empty()) continue;
         if (!G.V.count(lhs)) {
             cerr << "Aviso: LHS '" << lhs << "' não estava em Variaveis — adicionando automaticamente.\n";
             G.V.insert(lhs);
+            vars_index.add(lhs);
         }
-        // split alternatives by '|'
-        vector<string> alts;
-        string cur;
-        for (size_t k = 0; k < rhsall.size(); ++k) {
-            char c = rhsall[k];
-            if (c == '|') { alts.push_back(trim(cur)); cur.clear(); }
-            else cur.push_back(c);
-        }
-        if (!cur.empty()) alts.push_back(trim(cur));
         for (auto &alt : alts) {
-            if (alt == "&") { G.P[lhs].push_back(RHS()); continue; }
-            RHS r;
-            size_t p = 0;
-            while (p < alt.size()) {
-                bool matched = false;
-                // match variables longest-first
-                vector<string> vars_vec(G.V.begin(), G.V.end());
-                sort(vars_vec.begin(), vars_vec.end(), [](const string &a, const string &b){ return a.size() > b.size(); });
-                for (auto &v : vars_vec) {
-                    if (alt.size() - p >= v.size() && alt.substr(p, v.size()) == v) {
-                        r.push_back(v);
-                        p += v.size();
-                        matched = true;
-                        break;
-                    }
-                }
-                if (matched) continue;
-                // try terminals longest-first
-                vector<string> terms_vec(G.T.begin(), G.T.end());
-                sort(terms_vec.begin(), terms_vec.end(), [](const string &a, const string &b){ return a.size() > b.size(); });
-                bool termMatched = false;
-                for (auto &t : terms_vec) {
-                    if (alt.size() - p >= t.size() && alt.substr(p, t.size()) == t) {
-                        r.push_back(t);
-                        p += t.size();
-                        termMatched = true;
-                        break;
-                    }
-                }
-                if (termMatched) continue;
-                // else single character as terminal (if present in alphabet, or add it)
-                string t(1, alt[p]);
-                if (!G.T.count(t)) {
-                    cerr << "Aviso: símbolo '" << t << "' não estava em Alfabeto — adicionando automaticamente.\n";
-                    G.T.insert(t);
-                }
-                r.push_back(t);
-                p++;
+            double w = take_weight(alt);
+            if (w >= 0) weighted = true;
+            if (alt == "&") {
+                G.P[lhs].push_back(RHS());
+                read_weights[lhs].emplace_back(RHS(), w);
+                continue;
             }
+            RHS r = split_alternative(alt, vars_index, terms_index, [&](const string &t) {
+                cerr << "Aviso: símbolo '" << t << "' não estava em Alfabeto — adicionando automaticamente.\n";
+                G.T.insert(t);
+            });
             G.P[lhs].push_back(r);
+            read_weights[lhs].emplace_back(r, w);
+        }
+    }
+
+    // 5) Probabilities: rules without [p] share what the annotated rules of the variable leave of 1
+    if (!weighted) return;
+    for (auto &rw : read_weights) {
+        double annotated = 0;
+        size_t bare = 0;
+        for (auto &bw : rw.second) {
+            if (bw.second >= 0) annotated += bw.second;
+            else ++bare;
         }
+        double share = bare ? max(0.0, 1.0 - annotated) / bare : 0.0;
+        auto &w = G.weight[rw.first];
+        for (auto &bw : rw.second) w[bw.first] += bw.second >= 0 ? bw.second : share;
     }
+    normalize_weights(G);
 }
 
+/// @brief Read a delta of productions: lines "+ A -> x | y" add bodies to A, lines "- A -> x" remove them
+/// ('#' starts a comment, '&' is the empty body). Bodies are split as in read_grammar, over the symbols of G
+/// and of the delta itself; a left side not in G.V is a new variable, an unknown character a new terminal.
+/// @param filename File to read from.
+/// @param G Grammar the delta applies to (not changed).
+GrammarDelta read_grammar_delta(const string &filename, const Grammar &G) {
+    ifstream in(filename);
+    if (!in) throw runtime_error("Não foi possível abrir " + filename);
+    vector<pair<char, string>> lines;
+    string line;
+    GrammarDelta d;
+    SymbolIndex vars_index, terms_index;
+    for (auto &v : G.V) vars_index.add(v);
+    for (auto &t : G.T) terms_index.add(t);
+    // left sides first, so that a new variable is matched in bodies that come before its own line
+    while (getline(in, line)) {
+        auto p = line.find('#');
+        if (p != string::npos) line = line.substr(0, p);
+        line = trim(line);
+        if (line.empty()) continue;
+        if (line[0] != '+' && line[0] != '-') throw runtime_error("Linha inválida no delta (use + ou -): '" + line + "'");
+        lines.emplace_back(line[0], trim(line.substr(1)));
+        string lhs;
+        vector<string> alts;
+        if (!split_rule_line(lines.back().second, lhs, alts) || lhs.empty() || alts.empty())
+            throw runtime_error("Linha inválida no delta: '" + line + "'");
+        if (G.T.count(lhs)) throw runtime_error("Linha inválida no delta: '" + lhs + "' é um terminal da gramática.");
+        if (!G.V.count(lhs) && d.new_variables.insert(lhs).second) vars_index.add(lhs);
+    }
+    for (auto &op : lines) {
+        string lhs;
+        vector<string> alts;
+        split_rule_line(op.second, lhs, alts);
+        for (auto &alt : alts) {
+            RHS r;
+            if (alt != "&") r = split_alternative(alt, vars_index, terms_index, [&](const string &t) { d.new_terminals.insert(t); });
+            (op.first == '+' ? d.added : d.removed).emplace_back(lhs, r);
+        }
+    }
+    return d;
+}
 
 //// @brief Convert a Grammar object to its string representation pretty-printed.
 /// @param G Grammar to convert to string.
 /// @return String representation of the grammar.
 string grammar_to_string(const Grammar &G) {
     ostringstream oss;
-    oss << "Start: " << G.S << "\n";
-    // iterate V in sorted order for determinism
-    vector<string> vars(G.V.begin(), G.V.end());
-    sort(vars.begin(), vars.end());
-    for (auto &A : vars) {
-        if (G.P.count(A)==0) continue;
-        oss << A << " -> ";
+    write_grammar(oss, G);
+    return oss.str();
+}
+
+/// @brief Write the pretty-printed grammar to a stream, one variable at a time.
+/// @param out Stream to write to (the log).
+/// @param G Grammar to write.
+void write_grammar(ostream &out, const Grammar &G) {
+    out << "Start: " << G.S << "\n";
+    // V is a sorted set: the order is deterministic
+    for (auto &A : G.V) {
+        auto pit = G.P.find(A);
+        if (pit == G.P.end()) continue;
+        auto w = G.weight.find(A);
+        out << A << " -> ";
         bool first = true;
-        for (auto &rhs : G.P.at(A)) {
-            if (!first) oss << " | ";
+        for (auto &rhs : pit->second) {
+            if (!first) out << " | ";
             first = false;
-            if (rhs.empty()) oss << "&";
+            if (rhs.empty()) out << "&";
             else {
                 for (size_t i=0;i<rhs.size();++i) {
-                    if (i) oss << " ";
-                    if(G.isTerminal(rhs[i])) oss << '\'' << rhs[i] << '\'';
-                    else oss << rhs[i];
+                    if (i) out << " ";
+                    if(G.isTerminal(rhs[i])) out << '\'' << rhs[i] << '\'';
+                    else out << rhs[i];
                 }
             }
+            if (w != G.weight.end()) {
+                auto b = w->second.find(rhs);
+                if (b != w->second.end()) out << " [" << b->second << "]";
+            }
         }
-        oss << "\n";
+        out << "\n";
     }
-    return oss.str();
+}
+
+BufferedWriter::BufferedWriter(const string &filename, size_t capacity)
+    : file_(fopen(filename.c_str(), "wb")), buf_(max<size_t>(capacity, 64)), name_(filename) {
+    if (!file_) throw runtime_error("Não foi possível criar " + filename);
+}
+
+BufferedWriter::~BufferedWriter() {
+    if (!file_) return;
+    fwrite(buf_.data(), 1, used_, file_);
+    fclose(file_);
+}
+
+void BufferedWriter::put(const string &s) {
+    size_t done = 0;
+    while (done < s.size()) {
+        if (used_ == buf_.size()) flush();
+        size_t n = min(s.size() - done, buf_.size() - used_);
+        memcpy(buf_.data() + used_, s.data() + done, n);
+        used_ += n;
+        done += n;
+    }
+}
+
+void BufferedWriter::put_number(double x) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof tmp, "%.17g", x);
+    // fewer digits when they already read back as x
+    for (int p = 1; p < 17; ++p) {
+        char shorter[32];
+        int m = snprintf(shorter, sizeof shorter, "%.*g", p, x);
+        if (strtod(shorter, nullptr) == x) {
+            memcpy(tmp, shorter, m + 1);
+            n = m;
+            break;
+        }
+    }
+    put(string(tmp, n));
+}
+
+void BufferedWriter::flush() {
+    if (used_ && fwrite(buf_.data(), 1, used_, file_) != used_) throw runtime_error("Erro ao gravar " + name_);
+    used_ = 0;
+}
+
+void BufferedWriter::close() {
+    if (!file_) return;
+    flush();
+    bool failed = fclose(file_) != 0;
+    file_ = nullptr;
+    if (failed) throw runtime_error("Erro ao gravar " + name_);
+}
+
+namespace {
+// A symbol the input format can hold: none of the separators of its lists and rules.
+bool writable_symbol(const Symbol &X) {
+    if (X.empty() || X.find("->") != string::npos) return false;
+    for (char c : X)
+        if (c == ',' || c == '{' || c == '}' || c == '|' || c == '#' || isspace((unsigned char)c)) return false;
+    return true;
+}
+
+// True if read_grammar splits the concatenated body back into exactly these symbols.
+bool splits_back(const RHS &rhs, const string &text, const SymbolIndex &vars, const SymbolIndex &terms) {
+    size_t p = 0;
+    for (auto &X : rhs) {
+        const string *m = vars.match(text, p);
+        if (!m) m = terms.match(text, p);
+        size_t len = m ? m->size() : 1;
+        if (text.compare(p, len, X) != 0 || len != X.size()) return false;
+        p += len;
+    }
+    return p == text.size();
+}
+
+void put_json_string(BufferedWriter &w, const string &s) {
+    w.put('"');
+    for (char c : s) {
+        if (c == '"' || c == '\\') { w.put('\\'); w.put(c); }
+        else if ((unsigned char)c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof esc, "\\u%04x", (unsigned)(unsigned char)c);
+            w.put(string(esc));
+        } else w.put(c);
+    }
+    w.put('"');
+}
+
+void put_json_list(BufferedWriter &w, const set<Symbol> &items) {
+    w.put('[');
+    bool first = true;
+    for (auto &x : items) {
+        if (!first) w.put(',');
+        first = false;
+        put_json_string(w, x);
+    }
+    w.put(']');
+}
+
+bool is_empty_body(const RHS &rhs) { return rhs.empty() || rhs == RHS{ "&" }; }
+
+// The terminals 'tclass' folded into each representative (G.alias), the representative first.
+map<Symbol, vector<Symbol>> class_members(const Grammar &G) {
+    map<Symbol, vector<Symbol>> members;
+    for (auto &a : G.alias) {
+        auto &m = members[a.second];
+        if (m.empty()) m.push_back(a.second);
+        m.push_back(a.first);
+    }
+    return members;
+}
+
+// fn(body) for the body and every body with some representatives replaced by other members of their class.
+template <class F>
+void for_each_member_body(const RHS &rhs, const map<Symbol, vector<Symbol>> &members, F fn) {
+    vector<const vector<Symbol>*> choices(rhs.size(), nullptr);
+    bool any = false;
+    for (size_t i = 0; i < rhs.size(); ++i) {
+        auto it = members.find(rhs[i]);
+        if (it != members.end()) { choices[i] = &it->second; any = true; }
+    }
+    if (!any) { fn(rhs); return; }
+    vector<size_t> pick(rhs.size(), 0);
+    RHS body = rhs;
+    while (true) {
+        fn(body);
+        size_t i = 0;
+        for (; i < rhs.size(); ++i) {
+            if (!choices[i]) continue;
+            if (++pick[i] < choices[i]->size()) { body[i] = (*choices[i])[pick[i]]; break; }
+            pick[i] = 0;
+            body[i] = (*choices[i])[0];
+        }
+        if (i == rhs.size()) return;
+    }
+}
+}
+
+/// @brief Format of --output: --format=txt|jsonl, or from the file extension (.jsonl, otherwise txt).
+GrammarFormat grammar_format(const string &name, const string &filename) {
+    string f = to_lower_copy(name);
+    if (f.empty()) {
+        auto dot = filename.rfind('.');
+        f = dot != string::npos && to_lower_copy(filename.substr(dot + 1)) == "jsonl" ? "jsonl" : "txt";
+    }
+    if (f == "txt") return GrammarFormat::Text;
+    if (f == "jsonl") return GrammarFormat::JsonLines;
+    throw runtime_error("Formato de saída desconhecido: '" + name + "' (use txt ou jsonl)");
+}
+
+/// @brief Stream G to a file, production by production, through a BufferedWriter. Terminals merged by
+/// 'tclass' are written back: a body with a class representative is written once per member, so the file has
+/// the language of the grammar and not of its compressed alphabet.
+/// @param filename File to write.
+/// @param G Grammar to write.
+/// @param format txt (read back by read_grammar) or jsonl.
+/// @return Number of productions written.
+size_t write_grammar_file(const string &filename, const Grammar &G, GrammarFormat format) {
+    map<Symbol, vector<Symbol>> members = class_members(G);
+    set<Symbol> alphabet = G.T;
+    for (auto &a : G.alias) alphabet.insert(a.first);
+    set<Symbol> variables = G.V;
+    variables.insert(G.S); // useless removal leaves an empty V when the language is empty
+    BufferedWriter w(filename);
+    size_t written = 0;
+    if (format == GrammarFormat::JsonLines) {
+        w.put("{\"start\":");
+        put_json_string(w, G.S);
+        w.put(",\"variables\":");
+        put_json_list(w, variables);
+        w.put(",\"terminals\":");
+        put_json_list(w, alphabet);
+        w.put("}\n");
+        for (auto &A : G.V) {
+            auto pit = G.P.find(A);
+            if (pit == G.P.end()) continue;
+            auto wt = G.weight.find(A);
+            for (auto &rule : pit->second) for_each_member_body(rule, members, [&](const RHS &rhs) {
+                w.put("{\"lhs\":");
+                put_json_string(w, A);
+                w.put(",\"rhs\":[");
+                if (!is_empty_body(rhs))
+                    for (size_t i = 0; i < rhs.size(); ++i) {
+                        if (i) w.put(',');
+                        put_json_string(w, rhs[i]);
+                    }
+                w.put(']');
+                if (wt != G.weight.end()) {
+                    auto b = wt->second.find(rule);
+                    if (b != wt->second.end()) { w.put(",\"p\":"); w.put_number(b->second); }
+                }
+                w.put("}\n");
+                ++written;
+            });
+        }
+        w.close();
+        return written;
+    }
+
+    // txt: the bodies are written without separators, so each one is checked to split back the same way
+    auto unwritable = [&](const string &what) {
+        return runtime_error("A gramática não pode ser gravada no formato de entrada (" + what + "); use --format=jsonl.");
+    };
+    SymbolIndex vars_index, terms_index;
+    for (auto &X : variables) {
+        if (!writable_symbol(X)) throw unwritable("variável '" + X + "'");
+        vars_index.add(X);
+    }
+    for (auto &X : alphabet) {
+        if (!writable_symbol(X)) throw unwritable("terminal '" + X + "'");
+        terms_index.add(X);
+    }
+    auto put_list = [&](const char *title, const set<Symbol> &items) {
+        w.put(title);
+        w.put(" = {");
+        bool first = true;
+        for (auto &x : items) {
+            if (!first) w.put(", ");
+            first = false;
+            w.put(x);
+        }
+        w.put("}\n");
+    };
+    put_list("Variaveis", variables);
+    put_list("Alfabeto", alphabet);
+    w.put("Inicial = " + G.S + "\nRegras:\n");
+    string text;
+    for (auto &A : G.V) {
+        auto pit = G.P.find(A);
+        if (pit == G.P.end() || pit->second.empty()) continue;
+        auto wt = G.weight.find(A);
+        w.put(A);
+        w.put(" -> ");
+        bool first = true;
+        for (auto &rule : pit->second) for_each_member_body(rule, members, [&](const RHS &rhs) {
+            if (!first) w.put(" | ");
+            first = false;
+            if (is_empty_body(rhs)) {
+                w.put('&');
+            } else {
+                text.clear();
+                for (auto &X : rhs) text += X;
+                if (!splits_back(rhs, text, vars_index, terms_index)) throw unwritable("corpo ambíguo '" + text + "' de " + A);
+                w.put(text);
+            }
+            if (wt != G.weight.end()) {
+                auto b = wt->second.find(rule);
+                if (b != wt->second.end()) { w.put(" ["); w.put_number(b->second); w.put(']'); }
+            }
+            ++written;
+        });
+        w.put('\n');
+    }
+    w.close();
+    return written;
 }
@@ -11,6 +11,7 @@
 #include <map>
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <stdexcept>
 
 #include "utility.hpp"
@@ -21,11 +22,48 @@ using namespace std;
 
 
 void read_grammar(const string &filename, Grammar &G);
+GrammarDelta read_grammar_delta(const string &filename, const Grammar &G);
 string grammar_to_string(const Grammar &G);
+void write_grammar(ostream &out, const Grammar &G); // the text of grammar_to_string, streamed
+
+// Output file written through a fixed buffer that goes to the file each time it fills, so text produced
+// piece by piece is never held whole in memory.
+class BufferedWriter {
+public:
+    explicit BufferedWriter(const string &filename, size_t capacity = 1 << 20);
+    ~BufferedWriter();
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    void put(char c) {
+        if (used_ == buf_.size()) flush();
+        buf_[used_++] = c;
+    }
+    void put(const string &s);
+    void put_number(double x); // shortest text that reads back as x
+    void close();              // flush and close; throws on a write error
+
+private:
+    FILE *file_;
+    vector<char> buf_;
+    size_t used_ = 0;
+    string name_;
+    void flush();
+};
+
+// Machine-readable output of a grammar. txt: the input format of read_grammar (Variaveis, Alfabeto,
+// Inicial, Regras). jsonl: a header line {"start", "variables", "terminals"}, then one line per production,
+// {"lhs":"A","rhs":["a","B"]} (with "p" for weighted grammars). Variables in V order, productions in the order
+// of G.P, written while the grammar is walked; returns the number of productions. The terminals of G.alias are
+// written back in place of their class representative (one body per member).
+enum class GrammarFormat { Text, JsonLines };
+GrammarFormat grammar_format(const string &name, const string &filename);
+size_t write_grammar_file(const string &filename, const Grammar &G, GrammarFormat format);
 
 // Logger
 struct Logger {
     ofstream out;
+    bool enabled = true; // false: info/snapshot are no-ops (used when timing passes)
     Logger(const string &fname);
     void snapshot(const string &title, const Grammar &G);
     void info(const string &s);
@@ -0,0 +1,131 @@
+#include "ll1.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+/// @brief Build the LL(1) table from FIRST/FOLLOW; every cell claimed by two different bodies is a conflict.
+/// @param G Grammar in any form ('&' and empty bodies are ε).
+LL1Parser::LL1Parser(const Grammar &G) {
+    GrammarSets gs = compute_grammar_sets(G);
+    tc_ = compute_terminal_classes(G);
+    vars_ = gs.vars;
+    nv_ = gs.vars.size();
+    cols_ = tc_.count() + 1;
+    start_ = gs.var_id.count(G.S) ? gs.var_id.at(G.S) : 0;
+
+    // FIRST/FOLLOW terminal id -> table column; terminals of one class have the same column
+    size_t nt = gs.terms.size();
+    vector<uint32_t> column(nt + 1);
+    vector<Symbol> column_name(cols_, "$");
+    for (uint32_t t = 0; t < nt; ++t) {
+        column[t] = tc_.class_of[tc_.token_id.at(gs.terms[t])];
+        column_name[column[t]] = tc_.representative[column[t]];
+    }
+    column[nt] = (uint32_t)(cols_ - 1);
+
+    for (auto &pr : G.P) {
+        uint32_t A = gs.var_id.at(pr.first);
+        for (auto &rhs : pr.second) {
+            for (auto &X : rhs) {
+                if (X == "&") continue;
+                auto t = gs.term_id.find(X);
+                body_.push_back(t != gs.term_id.end() ? (uint32_t)(nv_ + column[t->second]) : gs.var_id.at(X));
+            }
+            head_.push_back(A);
+            boff_.push_back((uint32_t)body_.size());
+        }
+    }
+
+    table_.assign(nv_ * cols_, -1);
+    vector<uint64_t> predict(gs.follow.words);
+    vector<char> reported(nv_ * cols_, 0);
+    for (uint32_t p = 0; p < head_.size(); ++p) {
+        uint32_t A = head_[p];
+        // PREDICT = FIRST(body), plus FOLLOW(A) when the body is nullable
+        fill(predict.begin(), predict.end(), 0);
+        bool nullable = true;
+        for (uint32_t i = boff_[p]; i < boff_[p + 1] && nullable; ++i) {
+            uint32_t X = body_[i];
+            if (X >= nv_) {
+                uint32_t t = gs.term_id.at(tc_.representative[X - nv_]);
+                predict[t >> 6] |= 1ull << (t & 63);
+                nullable = false;
+            } else {
+                const uint64_t *f = gs.first.row(X);
+                for (size_t w = 0; w < gs.first.words; ++w) predict[w] |= f[w];
+                nullable = gs.nullable[X];
+            }
+        }
+        if (nullable) {
+            const uint64_t *f = gs.follow.row(A);
+            for (size_t w = 0; w < predict.size(); ++w) predict[w] |= f[w];
+        }
+        for (uint32_t t = 0; t <= nt; ++t) {
+            if (!(predict[t >> 6] >> (t & 63) & 1)) continue;
+            size_t cell = A * cols_ + column[t];
+            int32_t &entry = table_[cell];
+            if (entry < 0) { entry = (int32_t)p; continue; }
+            if (entry == (int32_t)p || reported[cell]) continue;
+            RHS a = body_symbols((uint32_t)entry), b = body_symbols(p);
+            if (a == b) continue; // duplicated production
+            reported[cell] = 1;
+            conflicts_.push_back({ vars_[A], column_name[column[t]], a, b });
+        }
+    }
+}
+
+RHS LL1Parser::body_symbols(uint32_t p) const {
+    RHS out;
+    for (uint32_t i = boff_[p]; i < boff_[p + 1]; ++i)
+        out.push_back(body_[i] < nv_ ? vars_[body_[i]] : tc_.representative[body_[i] - nv_]);
+    return out;
+}
+
+size_t LL1Parser::filled_entries() const {
+    return (size_t)count_if(table_.begin(), table_.end(), [](int32_t e){ return e >= 0; });
+}
+
+string LL1Parser::table_to_string() const {
+    ostringstream oss;
+    for (size_t A = 0; A < nv_; ++A) {
+        for (size_t c = 0; c < cols_; ++c) {
+            int32_t p = table_[A * cols_ + c];
+            if (p < 0) continue;
+            oss << vars_[A] << ", " << (c + 1 == cols_ ? string("$") : tc_.representative[c]) << ": " << vars_[A] << " ->";
+            RHS body = body_symbols((uint32_t)p);
+            if (body.empty()) oss << " &";
+            for (auto &X : body) oss << " " << X;
+            oss << "\n";
+        }
+    }
+    return oss.str();
+}
+
+/// @brief Table-driven LL(1) parse: one table lookup per expansion, one stack pop per matched token.
+/// @param tokens Token ids of the word (see tokenize).
+/// @return True if the start symbol derives the word.
+bool LL1Parser::accepts(const vector<uint32_t> &tokens) const {
+    const uint32_t end = (uint32_t)(cols_ - 1);
+    vector<uint32_t> stack{ start_ };
+    size_t pos = 0;
+    auto lookahead = [&]() -> uint32_t {
+        if (pos == tokens.size()) return end;
+        return tokens[pos] < tc_.class_of.size() ? tc_.class_of[tokens[pos]] : end + 1;
+    };
+    if (nv_ == 0) return false;
+    while (!stack.empty()) {
+        uint32_t X = stack.back();
+        stack.pop_back();
+        uint32_t a = lookahead();
+        if (a > end) return false;
+        if (X >= nv_) {
+            if (X - nv_ != a || a == end) return false;
+            ++pos;
+            continue;
+        }
+        int32_t p = table_[X * cols_ + a];
+        if (p < 0) return false;
+        for (uint32_t i = boff_[p + 1]; i-- > boff_[p];) stack.push_back(body_[i]);
+    }
+    return pos == tokens.size();
+}
@@ -0,0 +1,51 @@
+#ifndef LL1_HPP
+#define LL1_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "grammar.hpp"
+#include "grammar_sets.hpp"
+#include "terminal_classes.hpp"
+
+using namespace std;
+
+// Two productions of one variable predicted by the same lookahead.
+struct LL1Conflict {
+    Symbol var, lookahead; // lookahead "$" is the end of input
+    RHS first, second;
+};
+
+// Predictive parse table indexed by (variable, terminal class), plus a table-driven parser with an
+// explicit stack. Built for any grammar; accepts() is only meaningful when is_ll1().
+class LL1Parser {
+public:
+    explicit LL1Parser(const Grammar &G);
+
+    bool is_ll1() const { return conflicts_.empty(); }
+    const vector<LL1Conflict> &conflicts() const { return conflicts_; }
+
+    bool tokenize(const string &word, vector<uint32_t> &tokens) const { return tc_.tokenize(word, tokens); }
+    bool accepts(const vector<uint32_t> &tokens) const;
+
+    size_t variable_count() const { return nv_; }
+    size_t column_count() const { return cols_; }
+    size_t filled_entries() const;
+    const TerminalClasses &classes() const { return tc_; }
+    // One line per filled entry: "A, a: A -> body".
+    string table_to_string() const;
+
+private:
+    TerminalClasses tc_;
+    vector<Symbol> vars_;
+    size_t nv_ = 0, cols_ = 0;   // columns: terminal classes, then the end marker
+    uint32_t start_ = 0;
+    vector<uint32_t> head_, boff_{ 0 }, body_; // bodies: variable v -> v, class c -> nv_ + c
+    vector<int32_t> table_;      // nv_ * cols_ production indices, -1 = error
+    vector<LL1Conflict> conflicts_;
+
+    RHS body_symbols(uint32_t p) const;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "alloc_stats.hpp"
+
+using namespace std;
+
+/// @brief Split [0, n) into contiguous chunks and run fn(begin, end, worker) on up to `threads` threads.
+/// Chunks are assigned in order, so worker w always gets the w-th slice. The first exception thrown by a
+/// worker is rethrown in the caller after all workers have joined.
+template <class F>
+void parallel_for(size_t n, unsigned threads, F fn) {
+    if (threads <= 1 || n <= 1) {
+        if (n) fn((size_t)0, n, 0u);
+        return;
+    }
+    unsigned workers = (unsigned)min<size_t>(threads, n);
+    vector<thread> pool;
+    exception_ptr error;
+    mutex error_lock;
+    for (unsigned w = 0; w < workers; ++w) {
+        size_t begin = n * w / workers, end = n * (w + 1) / workers;
+        pool.emplace_back([&, begin, end, w]() {
+            try {
+                fn(begin, end, w);
+            } catch (...) {
+                lock_guard<mutex> g(error_lock);
+                if (!error) error = current_exception();
+            }
+            fold_alloc_stats(); // the thread's heap counts would be lost when it ends
+        });
+    }
+    for (auto &t : pool) t.join();
+    if (error) rethrow_exception(error);
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include "pass_manager.hpp"
+#include "passes.hpp"
+#include "terminal_classes.hpp"
+#include "regular.hpp"
+#include "utility.hpp"
+#include "alloc_stats.hpp"
+#include "components.hpp"
+
+#include <chrono>
+#include <map>
+#include <stdexcept>
+
+/// @brief All passes known to the tool, in the order they usually run.
+const vector<Pass> &pass_registry() {
+    static const vector<Pass> registry = {
+        { "eps", "remoção de regras-ε", AN_NULLABLE, AN_NULLABLE, epsilon_is_noop, remove_epsilon, true },
+        { "unit", "remoção de unit-productions", AN_UNIT_CLOSURE, AN_NULLABLE | AN_GENERATING, unit_is_noop, remove_unit_productions, true },
+        { "useless", "remoção de símbolos inúteis", AN_GENERATING | AN_REACHABLE, AN_GENERATING | AN_REACHABLE, useless_is_noop, remove_useless_symbols, true },
+        { "term", "substituição de terminais em produções longas", AN_NONE, AN_NULLABLE, long_terminals_is_noop, replace_terminals_in_long_productions, true },
+        { "bin", "binarização", AN_NONE, AN_NONE, binarize_is_noop, binarize, true },
+        { "bin-suffix", "binarização com sufixos compartilhados", AN_NONE, AN_NONE, binarize_is_noop, binarize_suffix_shared },
+        { "bin-pairs", "binarização com fatoração gulosa de pares", AN_NONE, AN_NONE, binarize_is_noop, binarize_greedy_pairs },
+        { "merge", "fusão de variáveis equivalentes", AN_NONE, AN_NONE, nullptr, merge_equivalent_variables },
+        { "leftrec", "eliminação de recursão à esquerda", AN_NONE, AN_NONE, left_recursion_is_noop, eliminate_left_recursion },
+        { "factor", "fatoração à esquerda", AN_NONE, AN_NONE, left_factor_is_noop, left_factor },
+        { "regular", "compilação de subgramáticas regulares em DFAs", AN_NONE, AN_NONE, nullptr, compile_regular_subgrammars },
+        { "tclass", "compressão do alfabeto em classes de terminais", AN_NONE, AN_ALL, nullptr, compress_terminal_classes },
+        { "gnf", "expansão de prefixos variáveis (GNF)", AN_NONE, AN_NONE, nullptr, greibach_expand },
+    };
+    return registry;
+}
+
+const Pass *find_pass(const string &name) {
+    for (auto &p : pass_registry()) if (p.name == name) return &p;
+    return nullptr;
+}
+
+/// @brief Build a pipeline from a spec like "eps,unit,useless,term,bin".
+/// @param spec Comma separated pass names; "cnf"/"gnf"/"2nf" expand to the default pipelines.
+/// @return Passes in execution order.
+vector<const Pass*> parse_pipeline(const string &spec) {
+    static const map<string, vector<string>> presets = {
+        { "cnf", { "eps", "unit", "useless", "term", "bin" } },
+        { "gnf", { "eps", "unit", "useless", "leftrec", "term", "gnf" } },
+        // binary normal form: keeps ε and unit productions, so the output stays linear in the input
+        { "2nf", { "useless", "bin" } },
+    };
+    vector<string> names;
+    split_tokens_list(spec, names);
+    vector<const Pass*> pipeline;
+    for (auto &n : names) {
+        string name = to_lower_copy(n);
+        vector<string> expanded = presets.count(name) ? presets.at(name) : vector<string>{ name };
+        for (auto &e : expanded) {
+            const Pass *p = find_pass(e);
+            if (!p) throw runtime_error("Etapa desconhecida no pipeline: '" + n + "'");
+            pipeline.push_back(p);
+        }
+    }
+    return pipeline;
+}
+
+string pipeline_to_string(const vector<const Pass*> &pipeline) {
+    string s;
+    for (auto *p : pipeline) {
+        if (!s.empty()) s += ",";
+        s += p->name;
+    }
+    return s;
+}
+
+/// @brief Run the passes in order, skipping the ones whose no-op check holds and keeping analyses cached between them.
+/// @param G Grammar rewritten in place.
+/// @param pipeline Passes to run.
+/// @param ctx Shared logger, analysis cache and budget (BudgetExceeded stops the run inside the pass); on_pass,
+/// when set, gets a PassReport per pass.
+void run_pipeline(Grammar &G, const vector<const Pass*> &pipeline, PassContext &ctx) {
+    ctx.log.info("Pipeline: " + pipeline_to_string(pipeline));
+    ctx.analyses.threads = ctx.threads;
+    if (ctx.budget.enabled()) ctx.log.info("Limites: " + ctx.budget.describe() + ".");
+    if (ctx.log.enabled) ctx.log.info("Grafo de dependências: " + components_summary(decompose_grammar(G)) + ".");
+    auto count_productions = [&]() {
+        size_t n = 0;
+        for (auto &pr : G.P) n += pr.second.size();
+        return n;
+    };
+    for (auto *p : pipeline) {
+        int hits = ctx.analyses.hits, misses = ctx.analyses.misses;
+        double analyses_ms = ctx.analyses.ms;
+        PassReport report;
+        report.pass = p;
+        if (ctx.on_pass) report.productions_in = count_productions();
+        // the no-op check computes analyses, so it already counts against the pass
+        reset_alloc_peak();
+        AllocStats before = alloc_stats();
+        auto t0 = chrono::steady_clock::now();
+        auto send = [&](const string &status, const string &error) {
+            if (!ctx.on_pass) return;
+            report.status = status;
+            report.error = error;
+            report.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            report.analyses_ms = ctx.analyses.ms - analyses_ms;
+            report.productions_out = count_productions();
+            report.peak = alloc_stats().peak - before.live;
+            ctx.on_pass(report);
+        };
+        try {
+            ctx.budget.begin_pass(p->name, G);
+            if (p->is_noop && p->is_noop(G, ctx)) {
+                ctx.log.info("Etapa '" + p->name + "' (" + p->description + ") ignorada: nada a fazer.\n");
+                send("skipped", "");
+                continue;
+            }
+            if (!G.weight.empty() && !p->keeps_weights)
+                throw runtime_error("Etapa '" + p->name + "' não propaga as probabilidades das regras (use eps, unit, useless, term e bin).");
+            p->run(G, ctx);
+            ctx.analyses.invalidate(p->preserves);
+            ctx.budget.end_pass(G);
+        } catch (const BudgetExceeded &e) {
+            send("aborted", e.what());
+            throw;
+        } catch (const exception &e) {
+            send("error", e.what());
+            throw;
+        }
+        AllocStats after = alloc_stats();
+        ctx.log.info("Análises em '" + p->name + "': " + to_string(ctx.analyses.hits - hits) + " reutilizada(s) do cache, "
+                     + to_string(ctx.analyses.misses - misses) + " calculada(s).");
+        ctx.log.info("Memória em '" + p->name + "': " + to_string(after.allocations - before.allocations) + " alocações ("
+                     + format_bytes(after.bytes - before.bytes) + "), pico " + format_bytes(after.peak)
+                     + " (antes " + format_bytes(before.live) + ", depois " + format_bytes(after.live) + ").\n");
+        send("ok", "");
+    }
+}
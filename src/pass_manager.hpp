@@ -0,0 +1,63 @@
+#ifndef PASS_MANAGER_HPP
+#define PASS_MANAGER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "grammar.hpp"
+#include "analyses.hpp"
+#include "rhs_pool.hpp"
+#include "io_handling.hpp"
+#include "dfa.hpp"
+#include "budget.hpp"
+
+using namespace std;
+
+struct Pass;
+
+// One pass as run_pipeline saw it, for callers that time or record the passes (PassContext::on_pass).
+struct PassReport {
+    const Pass *pass = nullptr;
+    string status;   // ok, skipped (no-op check held), aborted (BudgetExceeded) or error
+    string error;    // what() of the exception that stopped the pass
+    double ms = 0;   // no-op check, analyses it computed and the pass itself
+    double analyses_ms = 0; // part of ms spent computing analyses (misses of PassContext::analyses)
+    size_t productions_in = 0, productions_out = 0;
+    size_t peak = 0; // heap high-water mark above what was live when the pass started
+};
+
+// State shared by all passes of one pipeline run.
+struct PassContext {
+    Logger &log;
+    AnalysisCache analyses;
+    RhsPool pool; // bodies interned by every pass of the run
+    unsigned threads = 1; // workers for the passes that split their work per variable
+    vector<SuperTerminal> super_terminals; // terminals standing for regular sub-grammars (pass 'regular')
+    Budget budget; // limits of the run (--limit), checked inside the passes
+    // Called after every pass, and for a pass that throws before the exception leaves run_pipeline.
+    function<void(const PassReport &)> on_pass;
+
+    explicit PassContext(Logger &l) : log(l) { analyses.budget = &budget; }
+};
+
+struct Pass {
+    string name;        // nome usado na linha de comando (--passes=...)
+    string description;
+    unsigned uses;      // analyses the pass reads (AN_*)
+    unsigned preserves; // analyses still valid after the pass (AN_*)
+    bool (*is_noop)(const Grammar &G, PassContext &ctx); // may be null: pass always runs
+    void (*run)(Grammar &G, PassContext &ctx);
+    bool keeps_weights = false; // carries rule probabilities (Grammar::weight) through
+};
+
+const vector<Pass> &pass_registry();
+const Pass *find_pass(const string &name);
+
+// Accepts a comma separated list of pass names; "cnf", "gnf" and "2nf" expand to their default pipelines.
+vector<const Pass*> parse_pipeline(const string &spec);
+string pipeline_to_string(const vector<const Pass*> &pipeline);
+
+void run_pipeline(Grammar &G, const vector<const Pass*> &pipeline, PassContext &ctx);
+
+#endif
@@ -0,0 +1,1114 @@
+#include <bits/stdc++.h>
+#include "passes.hpp"
+#include "parallel.hpp"
+#include "grammar_sets.hpp"
+#include "weights.hpp"
+
+using namespace std;
+
+
+// Per-worker scratch space of the ε expansion.
+struct EpsWorker {
+    RhsPool local; // bodies seen by this worker (parallel runs only)
+    IdMarks seen;
+    vector<SymId> ids, newids;
+    vector<int> nullablePos;
+    vector<RhsId> accum;
+};
+
+// Replace the productions of one variable by all their variants with nullable symbols dropped.
+// Symbols are looked up (never added) in `symbols`; bodies are interned in `bodies`. Each variant is one
+// unit of work for the budget, so a body with many nullable symbols is stopped while it is expanded.
+static void expand_nullable(SymId aid, vector<RHS> &list, const vector<char> &is_nullable,
+                            const RhsPool &symbols, RhsPool &bodies, EpsWorker &w, Budget &budget) {
+    vector<RHS> old = std::move(list);
+    list.clear();
+    w.seen.clear();
+    w.accum.clear();
+    long long old_symbols = 0;
+    for (auto &rhs : old) old_symbols += (long long)rhs.size();
+    budget.grow(-(long long)old.size(), -old_symbols);
+    for (auto &rhs : old) {
+        if (rhs.empty()) {
+            // explicit epsilon: dropped (the start S0 created by remove_epsilon keeps its '&' production)
+            continue;
+        }
+        // find positions that are nullable
+        w.ids.clear();
+        w.nullablePos.clear();
+        for (size_t i=0;i<rhs.size();++i) {
+            SymId id = 0;
+            symbols.find(rhs[i], id);
+            w.ids.push_back(id);
+            if (id < is_nullable.size() && is_nullable[id]) w.nullablePos.push_back((int)i);
+        }
+        // enumerate subsets of nullable positions
+        int m = (int)w.nullablePos.size();
+        if (m >= 64) throw runtime_error("Remoção de regras-ε: corpo com " + to_string(m) + " símbolos anuláveis (2^" + to_string(m) + " variantes).");
+        uint64_t combos = (uint64_t)1 << m;
+        for (uint64_t mask = 0; mask < combos; ++mask) {
+            budget.tick();
+            w.newids.clear();
+            for (size_t i = 0, j = 0; i < w.ids.size(); ++i) {
+                bool remove = j < (size_t)m && (int)i == w.nullablePos[j] && ((mask >> j) & 1);
+                if (j < (size_t)m && (int)i == w.nullablePos[j]) ++j;
+                if (!remove) w.newids.push_back(w.ids[i]);
+            }
+            // all symbols removed: ε, which is dropped
+            if (w.newids.empty()) continue;
+            // If newrhs becomes [A] (single symbol same as LHS), skip to avoid self unit-production A->A
+            if (w.newids.size()==1 && w.newids[0] == aid) continue;
+            RhsId r = bodies.intern_ids(w.newids);
+            if (w.seen.insert(r)) {
+                w.accum.push_back(r);
+                budget.grow(1, (long long)w.newids.size());
+            }
+        }
+    }
+    // distinct bodies in order of first occurrence
+    list.reserve(w.accum.size());
+    for (RhsId r : w.accum) list.push_back(symbols.to_rhs(bodies.body(r)));
+}
+
+/// @brief The productions remove_epsilon gives one variable, for callers that update a variable at a time.
+/// @param A Variable (its A -> A variants are dropped).
+/// @param rules Productions of A before the pass.
+/// @param nullable Nullable variables of the grammar.
+/// @param budget Limits checked while the variants are expanded.
+vector<RHS> epsilon_free_productions(const Symbol &A, const vector<RHS> &rules, const set<Symbol> &nullable,
+                                     Budget &budget) {
+    RhsPool pool;
+    vector<char> is_nullable;
+    SymId aid = pool.intern(A);
+    for (auto &rhs : rules)
+        for (auto &X : rhs) {
+            SymId id = pool.intern(X);
+            if (!nullable.count(X)) continue;
+            if (id >= is_nullable.size()) is_nullable.resize(id + 1, 0);
+            is_nullable[id] = 1;
+        }
+    vector<RHS> list = rules;
+    EpsWorker w;
+    expand_nullable(aid, list, is_nullable, pool, pool, w, budget);
+    return list;
+}
+
+// Remove epsilon-productions (fixed, safe). Preserves language; introduces new start S0 if original start nullable.
+void remove_epsilon(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Remoção de regras-ε: início.");
+    auto nullable = ctx.analyses.nullable(G);
+    log.info("Variáveis nulas (nullable):");
+    for (auto &x : nullable) log.info("  " + x);
+
+    bool start_nullable = nullable.count(G.S);
+    Symbol originalStart = G.S;
+    if (start_nullable) {
+        // create new start symbol S0 not colliding
+        Symbol S0;
+        int k = 0;
+        do { S0 = originalStart + "_S0_" + to_string(++k); } while (G.V.count(S0));
+        G.V.insert(S0);
+        // add S0 -> originalStart and S0 -> &
+        G.P[S0].push_back(RHS{ originalStart });
+        G.P[S0].push_back(RHS{"&"});
+        G.S = S0;
+        log.info("Start era nullable: criado novo start '" + S0 + "' com " + S0 + "->" + originalStart + " e " + S0 + "->&");
+    }
+
+    // probabilities of the bodies written below, taken from the grammar as read
+    map<Symbol, map<RHS, double>> weights;
+    if (!G.weight.empty()) weights = epsilon_free_weights(G, nullable, start_nullable ? G.S : Symbol(), originalStart, ctx.budget);
+
+    // Bodies are handled as interned ids: duplicates are found by id and only the distinct ones
+    // are turned back into symbol vectors. Every symbol is interned up front so that workers only read
+    // the shared symbol table.
+    RhsPool &pool = ctx.pool;
+    vector<char> is_nullable;
+    for (auto &x : nullable) {
+        SymId id = pool.intern(x);
+        if (id >= is_nullable.size()) is_nullable.resize(id + 1, 0);
+        is_nullable[id] = 1;
+    }
+    vector<SymId> var_ids;
+    vector<vector<RHS>*> lists;
+    for (auto &A : G.V) {
+        var_ids.push_back(pool.intern(A));
+        lists.push_back(&G.P[A]);
+        for (auto &rhs : *lists.back()) for (auto &X : rhs) pool.intern(X);
+    }
+
+    // Each variable's new productions depend only on its own productions and the nullable set,
+    // so the lists are rewritten in place, each by exactly one worker. With several workers the
+    // bodies are deduplicated in a worker-local pool; the result does not depend on the worker count.
+    unsigned threads = ctx.threads;
+    vector<EpsWorker> workers(max(1u, threads));
+    parallel_for(lists.size(), threads, [&](size_t begin, size_t end, unsigned w) {
+        RhsPool &bodies = threads > 1 ? workers[w].local : pool;
+        for (size_t v = begin; v < end; ++v)
+            expand_nullable(var_ids[v], *lists[v], is_nullable, pool, bodies, workers[w], ctx.budget);
+    });
+
+    if (!G.weight.empty()) {
+        G.weight = std::move(weights);
+        normalize_weights(G);
+    }
+    // only the new start (S0 -> &) can still derive ε
+    ctx.analyses.set_nullable(start_nullable ? set<Symbol>{ G.S } : set<Symbol>{});
+
+    log.info("Remoção de regras-ε: finalizada.");
+    log.snapshot("Após remoção de ε-productions", G);
+}
+
+// Remove unit-productions A -> B (single nonterminal)
+void remove_unit_productions(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Remoção de unit-productions: início.");
+    // unit closures (cached by the pass manager)
+    const auto &closure = ctx.analyses.unit_closure(G);
+    auto is_unit = [&](const RHS &rhs) { return rhs.size() == 1 && !G.isTerminal(rhs[0]); };
+    map<Symbol, map<RHS, double>> weights;
+    if (!G.weight.empty()) weights = unit_free_weights(G, closure);
+    // every non-unit production is interned once; merging closures is then a union of id sets
+    RhsPool &pool = ctx.pool;
+    map<Symbol, vector<RhsId>> bodies;
+    for (auto &pr : G.P) {
+        auto &ids = bodies[pr.first];
+        for (auto &rhs : pr.second) if (!is_unit(rhs)) ids.push_back(pool.intern(rhs));
+    }
+    // Variables whose closure is just themselves keep their own non-unit productions, deduplicated in place.
+    // The others get merged copies of the productions of their closure, built into per-variable slots
+    // before anything is moved. Each variable is handled by one worker; the slots are then merged in V order,
+    // so the result does not depend on the worker count.
+    vector<const Symbol*> vars;
+    for (auto &A : G.V) vars.push_back(&A);
+    vector<vector<RHS>*> lists;
+    for (auto &A : G.V) lists.push_back(&G.P[A]);
+    vector<vector<RHS>> merged(vars.size());
+    vector<char> has_merged(vars.size(), 0);
+    unsigned threads = ctx.threads;
+    vector<IdMarks> marks(max(1u, threads));
+    const RhsPool &bodies_pool = pool;
+    parallel_for(vars.size(), threads, [&](size_t begin, size_t end, unsigned w) {
+        IdMarks &seen = marks[w];
+        vector<RhsId> acc;
+        for (size_t v = begin; v < end; ++v) {
+            const Symbol &A = *vars[v];
+            auto &cl = closure.at(A);
+            if (cl.size() > 1) {
+                seen.clear();
+                acc.clear();
+                for (auto &B : cl) {
+                    ctx.budget.tick();
+                    auto it = bodies.find(B);
+                    if (it == bodies.end()) continue;
+                    for (RhsId r : it->second) if (seen.insert(r)) acc.push_back(r);
+                }
+                auto &out = merged[v];
+                out.reserve(acc.size());
+                long long symbols = 0;
+                for (RhsId r : acc) {
+                    out.push_back(bodies_pool.to_rhs(r));
+                    symbols += (long long)out.back().size();
+                }
+                for (auto &rhs : *lists[v]) symbols -= (long long)rhs.size();
+                ctx.budget.grow((long long)acc.size() - (long long)lists[v]->size(), symbols);
+                has_merged[v] = 1;
+                continue;
+            }
+            // drop unit productions and duplicates, keeping the first occurrence
+            auto &list = *lists[v];
+            auto bit = bodies.find(A);
+            seen.clear();
+            size_t k = 0, out = 0;
+            for (size_t i = 0; i < list.size(); ++i) {
+                if (is_unit(list[i])) continue;
+                if (seen.insert(bit->second[k++])) {
+                    if (out != i) list[out] = std::move(list[i]);
+                    ++out;
+                }
+            }
+            list.resize(out);
+        }
+    });
+    for (size_t v = 0; v < vars.size(); ++v)
+        if (has_merged[v]) *lists[v] = std::move(merged[v]);
+    // variables outside V or left without productions are dropped, as before
+    for (auto it = G.P.begin(); it != G.P.end();) {
+        if (!G.V.count(it->first) || it->second.empty()) it = G.P.erase(it);
+        else ++it;
+    }
+    if (!G.weight.empty()) {
+        G.weight = std::move(weights);
+        normalize_weights(G);
+    }
+    log.info("Remoção de unit-productions: finalizada.");
+    log.snapshot("Após remoção de unit-productions", G);
+}
+
+/// @brief The productions remove_unit_productions gives one variable: the non-unit productions of its unit
+/// closure, in closure order, each body once.
+/// @param G Grammar before the pass.
+/// @param closure Unit closure of the variable (itself included).
+vector<RHS> unit_free_productions(const Grammar &G, const set<Symbol> &closure) {
+    vector<RHS> out;
+    set<RHS> seen;
+    for (auto &B : closure) {
+        auto it = G.P.find(B);
+        if (it == G.P.end()) continue;
+        for (auto &rhs : it->second)
+            if (!(rhs.size() == 1 && !G.isTerminal(rhs[0])) && seen.insert(rhs).second) out.push_back(rhs);
+    }
+    return out;
+}
+
+// Remove useless symbols (non-generating and non-reachable)
+void remove_useless_symbols(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Remoção de símbolos inúteis: início.");
+    // generating variables: those that derive a string of terminals
+    set<Symbol> gen = ctx.analyses.generating(G);
+    log.info("Geradores:");
+    for (auto &x : gen) log.info("  " + x);
+    // if every variable generates, the grammar is untouched and a cached reachable set still holds
+    bool all_generating = gen.size() == G.V.size();
+
+    // remove productions that contain non-generating variables
+    for (auto it = G.P.begin(); it != G.P.end();) {
+        if (!gen.count(it->first)) { it = G.P.erase(it); continue; }
+        auto &vec = it->second;
+        vec.erase(remove_if(vec.begin(), vec.end(), [&](const RHS &r){
+            for (auto &X : r) if (!G.isTerminal(X) && !gen.count(X)) return true;
+            return false;
+        }), vec.end());
+        ++it;
+    }
+    // keep only V that are generating
+    set<Symbol> newV;
+    for (auto &x : gen) newV.insert(x);
+    G.V = newV;
+
+    // reachable from start
+    set<Symbol> reach = all_generating ? ctx.analyses.reachable(G) : compute_reachable(G, &ctx.budget);
+    log.info("Alcançáveis:");
+    for (auto &x : reach) log.info("  " + x);
+
+    // intersection
+    set<Symbol> finalV;
+    for (auto &x : G.V) if (reach.count(x)) finalV.insert(x);
+    G.V = finalV;
+    // remove productions with LHS not in V
+    for (auto it = G.P.begin(); it != G.P.end();) {
+        if (!G.V.count(it->first)) it = G.P.erase(it);
+        else ++it;
+    }
+
+    // the probability of the dropped bodies goes to the others
+    normalize_weights(G);
+    // every remaining variable is generating and reachable
+    ctx.analyses.set_generating(G.V);
+    ctx.analyses.set_reachable(G.V);
+
+    log.info("Remoção de símbolos inúteis: finalizada.");
+    log.snapshot("Após remoção de símbolos inúteis", G);
+}
+
+// Highest k such that prefix + k (decimal) is already a variable; fresh names start after it.
+static size_t max_suffix_index(const set<Symbol> &V, const string &prefix) {
+    size_t best = 0;
+    for (auto it = V.lower_bound(prefix); it != V.end() && it->compare(0, prefix.size(), prefix) == 0; ++it) {
+        const string &name = *it;
+        if (name.size() == prefix.size() || name.size() - prefix.size() > 18) continue;
+        bool digits = all_of(name.begin() + prefix.size(), name.end(), [](char c){ return c >= '0' && c <= '9'; });
+        if (digits) best = max(best, (size_t)stoull(name.substr(prefix.size())));
+    }
+    return best;
+}
+
+// Replace terminals in RHS length >=2 with variables deriving them: an existing variable whose only
+// production is that terminal when there is one, a fresh T_k otherwise
+void replace_terminals_in_long_productions(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Substituição de terminais em produções longas: início.");
+    // dense ids for the terminals ('&' included, as isTerminal does)
+    vector<Symbol> terms(G.T.begin(), G.T.end());
+    if (!G.T.count("&")) terms.push_back("&");
+    unordered_map<Symbol, uint32_t> tid;
+    for (uint32_t t = 0; t < terms.size(); ++t) tid.emplace(terms[t], t);
+
+    // variables that already derive exactly one terminal (first one in V order wins)
+    vector<Symbol> termVar(terms.size());
+    vector<char> reused(terms.size(), 0);
+    vector<Symbol> vars(G.V.begin(), G.V.end());
+    vector<vector<RHS>*> lists(vars.size(), nullptr);
+    for (size_t v = 0; v < vars.size(); ++v) {
+        auto it = G.P.find(vars[v]);
+        if (it == G.P.end()) continue;
+        lists[v] = &it->second;
+        auto &list = it->second;
+        if (list.size() != 1 || list[0].size() != 1 || list[0][0] == "&") continue;
+        auto t = tid.find(list[0][0]);
+        if (t != tid.end() && termVar[t->second].empty()) {
+            termVar[t->second] = vars[v];
+            reused[t->second] = 1;
+        }
+    }
+    unsigned threads = ctx.threads;
+
+    // 1) one pass over the long bodies: each worker records, for its contiguous slice, the terminals in
+    //    order of first occurrence and the positions to patch
+    struct Slice {
+        vector<uint32_t> firsts;
+        vector<pair<Symbol*, uint32_t>> patches;
+    };
+    vector<Slice> slices(max(1u, threads));
+    parallel_for(vars.size(), threads, [&](size_t begin, size_t end, unsigned w) {
+        Slice &sl = slices[w];
+        vector<char> seen(terms.size(), 0);
+        for (size_t v = begin; v < end; ++v) {
+            if (!lists[v]) continue;
+            for (auto &rhs : *lists[v]) {
+                if (rhs.size() < 2) continue;
+                for (auto &X : rhs) {
+                    auto t = tid.find(X);
+                    if (t == tid.end()) continue;
+                    if (!seen[t->second]) { seen[t->second] = 1; sl.firsts.push_back(t->second); }
+                    sl.patches.emplace_back(&X, t->second);
+                }
+            }
+        }
+    });
+
+    // 2) fresh names in order of first occurrence over all slices
+    vector<uint32_t> created;
+    size_t used_reuse = 0;
+    vector<char> used(terms.size(), 0);
+    int cnt = 0;
+    for (auto &sl : slices) {
+        for (uint32_t t : sl.firsts) {
+            if (used[t]) continue;
+            used[t] = 1;
+            if (reused[t]) { ++used_reuse; continue; }
+            Symbol Vn;
+            do { Vn = "T_" + to_string(++cnt); } while (G.V.count(Vn));
+            termVar[t] = Vn;
+            created.push_back(t);
+        }
+    }
+
+    // 3) patch the recorded positions
+    parallel_for(slices.size(), threads, [&](size_t begin, size_t end, unsigned) {
+        for (size_t w = begin; w < end; ++w)
+            for (auto &pt : slices[w].patches) *pt.first = termVar[pt.second];
+    });
+
+    for (uint32_t t : created) {
+        G.V.insert(termVar[t]);
+        G.P[termVar[t]].push_back(RHS{ terms[t] });
+    }
+    if (!G.weight.empty()) {
+        // same substitution on the weighted bodies; the new T_k -> t get probability 1
+        rekey_weights(G, [&](RHS &rhs) {
+            if (rhs.size() < 2) return;
+            for (auto &X : rhs) {
+                auto t = tid.find(X);
+                if (t != tid.end()) X = termVar[t->second];
+            }
+        });
+        normalize_weights(G);
+    }
+    log.info("Terminais substituídos: " + to_string(created.size() + used_reuse) + "; variáveis existentes reutilizadas: "
+             + to_string(used_reuse) + "; variáveis novas: " + to_string(created.size()) + ".");
+    log.info("Substituição de terminais em produções longas: finalizada.");
+    log.snapshot("Após substituição de terminais em produções longas", G);
+}
+
+// Binarize RHS length > 2
+void binarize(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Binarização: início.");
+    vector<Symbol> vars(G.V.begin(), G.V.end());
+    vector<vector<RHS>*> lists(vars.size(), nullptr);
+    for (size_t v = 0; v < vars.size(); ++v) {
+        auto it = G.P.find(vars[v]);
+        if (it != G.P.end()) lists[v] = &it->second;
+    }
+    // probabilities of each variable, rekeyed by the worker that rewrites its bodies
+    vector<map<RHS, double>*> weights(vars.size(), nullptr);
+    for (size_t v = 0; v < vars.size(); ++v) {
+        auto it = G.weight.find(vars[v]);
+        if (it != G.weight.end()) weights[v] = &it->second;
+    }
+    unsigned threads = ctx.threads;
+
+    // 1) a RHS of length m needs m-2 fresh variables; prefix sums over V order give every variable
+    //    its own range of N_ numbers, so names do not depend on how the work is split
+    vector<size_t> base(vars.size() + 1, 0);
+    parallel_for(vars.size(), threads, [&](size_t begin, size_t end, unsigned) {
+        for (size_t v = begin; v < end; ++v) {
+            size_t k = 0;
+            if (lists[v]) for (auto &rhs : *lists[v]) if (rhs.size() > 2) k += rhs.size() - 2;
+            base[v + 1] = k;
+        }
+    });
+    for (size_t v = 0; v < vars.size(); ++v) base[v + 1] += base[v];
+    size_t first = max_suffix_index(G.V, "N_");
+
+    // 2) rewrite each variable in place; chain productions of fresh variables go to a per-worker buffer
+    vector<vector<pair<Symbol, RHS>>> fresh(max(1u, threads));
+    parallel_for(vars.size(), threads, [&](size_t begin, size_t end, unsigned w) {
+        auto &out = fresh[w];
+        for (size_t v = begin; v < end; ++v) {
+            if (!lists[v]) continue;
+            size_t next = first + base[v];
+            vector<RHS> old = std::move(*lists[v]);
+            lists[v]->clear();
+            map<RHS, double> rekeyed;
+            auto weight = [&](const RHS &rhs) {
+                auto it = weights[v]->find(rhs);
+                return it == weights[v]->end() ? 0.0 : it->second;
+            };
+            for (auto &rhs : old) {
+                if (rhs.size() <= 2) {
+                    if (weights[v]) rekeyed[rhs] = weight(rhs);
+                    lists[v]->push_back(std::move(rhs));
+                    continue;
+                }
+                double w = weights[v] ? weight(rhs) : 0.0;
+                // create chain
+                // A -> X0 Y1
+                // Y1 -> X1 Y2
+                // ...
+                // Yk -> Xk-1 Xk
+                size_t m = rhs.size();
+                ctx.budget.grow((long long)m - 2, (long long)m - 2);
+                Symbol Y = "N_" + to_string(++next);
+                lists[v]->push_back(RHS{ std::move(rhs[0]), Y });
+                if (weights[v]) rekeyed[lists[v]->back()] = w;
+                for (size_t i = 1; i + 2 < m; ++i) {
+                    Symbol Yn = "N_" + to_string(++next);
+                    out.emplace_back(Y, RHS{ std::move(rhs[i]), Yn });
+                    Y = std::move(Yn);
+                }
+                // last two
+                out.emplace_back(std::move(Y), RHS{ std::move(rhs[m-2]), std::move(rhs[m-1]) });
+            }
+            if (weights[v]) weights[v]->swap(rekeyed);
+        }
+    });
+
+    // 3) merge the buffers in worker order
+    for (auto &out : fresh) {
+        for (auto &pr : out) {
+            G.V.insert(pr.first);
+            G.P[pr.first].push_back(std::move(pr.second));
+        }
+    }
+    // variables outside V or without productions are dropped, as before
+    for (auto it = G.P.begin(); it != G.P.end();) {
+        if (!G.V.count(it->first) || it->second.empty()) it = G.P.erase(it);
+        else ++it;
+    }
+    // the chain variables get probability 1
+    normalize_weights(G);
+    log.info("Binarização: finalizada.");
+    log.snapshot("Após binarização (CNF-ready)", G);
+}
+
+// Give every suffix of length >= 2 of the long bodies one variable, named N_k in order of first use:
+// A -> X0 [X1..Xm-1], [Xi..Xm-1] -> Xi [Xi+1..Xm-1], [Xm-2 Xm-1] -> Xm-2 Xm-1.
+// Returns how many variables were created.
+static size_t binarize_shared_suffixes(Grammar &G, PassContext &ctx) {
+    RhsPool &pool = ctx.pool;
+    size_t next = max_suffix_index(G.V, "N_");
+    unordered_map<RhsId, Symbol> suffixVar;
+    vector<pair<Symbol, RHS>> fresh;
+    vector<SymId> ids;
+
+    // variable deriving exactly ids[from..], created on first use
+    auto var_for = [&](size_t from) -> Symbol {
+        RhsId key = pool.intern_ids(ids.data() + from, ids.size() - from);
+        auto it = suffixVar.find(key);
+        if (it != suffixVar.end()) return it->second;
+        Symbol Y = "N_" + to_string(++next);
+        suffixVar.emplace(key, Y);
+        // the rest of the chain is shared as well
+        Symbol tail = ids.size() - from > 2 ? Symbol() : pool.symbol(ids.back());
+        fresh.emplace_back(Y, RHS{ pool.symbol(ids[from]), tail });
+        return Y;
+    };
+
+    for (auto &A : vector<Symbol>(G.V.begin(), G.V.end())) {
+        auto it = G.P.find(A);
+        if (it == G.P.end()) continue;
+        for (auto &rhs : it->second) {
+            if (rhs.size() <= 2) continue;
+            ids.clear();
+            for (auto &X : rhs) ids.push_back(pool.intern(X));
+            // walk from the shortest suffix so that each chain link already knows its tail
+            Symbol tail = var_for(ids.size() - 2);
+            for (size_t i = ids.size() - 3; i >= 1; --i) {
+                size_t before = fresh.size();
+                Symbol Y = var_for(i);
+                if (fresh.size() != before) fresh.back().second[1] = tail;
+                tail = Y;
+            }
+            rhs = RHS{ std::move(rhs[0]), tail };
+        }
+    }
+    for (auto &pr : fresh) {
+        G.V.insert(pr.first);
+        G.P[pr.first].push_back(std::move(pr.second));
+    }
+    return fresh.size();
+}
+
+// Number of fresh variables the plain chain binarization would create.
+static size_t chain_variables(const Grammar &G) {
+    size_t n = 0;
+    for (auto &pr : G.P)
+        for (auto &rhs : pr.second) if (rhs.size() > 2) n += rhs.size() - 2;
+    return n;
+}
+
+// Binarize RHS length > 2 sharing one variable per distinct suffix
+void binarize_suffix_shared(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Binarização com sufixos compartilhados: início.");
+    size_t chain = chain_variables(G);
+    size_t created = binarize_shared_suffixes(G, ctx);
+    log.info("Variáveis novas: " + to_string(created) + " (a binarização em cadeia criaria " + to_string(chain) + ").");
+    log.info("Binarização com sufixos compartilhados: finalizada.");
+    log.snapshot("Após binarização com sufixos compartilhados (CNF-ready)", G);
+}
+
+// Greedy pair factoring: the adjacent pair occurring most often in bodies longer than two symbols becomes
+// a variable N_k -> X Y and is replaced everywhere, until no pair repeats; the rest is binarized
+// with shared suffixes.
+void binarize_greedy_pairs(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Binarização com fatoração gulosa de pares: início.");
+    RhsPool &pool = ctx.pool;
+    size_t chain = chain_variables(G);
+
+    // long bodies as symbol ids
+    vector<vector<SymId>> seqs;
+    vector<RHS*> owners;
+    for (auto &pr : G.P)
+        for (auto &rhs : pr.second) {
+            if (rhs.size() <= 2) continue;
+            vector<SymId> ids;
+            for (auto &X : rhs) ids.push_back(pool.intern(X));
+            seqs.push_back(std::move(ids));
+            owners.push_back(&rhs);
+        }
+
+    size_t next = max_suffix_index(G.V, "N_");
+    size_t pairs = 0;
+    auto key = [](SymId a, SymId b) { return ((uint64_t)a << 32) | b; };
+    while (true) {
+        ctx.budget.tick();
+        // non-overlapping occurrences of each pair
+        unordered_map<uint64_t, size_t> count;
+        for (auto &seq : seqs) {
+            if (seq.size() <= 2) continue;
+            uint64_t last = ~0ull;
+            size_t last_pos = 0;
+            for (size_t i = 0; i + 1 < seq.size(); ++i) {
+                uint64_t k = key(seq[i], seq[i+1]);
+                if (k == last && last_pos + 1 == i) continue;
+                ++count[k];
+                last = k;
+                last_pos = i;
+            }
+        }
+        uint64_t best = 0;
+        size_t best_count = 1;
+        for (auto &kc : count)
+            if (kc.second > best_count || (kc.second == best_count && kc.first < best)) {
+                best = kc.first;
+                best_count = kc.second;
+            }
+        if (best_count < 2) break;
+
+        SymId a = (SymId)(best >> 32), b = (SymId)(best & 0xFFFFFFFFu);
+        Symbol Y = "N_" + to_string(++next);
+        SymId y = pool.intern(Y);
+        G.V.insert(Y);
+        G.P[Y].push_back(RHS{ pool.symbol(a), pool.symbol(b) });
+        ++pairs;
+        for (auto &seq : seqs) {
+            if (seq.size() <= 2) continue;
+            size_t out = 0;
+            for (size_t i = 0; i < seq.size(); ++i) {
+                // never shrink a body below two symbols (that would be a unit production)
+                if (i + 1 < seq.size() && seq[i] == a && seq[i+1] == b && seq.size() - (i - out) > 2) {
+                    seq[out++] = y;
+                    ++i;
+                } else {
+                    seq[out++] = seq[i];
+                }
+            }
+            seq.resize(out);
+        }
+    }
+    for (size_t i = 0; i < seqs.size(); ++i) *owners[i] = pool.to_rhs(pool.intern_ids(seqs[i]));
+
+    size_t created = pairs + binarize_shared_suffixes(G, ctx);
+    log.info("Pares fatorados: " + to_string(pairs) + "; variáveis novas: " + to_string(created)
+             + " (a binarização em cadeia criaria " + to_string(chain) + ").");
+    log.info("Binarização com fatoração gulosa de pares: finalizada.");
+    log.snapshot("Após binarização com fatoração de pares (CNF-ready)", G);
+}
+
+// Size of the grammar as (variables, productions).
+static pair<size_t, size_t> grammar_size(const Grammar &G) {
+    size_t prods = 0;
+    for (auto &pr : G.P) prods += pr.second.size();
+    return { G.V.size(), prods };
+}
+
+// Merge nonterminals with identical production sets (partition refinement up to a fixpoint).
+// Variables start in one block; a block is split by the set of bodies of its members with every
+// variable replaced by its block, until no block splits. Members of a block derive the same language.
+void merge_equivalent_variables(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Fusão de variáveis equivalentes: início.");
+    auto before = grammar_size(G);
+    RhsPool &pool = ctx.pool;
+
+    vector<Symbol> vars(G.V.begin(), G.V.end());
+    unordered_map<Symbol, uint32_t> index;
+    for (uint32_t v = 0; v < vars.size(); ++v) index.emplace(vars[v], v);
+    // bodies with variables as (index << 1 | 1) and terminals as (pool id << 1)
+    vector<vector<vector<uint32_t>>> bodies(vars.size());
+    for (uint32_t v = 0; v < vars.size(); ++v) {
+        auto it = G.P.find(vars[v]);
+        if (it == G.P.end()) continue;
+        for (auto &rhs : it->second) {
+            vector<uint32_t> enc;
+            for (auto &X : rhs) {
+                auto vi = index.find(X);
+                enc.push_back(vi != index.end() ? (vi->second << 1 | 1) : (pool.intern(X) << 1));
+            }
+            bodies[v].push_back(std::move(enc));
+        }
+    }
+
+    vector<uint32_t> block(vars.size(), 0);
+    size_t blocks = vars.empty() ? 0 : 1;
+    int rounds = 0;
+    while (true) {
+        ctx.budget.tick();
+        ++rounds;
+        RhsPool bodyPool, sigPool; // ids of bodies modulo blocks, and of sets of them
+        map<pair<uint32_t, RhsId>, uint32_t> split;
+        vector<uint32_t> next(vars.size());
+        vector<SymId> sig, tmp;
+        for (uint32_t v = 0; v < vars.size(); ++v) {
+            sig.clear();
+            for (auto &enc : bodies[v]) {
+                tmp.clear();
+                for (uint32_t x : enc) tmp.push_back((x & 1) ? (block[x >> 1] << 1 | 1) : x);
+                sig.push_back(bodyPool.intern_ids(tmp));
+            }
+            sort(sig.begin(), sig.end());
+            sig.erase(unique(sig.begin(), sig.end()), sig.end());
+            auto key = make_pair(block[v], sigPool.intern_ids(sig));
+            auto it = split.emplace(key, (uint32_t)split.size()).first;
+            next[v] = it->second;
+        }
+        block.swap(next);
+        if (split.size() == blocks) break;
+        blocks = split.size();
+    }
+
+    // representative: the start symbol if it is in the block, otherwise the first member in V order
+    vector<int> rep(blocks, -1);
+    auto startIt = index.find(G.S);
+    if (startIt != index.end()) rep[block[startIt->second]] = (int)startIt->second;
+    for (uint32_t v = 0; v < vars.size(); ++v) if (rep[block[v]] < 0) rep[block[v]] = (int)v;
+
+    size_t merged = 0;
+    for (uint32_t v = 0; v < vars.size(); ++v) {
+        if (rep[block[v]] == (int)v) continue;
+        G.V.erase(vars[v]);
+        G.P.erase(vars[v]);
+        ++merged;
+    }
+    if (merged) {
+        IdMarks seen;
+        for (auto &pr : G.P) {
+            seen.clear();
+            size_t out = 0;
+            auto &list = pr.second;
+            for (size_t i = 0; i < list.size(); ++i) {
+                for (auto &X : list[i]) {
+                    auto vi = index.find(X);
+                    if (vi != index.end()) X = vars[rep[block[vi->second]]];
+                }
+                if (!seen.insert(pool.intern(list[i]))) continue;
+                if (out != i) list[out] = std::move(list[i]);
+                ++out;
+            }
+            list.resize(out);
+        }
+    }
+
+    auto after = grammar_size(G);
+    log.info("Rodadas de refinamento: " + to_string(rounds) + "; variáveis fundidas: " + to_string(merged) + ".");
+    log.info("Tamanho: " + to_string(before.first) + " -> " + to_string(after.first) + " variáveis, "
+             + to_string(before.second) + " -> " + to_string(after.second) + " produções.");
+    log.info("Fusão de variáveis equivalentes: finalizada.");
+    log.snapshot("Após fusão de variáveis equivalentes", G);
+}
+
+// Fresh variable base + k, with k the smallest number that gives an unused name.
+static Symbol fresh_variable(const Grammar &G, const string &base) {
+    size_t k = 0;
+    Symbol name;
+    do { name = base + to_string(++k); } while (G.V.count(name) || G.T.count(name));
+    return name;
+}
+
+// Drop repeated bodies of a list, keeping the first occurrence.
+static void dedupe_bodies(vector<RHS> &list, RhsPool &pool) {
+    IdMarks seen;
+    size_t out = 0;
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (!seen.insert(pool.intern(list[i]))) continue;
+        if (out != i) list[out] = std::move(list[i]);
+        ++out;
+    }
+    list.resize(out);
+}
+
+// One round of left factoring of A: every group of bodies with the same first symbol becomes
+// A -> αA_Fk, α the group's longest common prefix, A_Fk -> the remainders. With eps_free the prefix
+// stays shorter than every body of the group, so no A_Fk -> ε is created (groups that would need one
+// are kept). Returns the new variables.
+static vector<Symbol> factor_bodies(Grammar &G, const Symbol &A, RhsPool &pool, bool eps_free) {
+    vector<Symbol> created;
+    auto &list = G.P[A];
+    dedupe_bodies(list, pool);
+    // bodies grouped by first symbol, groups in order of first occurrence (ε bodies stay alone)
+    map<Symbol, vector<size_t>> by_first;
+    for (size_t i = 0; i < list.size(); ++i)
+        if (!list[i].empty() && list[i] != RHS{"&"}) by_first[list[i][0]].push_back(i);
+    // common prefix of each group, 0 when the group is left alone
+    map<Symbol, size_t> prefix;
+    for (auto &g : by_first) {
+        size_t lcp = 0;
+        if (g.second.size() > 1) {
+            const RHS &b0 = list[g.second[0]];
+            lcp = b0.size();
+            for (size_t k : g.second) {
+                size_t l = 0;
+                while (l < lcp && l < list[k].size() && list[k][l] == b0[l]) ++l;
+                if (eps_free && l == list[k].size()) --l;
+                lcp = l;
+            }
+        }
+        prefix[g.first] = lcp;
+    }
+    vector<RHS> next;
+    vector<char> taken(list.size(), 0);
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (taken[i]) continue;
+        bool eps = list[i].empty() || list[i] == RHS{"&"};
+        size_t lcp = eps ? 0 : prefix[list[i][0]];
+        if (lcp == 0) { next.push_back(std::move(list[i])); continue; }
+        const auto &group = by_first[list[i][0]];
+        Symbol F = fresh_variable(G, A + "_F");
+        G.V.insert(F);
+        created.push_back(F);
+        RHS head(list[i].begin(), list[i].begin() + lcp);
+        head.push_back(F);
+        vector<RHS> rest;
+        for (size_t k : group) {
+            rest.emplace_back(list[k].begin() + lcp, list[k].end());
+            taken[k] = 1;
+        }
+        next.push_back(std::move(head));
+        G.P[F] = std::move(rest);
+    }
+    G.P[A] = std::move(next);
+    return created;
+}
+
+// Factor A and every variable created for it until no two bodies start alike.
+static size_t factor_fully(Grammar &G, const Symbol &A, RhsPool &pool, bool eps_free) {
+    deque<Symbol> work{ A };
+    size_t created = 0;
+    while (!work.empty()) {
+        auto fresh = factor_bodies(G, work.front(), pool, eps_free);
+        work.pop_front();
+        created += fresh.size();
+        work.insert(work.end(), fresh.begin(), fresh.end());
+    }
+    return created;
+}
+
+// Remove left recursion one component of the left-corner graph at a time: Paull's algorithm over the
+// members of each recursive component (in name order), the rest of the grammar is not touched. Direct
+// recursion of A becomes the ε-free form A -> β | βA', A' -> α | αA'. A component where some body
+// starts with a nullable variable hides its recursion behind ε and is left as it is (run 'eps' first).
+void eliminate_left_recursion(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Eliminação de recursão à esquerda: início.");
+    auto before = grammar_size(G);
+    GrammarSets gs = compute_grammar_sets(G);
+    map<uint32_t, vector<Symbol>> components;
+    for (uint32_t A = 0; A < gs.vars.size(); ++A)
+        if (gs.left_recursive[A]) components[gs.lc_comp[A]].push_back(gs.vars[A]);
+
+    auto nullable_var = [&](const Symbol &X) {
+        auto it = gs.var_id.find(X);
+        return it != gs.var_id.end() && gs.nullable[it->second];
+    };
+    size_t done = 0, skipped = 0, created = 0;
+    for (auto &c : components) {
+        auto &members = c.second;
+        sort(members.begin(), members.end());
+        bool hidden = false;
+        for (auto &A : members) {
+            auto it = G.P.find(A);
+            if (it == G.P.end()) continue;
+            for (auto &rhs : it->second) hidden |= !rhs.empty() && nullable_var(rhs[0]);
+        }
+        if (hidden) {
+            string names;
+            for (auto &A : members) names += (names.empty() ? "" : ", ") + A;
+            log.info("  {" + names + "}: recursão através de variável anulável, componente ignorada (rode 'eps' antes).");
+            ++skipped;
+            continue;
+        }
+        ++done;
+        // factoring common prefixes first keeps the substitutions from multiplying bodies
+        for (auto &A : members) created += factor_fully(G, A, ctx.pool, true);
+        for (size_t i = 0; i < members.size(); ++i) {
+            const Symbol &Ai = members[i];
+            auto &list = G.P[Ai];
+            // substitute leading Aj, j < i: the bodies of Aj no longer start with any Ak, k <= j
+            for (size_t j = 0; j < i; ++j) {
+                vector<RHS> next;
+                for (auto &rhs : list) {
+                    if (rhs.empty() || rhs[0] != members[j]) { next.push_back(std::move(rhs)); continue; }
+                    long long symbols = -(long long)rhs.size();
+                    for (auto &delta : G.P[members[j]]) {
+                        RHS r;
+                        r.reserve(delta.size() + rhs.size() - 1);
+                        for (auto &X : delta) if (X != "&") r.push_back(X);
+                        r.insert(r.end(), rhs.begin() + 1, rhs.end());
+                        symbols += (long long)r.size();
+                        next.push_back(std::move(r));
+                    }
+                    ctx.budget.grow((long long)G.P[members[j]].size() - 1, symbols);
+                }
+                list = std::move(next);
+            }
+            if (i > 0) created += factor_fully(G, Ai, ctx.pool, true);
+            // direct recursion: A -> Aα (A -> A is dropped) and A -> β
+            vector<RHS> alphas, betas;
+            for (auto &rhs : list) {
+                if (rhs.empty() || rhs[0] != Ai) betas.push_back(std::move(rhs));
+                else if (rhs.size() > 1) alphas.emplace_back(rhs.begin() + 1, rhs.end());
+            }
+            list.clear();
+            if (alphas.empty()) {
+                list = std::move(betas);
+                dedupe_bodies(list, ctx.pool);
+                continue;
+            }
+            Symbol R = fresh_variable(G, Ai + "_L");
+            G.V.insert(R);
+            ++created;
+            for (auto &b : betas) {
+                list.push_back(b);
+                b.push_back(R);
+                list.push_back(std::move(b));
+            }
+            auto &tail = G.P[R];
+            for (auto &a : alphas) {
+                tail.push_back(a);
+                a.push_back(R);
+                tail.push_back(std::move(a));
+            }
+            dedupe_bodies(list, ctx.pool);
+            dedupe_bodies(tail, ctx.pool);
+        }
+    }
+
+    auto after = grammar_size(G);
+    GrammarSets check = compute_grammar_sets(G);
+    size_t left = (size_t)count(check.left_recursive.begin(), check.left_recursive.end(), 1);
+    log.info("Componentes tratadas: " + to_string(done) + "; ignoradas: " + to_string(skipped)
+             + "; variáveis novas: " + to_string(created) + "; recursivas à esquerda restantes: " + to_string(left) + ".");
+    log.info("Tamanho: " + to_string(before.first) + " -> " + to_string(after.first) + " variáveis, "
+             + to_string(before.second) + " -> " + to_string(after.second) + " produções.");
+    log.info("Eliminação de recursão à esquerda: finalizada.");
+    log.snapshot("Após eliminação de recursão à esquerda", G);
+}
+
+// Left factoring of every variable: bodies that start with the same symbol become A -> αA',
+// α their longest common prefix and A' -> the remainders (possibly ε).
+void left_factor(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Fatoração à esquerda: início.");
+    auto before = grammar_size(G);
+    vector<Symbol> vars;
+    for (auto &pr : G.P) vars.push_back(pr.first);
+    size_t groups = 0;
+    for (auto &A : vars) groups += factor_fully(G, A, ctx.pool, false);
+    auto after = grammar_size(G);
+    log.info("Grupos fatorados (variáveis novas): " + to_string(groups) + ".");
+    log.info("Tamanho: " + to_string(before.first) + " -> " + to_string(after.first) + " variáveis, "
+             + to_string(before.second) + " -> " + to_string(after.second) + " produções.");
+    log.info("Fatoração à esquerda: finalizada.");
+    log.snapshot("Após fatoração à esquerda", G);
+}
+
+// Minimal practical GNF attempt (kept simple): expands leading variables by a fixed variable order
+void greibach_expand(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Início do processo prático para GNF (Greibach Normal Form - Forma Normal de Greibach).\n");
+
+    std::vector<std::string> vars;
+    vars.reserve(G.P.size());
+    for (auto &p : G.P) vars.push_back(p.first);
+
+    if (vars.empty()) {
+        log.info("Nenhum não-terminal encontrado. Nada a ordenar.\n");
+        return;
+    }
+
+    // 2. Ordenar alfabeticamente (ABCD..., ou S,A,B,C se S vem primeiro)
+    std::sort(vars.begin(), vars.end());
+
+    std::map<std::string, int> order_index;
+    int cnt = 0;
+    for(auto& v : vars) {
+        order_index[v] = cnt++;
+    }
+
+
+    log.info("Ordem escolhida para variáveis:");
+    for (auto &v : vars) log.info("  " + v);
+    log.info("");
+    log.snapshot("Após order_variables (GNF)", G);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (auto &p : G.P) {
+            const Symbol &A = p.first;
+            auto &rhs_list = p.second;
+
+            // prefix + rest of rhs, built once at its final size
+            auto expand = [](const RHS &prefix, const RHS &rhs) {
+                RHS expanded;
+                expanded.reserve(prefix.size() + rhs.size() - 1);
+                expanded.insert(expanded.end(), prefix.begin(), prefix.end());
+                expanded.insert(expanded.end(), rhs.begin() + 1, rhs.end());
+                return expanded;
+            };
+
+            std::vector<RHS> new_list;
+            new_list.reserve(rhs_list.size());
+            for (auto &rhs : rhs_list) {
+                // ε (only possible when a custom pipeline skipped 'eps')
+                if (rhs.empty()) { new_list.push_back(std::move(rhs)); continue; }
+
+                const Symbol &X = rhs[0];
+
+                auto px = G.P.find(X);
+                if(px != G.P.end() && px->second.size() == 1 && G.isTerminal(px->second[0][0]) ) {
+                    new_list.push_back(expand(px->second[0], rhs));
+                    continue;
+                }
+
+                // se começa com variável, expandir
+                if (!G.isTerminal(X) && order_index[X] < order_index[A]) {
+                    changed = true;
+                    const auto &prods_of_X = G.P[X];
+                    long long symbols = -(long long)rhs.size();
+                    for (const RHS &prod_of_X : prods_of_X) {
+                        new_list.push_back(expand(prod_of_X, rhs));
+                        symbols += (long long)new_list.back().size();
+                    }
+                    ctx.budget.grow((long long)prods_of_X.size() - 1, symbols);
+                } else {
+                    new_list.push_back(std::move(rhs));
+                }
+            }
+
+            rhs_list = std::move(new_list);
+        }
+    }
+    log.snapshot("Após eliminação de prefixos variáveis (GNF)", G);
+}
+
+
+/// @brief ε-removal has nothing to do when no variable is nullable, or only a start symbol that never appears on a RHS.
+bool epsilon_is_noop(const Grammar &G, PassContext &ctx) {
+    const auto &nullable = ctx.analyses.nullable(G);
+    if (nullable.empty()) return true;
+    if (nullable.size() != 1 || !nullable.count(G.S)) return false;
+    for (auto &pr : G.P)
+        for (auto &rhs : pr.second)
+            for (auto &X : rhs) if (X == G.S) return false;
+    return true;
+}
+
+/// @brief True when there is no production A -> B with B a variable.
+bool unit_is_noop(const Grammar &G, PassContext &) {
+    for (auto &pr : G.P)
+        for (auto &rhs : pr.second)
+            if (rhs.size() == 1 && !G.isTerminal(rhs[0])) return false;
+    return true;
+}
+
+/// @brief True when every variable is generating and reachable (uses the cached analyses).
+bool useless_is_noop(const Grammar &G, PassContext &ctx) {
+    const auto &gen = ctx.analyses.generating(G);
+    if (gen.size() != G.V.size()) return false;
+    const auto &reach = ctx.analyses.reachable(G);
+    for (auto &A : G.V) if (!reach.count(A)) return false;
+    for (auto &pr : G.P) if (!G.V.count(pr.first)) return false;
+    return true;
+}
+
+/// @brief True when no RHS of length >= 2 contains a terminal.
+bool long_terminals_is_noop(const Grammar &G, PassContext &) {
+    for (auto &pr : G.P)
+        for (auto &rhs : pr.second) {
+            if (rhs.size() < 2) continue;
+            for (auto &X : rhs) if (G.isTerminal(X)) return false;
+        }
+    return true;
+}
+
+/// @brief True when no RHS is longer than two symbols.
+bool binarize_is_noop(const Grammar &G, PassContext &) {
+    for (auto &pr : G.P)
+        for (auto &rhs : pr.second)
+            if (rhs.size() > 2) return false;
+    return true;
+}
+
+/// @brief True when no variable is left-recursive (directly or through other variables).
+bool left_recursion_is_noop(const Grammar &G, PassContext &) {
+    GrammarSets gs = compute_grammar_sets(G);
+    return find(gs.left_recursive.begin(), gs.left_recursive.end(), 1) == gs.left_recursive.end();
+}
+
+/// @brief True when no two bodies of a variable start with the same symbol.
+bool left_factor_is_noop(const Grammar &G, PassContext &) {
+    for (auto &pr : G.P) {
+        set<Symbol> firsts;
+        for (auto &rhs : pr.second)
+            if (!rhs.empty() && rhs != RHS{"&"} && !firsts.insert(rhs[0]).second) return false;
+    }
+    return true;
+}
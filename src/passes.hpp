@@ -0,0 +1,36 @@
+#ifndef PASSES_HPP
+#define PASSES_HPP
+
+#include "grammar.hpp"
+#include "pass_manager.hpp"
+
+using namespace std;
+
+// Normalization passes. Each one rewrites G in place and logs a snapshot.
+void remove_epsilon(Grammar &G, PassContext &ctx);
+void remove_unit_productions(Grammar &G, PassContext &ctx);
+void remove_useless_symbols(Grammar &G, PassContext &ctx);
+void replace_terminals_in_long_productions(Grammar &G, PassContext &ctx);
+void binarize(Grammar &G, PassContext &ctx);
+void binarize_suffix_shared(Grammar &G, PassContext &ctx);
+void binarize_greedy_pairs(Grammar &G, PassContext &ctx);
+void merge_equivalent_variables(Grammar &G, PassContext &ctx);
+void eliminate_left_recursion(Grammar &G, PassContext &ctx);
+void left_factor(Grammar &G, PassContext &ctx);
+void greibach_expand(Grammar &G, PassContext &ctx);
+
+// What remove_epsilon and remove_unit_productions give a single variable (incremental updates).
+vector<RHS> epsilon_free_productions(const Symbol &A, const vector<RHS> &rules, const set<Symbol> &nullable,
+                                     Budget &budget);
+vector<RHS> unit_free_productions(const Grammar &G, const set<Symbol> &closure);
+
+// Cheap checks used by the pass manager to skip passes with nothing to do.
+bool epsilon_is_noop(const Grammar &G, PassContext &ctx);
+bool unit_is_noop(const Grammar &G, PassContext &ctx);
+bool useless_is_noop(const Grammar &G, PassContext &ctx);
+bool long_terminals_is_noop(const Grammar &G, PassContext &ctx);
+bool binarize_is_noop(const Grammar &G, PassContext &ctx);
+bool left_recursion_is_noop(const Grammar &G, PassContext &ctx);
+bool left_factor_is_noop(const Grammar &G, PassContext &ctx);
+
+#endif
@@ -0,0 +1,343 @@
+#include "pcfg.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+const float NEG = -numeric_limits<float>::infinity();
+const size_t LANES = 8;
+
+// max over m of a[m] + b[m]
+inline float max_plus(const float *a, const float *b, size_t len) {
+    float lane[LANES];
+    for (size_t l = 0; l < LANES; ++l) lane[l] = NEG;
+    size_t m = 0;
+    for (; m + LANES <= len; m += LANES)
+        for (size_t l = 0; l < LANES; ++l) {
+            float x = a[m + l] + b[m + l];
+            lane[l] = lane[l] < x ? x : lane[l];
+        }
+    float best = NEG;
+    for (; m < len; ++m) {
+        float x = a[m] + b[m];
+        best = best < x ? x : best;
+    }
+    for (size_t l = 0; l < LANES; ++l) best = best < lane[l] ? lane[l] : best;
+    return best;
+}
+
+// sum over m of a[m] * b[m] * f[m]
+inline float dot3(const float *a, const float *b, const float *f, size_t len) {
+    float lane[LANES] = {};
+    size_t m = 0;
+    for (; m + LANES <= len; m += LANES)
+        for (size_t l = 0; l < LANES; ++l) lane[l] += a[m + l] * b[m + l] * f[m + l];
+    float sum = 0;
+    for (; m < len; ++m) sum += a[m] * b[m] * f[m];
+    for (size_t l = 0; l < LANES; ++l) sum += lane[l];
+    return sum;
+}
+}
+
+/// @brief Index the rules of a CNF grammar by (B, C) pair and by token.
+/// @param G Grammar in CNF (A -> B C, A -> a, and S -> & only if S is in no body), with or without
+/// probabilities.
+PcfgParser::PcfgParser(const Grammar &G) : tc_(compute_terminal_classes(G)) {
+    unordered_map<Symbol, uint32_t> id;
+    for (auto &A : G.V) {
+        id.emplace(A, (uint32_t)nv_++);
+        vars_.push_back(A);
+    }
+    start_ = id.count(G.S) ? (int)id.at(G.S) : -1;
+    auto not_cnf = [&](const Symbol &A) {
+        return runtime_error("Produção de '" + A + "' fora da CNF: a análise probabilística exige a gramática em CNF (use --passes=cnf).");
+    };
+    auto probability = [&](const Symbol &A, const RHS &rhs) {
+        if (G.weight.empty()) return 1.0 / G.P.at(A).size();
+        auto w = G.weight.find(A);
+        if (w == G.weight.end()) return 0.0;
+        auto b = w->second.find(rhs);
+        return b == w->second.end() ? 0.0 : b->second;
+    };
+    vector<tuple<uint32_t, uint32_t, uint32_t, double>> bins; // (B, C, A, p)
+    vector<vector<pair<uint32_t, double>>> lex(tc_.tokens.size());
+    for (auto &pr : G.P) {
+        auto a = id.find(pr.first);
+        if (a == id.end()) continue;
+        uint32_t A = a->second;
+        for (auto &rhs : pr.second) {
+            double p = probability(pr.first, rhs);
+            if (rhs.empty() || rhs == RHS{ "&" }) {
+                if ((int)A != start_) throw not_cnf(pr.first);
+                start_empty_ += p;
+            } else if (rhs.size() == 1 && G.isTerminal(rhs[0]) && tc_.token_id.count(rhs[0])) {
+                if (p > 0) lex[tc_.token_id.at(rhs[0])].emplace_back(A, p);
+            } else if (rhs.size() == 2 && id.count(rhs[0]) && id.count(rhs[1])) {
+                if (p > 0) bins.emplace_back(id.at(rhs[0]), id.at(rhs[1]), A, p);
+            } else {
+                throw not_cnf(pr.first);
+            }
+        }
+    }
+
+    sort(bins.begin(), bins.end());
+    left_off_.assign(nv_ + 1, 0);
+    by_head_.assign(nv_, {});
+    for (size_t r = 0; r < bins.size(); ++r) {
+        uint32_t B, C, A;
+        double p;
+        tie(B, C, A, p) = bins[r];
+        if (r == 0 || get<0>(bins[r - 1]) != B || get<1>(bins[r - 1]) != C) {
+            head_off_.push_back((uint32_t)heads_.size());
+            pair_left_.push_back(B);
+            pair_right_.push_back(C);
+            ++left_off_[B + 1];
+        }
+        by_head_[A].push_back((uint32_t)heads_.size());
+        head_pair_.push_back((uint32_t)pair_left_.size() - 1);
+        heads_.push_back(A);
+        head_log_.push_back((float)log(p));
+        head_prob_.push_back((float)p);
+    }
+    head_off_.push_back((uint32_t)heads_.size());
+    for (size_t B = 0; B < nv_; ++B) left_off_[B + 1] += left_off_[B];
+
+    lex_off_.push_back(0);
+    for (uint32_t t = 0; t < lex.size(); ++t) {
+        for (auto &ap : lex[t]) {
+            lex_heads_.push_back(ap.first);
+            lex_log_.push_back((float)log(ap.second));
+            lex_prob_.push_back((float)ap.second);
+            lex_token_.push_back(t);
+        }
+        lex_off_.push_back((uint32_t)lex_heads_.size());
+    }
+}
+
+string PcfgParser::rule_name(size_t r) const {
+    if (r < heads_.size()) {
+        uint32_t p = head_pair_[r];
+        return vars_[heads_[r]] + " -> " + vars_[pair_left_[p]] + " " + vars_[pair_right_[p]];
+    }
+    r -= heads_.size();
+    return vars_[lex_heads_[r]] + " -> '" + tc_.tokens[lex_token_[r]] + "'";
+}
+
+// Best derivation of A over [i, j): the split and rule whose score is the chart's (the same float
+// sums as in parse, so the maximum is found again exactly).
+void PcfgParser::viterbi_tree(const PcfgChart &c, const vector<uint32_t> &tokens, uint32_t A, size_t i, size_t j,
+                              string &out) const {
+    size_t s = c.stride;
+    out += "(" + vars_[A] + " ";
+    if (j == i + 1) {
+        out += tc_.tokens[tokens[i]] + ")";
+        return;
+    }
+    float best = NEG;
+    uint32_t bh = 0;
+    size_t bm = i + 1;
+    for (uint32_t h : by_head_[A]) {
+        uint32_t p = head_pair_[h];
+        uint32_t rl = c.start_row[pair_left_[p] * s + i], rr = c.end_row[pair_right_[p] * s + j];
+        if (rl == PcfgChart::NO_ROW || rr == PcfgChart::NO_ROW) continue;
+        for (size_t m = i + 1; m < j; ++m) {
+            float x = (c.best_by_start[rl * s + m] + c.best_by_end[rr * s + m]) + head_log_[h];
+            if (x > best) { best = x; bh = h; bm = m; }
+        }
+    }
+    uint32_t p = head_pair_[bh];
+    viterbi_tree(c, tokens, pair_left_[p], i, bm, out);
+    out += " ";
+    viterbi_tree(c, tokens, pair_right_[p], bm, j, out);
+    out += ")";
+}
+
+/// @brief Viterbi and inside (and outside with `counts`) over one sentence.
+/// @param tokens Token ids (tokenize).
+/// @param chart Scratch space, reused.
+/// @param counts Expected rule uses are added here (rule_count() entries), or null.
+/// Outside values are kept as b(A, i, j) = outside(A, i, j) * factor(i, j) / P(sentence), whose product
+/// with the scaled inside value is the posterior of (A, i, j); they are doubles, since a rarely used
+/// variable can have a large one.
+PcfgParse PcfgParser::parse(const vector<uint32_t> &tokens, PcfgChart &c, vector<double> *counts) const {
+    const uint32_t NO_ROW = PcfgChart::NO_ROW;
+    const double NEG_LOG = -numeric_limits<double>::infinity();
+    PcfgParse res;
+    size_t n = tokens.size();
+    res.length = n;
+    if (start_ < 0) return res;
+    for (uint32_t t : tokens) if (t + 1 >= lex_off_.size()) return res;
+    if (n == 0) {
+        if (start_empty_ > 0) {
+            res.parsed = true;
+            res.log_prob = res.best_log_prob = log(start_empty_);
+            res.tree = "(" + vars_[start_] + " &)";
+        }
+        return res;
+    }
+    size_t s = n + 1;
+    c.stride = s;
+    c.start_row.assign(nv_ * s, NO_ROW);
+    c.end_row.assign(nv_ * s, NO_ROW);
+    c.starting.resize(s);
+    for (auto &v : c.starting) v.clear();
+    c.best_by_start.clear();
+    c.best_by_end.clear();
+    c.in_by_start.clear();
+    c.in_by_end.clear();
+    c.scale.assign(s * s, NEG_LOG);
+    c.span_best.assign(nv_, NEG);
+    c.span_in.assign(nv_, 0.0f);
+    c.touched.clear();
+    c.factor.resize(n);
+    c.ratio.resize(n);
+
+    auto add = [&](uint32_t A, float best, float in) {
+        if (c.span_best[A] == NEG) c.touched.push_back(A);
+        c.span_best[A] = max(c.span_best[A], best);
+        c.span_in[A] += in;
+    };
+    auto row = [&](vector<uint32_t> &index, size_t key, vector<float> &best, vector<float> &in) {
+        uint32_t &r = index[key];
+        if (r == NO_ROW) {
+            r = (uint32_t)(best.size() / s);
+            best.resize(best.size() + s, NEG);
+            in.resize(in.size() + s, 0.0f);
+        }
+        return r;
+    };
+    // copy the span into both layouts, inside values scaled so that the largest is 1
+    auto finish = [&](size_t i, size_t j, double S) {
+        float top = 0;
+        for (uint32_t A : c.touched) top = max(top, c.span_in[A]);
+        if (top > 0) c.scale[i * s + j] = S + log((double)top);
+        for (uint32_t A : c.touched) {
+            if (c.start_row[A * s + i] == NO_ROW) c.starting[i].push_back(A);
+            uint32_t rs = row(c.start_row, A * s + i, c.best_by_start, c.in_by_start);
+            uint32_t re = row(c.end_row, A * s + j, c.best_by_end, c.in_by_end);
+            c.best_by_start[rs * s + j] = c.best_by_end[re * s + i] = c.span_best[A];
+            float v = top > 0 ? c.span_in[A] / top : 0.0f;
+            c.in_by_start[rs * s + j] = c.in_by_end[re * s + i] = v;
+            c.span_best[A] = NEG;
+            c.span_in[A] = 0;
+        }
+        c.touched.clear();
+    };
+
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t t = tokens[i];
+        for (uint32_t r = lex_off_[t]; r < lex_off_[t + 1]; ++r) add(lex_heads_[r], lex_log_[r], lex_prob_[r]);
+        finish(i, i + 1, 0.0);
+    }
+    for (size_t len = 2; len <= n; ++len)
+        for (size_t i = 0; i + len <= n; ++i) {
+            size_t j = i + len, lo = i + 1, L = len - 1;
+            // common factor of the split points, so that the scaled products stay in float range
+            double S = NEG_LOG;
+            for (size_t m = lo; m < j; ++m) S = max(S, c.scale[i * s + m] + c.scale[m * s + j]);
+            if (S == NEG_LOG) continue;
+            for (size_t m = lo; m < j; ++m) c.factor[m - lo] = (float)exp(c.scale[i * s + m] + c.scale[m * s + j] - S);
+            for (uint32_t B : c.starting[i]) {
+                size_t rl = (size_t)c.start_row[B * s + i] * s + lo;
+                const float *bl = &c.best_by_start[rl], *il = &c.in_by_start[rl];
+                for (uint32_t p = left_off_[B]; p < left_off_[B + 1]; ++p) {
+                    uint32_t rr = c.end_row[pair_right_[p] * s + j];
+                    if (rr == NO_ROW) continue;
+                    const float *br = &c.best_by_end[(size_t)rr * s + lo], *ir = &c.in_by_end[(size_t)rr * s + lo];
+                    float vb = max_plus(bl, br, L);
+                    if (vb == NEG) continue;
+                    float vi = dot3(il, ir, c.factor.data(), L);
+                    for (uint32_t h = head_off_[p]; h < head_off_[p + 1]; ++h)
+                        add(heads_[h], vb + head_log_[h], vi * head_prob_[h]);
+                }
+            }
+            finish(i, j, S);
+        }
+
+    uint32_t root_row = c.start_row[(size_t)start_ * s];
+    if (root_row == NO_ROW || c.best_by_start[(size_t)root_row * s + n] == NEG) return res;
+    float root_in = c.in_by_start[(size_t)root_row * s + n];
+    res.parsed = true;
+    res.best_log_prob = c.best_by_start[(size_t)root_row * s + n];
+    res.log_prob = c.scale[n] + log((double)root_in);
+    viterbi_tree(c, tokens, (uint32_t)start_, 0, n, res.tree);
+    if (!counts || root_in <= 0) return res;
+
+    // outside, longest spans first; the children of (i, j) get b(A, i, j) p(A -> B C) times the sibling's
+    // scaled inside value times factor(i, m) factor(m, j) / factor(i, j)
+    c.out_by_start.assign(c.best_by_start.size(), 0.0);
+    c.out_by_end.assign(c.best_by_end.size(), 0.0);
+    c.out_by_start[(size_t)root_row * s + n] = 1.0 / root_in;
+    auto outside = [&](uint32_t A, size_t i, size_t j) {
+        uint32_t rs = c.start_row[A * s + i], re = c.end_row[A * s + j];
+        if (rs == NO_ROW || re == NO_ROW) return 0.0;
+        return c.out_by_start[(size_t)rs * s + j] + c.out_by_end[(size_t)re * s + i];
+    };
+    for (size_t len = n; len >= 2; --len)
+        for (size_t i = 0; i + len <= n; ++i) {
+            size_t j = i + len, lo = i + 1;
+            double sij = c.scale[i * s + j];
+            if (sij == NEG_LOG) continue;
+            for (size_t m = lo; m < j; ++m) c.ratio[m - lo] = exp(c.scale[i * s + m] + c.scale[m * s + j] - sij);
+            for (uint32_t B : c.starting[i]) {
+                size_t rl = (size_t)c.start_row[B * s + i] * s + lo;
+                const float *il = &c.in_by_start[rl];
+                double *ob = &c.out_by_start[rl];
+                for (uint32_t p = left_off_[B]; p < left_off_[B + 1]; ++p) {
+                    uint32_t rr = c.end_row[pair_right_[p] * s + j];
+                    if (rr == NO_ROW) continue;
+                    double parent = 0;
+                    for (uint32_t h = head_off_[p]; h < head_off_[p + 1]; ++h)
+                        parent += outside(heads_[h], i, j) * head_prob_[h];
+                    if (parent == 0) continue;
+                    const float *ir = &c.in_by_end[(size_t)rr * s + lo];
+                    double *oc = &c.out_by_end[(size_t)rr * s + lo];
+                    double dot = 0;
+                    for (size_t m = 0; m + 1 < len; ++m) {
+                        double x = c.ratio[m];
+                        dot += (double)il[m] * ir[m] * x;
+                        ob[m] += parent * ir[m] * x;
+                        oc[m] += parent * il[m] * x;
+                    }
+                    if (dot == 0) continue;
+                    for (uint32_t h = head_off_[p]; h < head_off_[p + 1]; ++h)
+                        (*counts)[h] += outside(heads_[h], i, j) * head_prob_[h] * dot;
+                }
+            }
+        }
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t t = tokens[i];
+        for (uint32_t r = lex_off_[t]; r < lex_off_[t + 1]; ++r) {
+            uint32_t A = lex_heads_[r];
+            uint32_t rs = c.start_row[A * s + i];
+            if (rs != NO_ROW) (*counts)[heads_.size() + r] += outside(A, i, i + 1) * c.in_by_start[(size_t)rs * s + i + 1];
+        }
+    }
+    return res;
+}
+
+vector<PcfgParse> parse_sentences(const PcfgParser &parser, const vector<string> &sentences, unsigned threads,
+                                  vector<double> *counts) {
+    unsigned workers = max(1u, threads);
+    vector<PcfgChart> charts(workers);
+    vector<vector<double>> partial(counts ? workers : 0, vector<double>(parser.rule_count(), 0.0));
+    vector<PcfgParse> results(sentences.size());
+    parallel_for(sentences.size(), threads, [&](size_t begin, size_t end, unsigned w) {
+        vector<uint32_t> tokens;
+        for (size_t k = begin; k < end; ++k) {
+            if (!parser.tokenize(sentences[k], tokens)) continue;
+            results[k] = parser.parse(tokens, charts[w], counts ? &partial[w] : nullptr);
+        }
+    });
+    if (counts) {
+        counts->assign(parser.rule_count(), 0.0);
+        for (auto &p : partial)
+            for (size_t r = 0; r < p.size(); ++r) (*counts)[r] += p[r];
+    }
+    return results;
+}
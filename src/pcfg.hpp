@@ -0,0 +1,88 @@
+#ifndef PCFG_HPP
+#define PCFG_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "grammar.hpp"
+#include "terminal_classes.hpp"
+
+using namespace std;
+
+struct PcfgParse {
+    size_t length = 0;        // tokens
+    bool parsed = false;
+    double log_prob = 0;      // inside: log P(sentence)
+    double best_log_prob = 0; // Viterbi: log P(best derivation)
+    string tree;              // best derivation, bracketed: (S (A a) (B b))
+};
+
+// Scratch space of one parse; one per thread, reused across sentences. The chart has one row of n + 1
+// entries per (A, i) where A has some span starting at i (by start, indexed by the end) and one per
+// (A, j) where A has some span ending at j (by end, indexed by the start), made the first time A gets
+// such a span; absent entries of a row hold -inf / 0.
+struct PcfgChart {
+    static const uint32_t NO_ROW = UINT32_MAX;
+    size_t stride = 0;
+    vector<uint32_t> start_row, end_row;        // A * stride + i -> row, or NO_ROW
+    vector<vector<uint32_t>> starting;          // i -> variables with a span starting at i
+    vector<float> best_by_start, best_by_end;   // Viterbi, log space
+    vector<float> in_by_start, in_by_end;       // inside, scaled by the span's factor
+    vector<double> out_by_start, out_by_end;    // outside (see PcfgParser::parse)
+    vector<double> scale;                       // log factor of each span (inside)
+    vector<float> span_best, span_in;           // the span being filled, per variable
+    vector<uint32_t> touched;                   // variables of that span
+    vector<float> factor;                       // per split point (inside)
+    vector<double> ratio;                       // per split point (outside)
+};
+
+// Probabilistic CKY for a weighted grammar in CNF (Grammar::weight; an unweighted grammar counts as
+// uniform). Binary rules are grouped by their (B, C) pair, with the heads and scores of each pair
+// stored contiguously, so one pass over the split points of a span serves every A -> B C of the pair.
+// The chart is kept twice, by start (row (B, i) over the ends m) and by end (row (C, j) over the
+// starts m), which makes the split points of (i, j) two contiguous rows: Viterbi is a max-plus over
+// them in log-space floats, inside a dot product of scaled probabilities, both written in 8 lanes so
+// that they compile to vector code without fast-math. Inside values are scaled per span (the largest
+// variable of a span is 1, the log factor is kept apart), so 40-token sentences do not underflow.
+class PcfgParser {
+public:
+    explicit PcfgParser(const Grammar &G);
+
+    bool tokenize(const string &line, vector<uint32_t> &tokens) const { return tc_.tokenize(line, tokens); }
+    size_t variable_count() const { return nv_; }
+    size_t rule_count() const { return heads_.size() + lex_heads_.size(); }
+    string rule_name(size_t r) const;
+
+    // Viterbi and inside; with `counts` (rule_count() entries), also outside, adding the expected
+    // number of uses of every rule in the sentence.
+    PcfgParse parse(const vector<uint32_t> &tokens, PcfgChart &chart, vector<double> *counts = nullptr) const;
+
+private:
+    size_t nv_ = 0;
+    vector<Symbol> vars_;
+    int start_ = -1;
+    double start_empty_ = 0; // P(S -> &)
+    TerminalClasses tc_;
+    // binary rules, grouped by (B, C); pairs sorted by B
+    vector<uint32_t> pair_left_, pair_right_, head_off_;
+    vector<uint32_t> heads_;
+    vector<float> head_log_, head_prob_;
+    vector<uint32_t> left_off_;            // pairs with left symbol B: [left_off_[B], left_off_[B + 1])
+    // lexical rules per token: [lex_off_[t], lex_off_[t + 1])
+    vector<uint32_t> lex_off_, lex_heads_;
+    vector<float> lex_log_, lex_prob_;
+    vector<uint32_t> lex_token_;           // token of each lexical rule
+    vector<vector<uint32_t>> by_head_;     // A -> indices into heads_ (tree recovery)
+    vector<uint32_t> head_pair_;           // pair of each entry of heads_
+
+    void viterbi_tree(const PcfgChart &c, const vector<uint32_t> &tokens, uint32_t A, size_t i, size_t j,
+                      string &out) const;
+};
+
+// Tokenize and parse every sentence, split among the threads (one chart per worker); with `counts`, the
+// expected rule uses summed over all sentences are stored there. Results are in input order.
+vector<PcfgParse> parse_sentences(const PcfgParser &parser, const vector<string> &sentences, unsigned threads,
+                                  vector<double> *counts = nullptr);
+
+#endif
@@ -0,0 +1,77 @@
+#include "prefix_chart.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+/// @param G Grammar whose bodies have at most two symbols ('&' and empty bodies are ε).
+/// @param max_length Longest prefix plus tail the chart will see.
+PrefixChart::PrefixChart(const Grammar &G, size_t max_length) : rec_(G), max_(max_length) {
+    words_ = rec_.words_;
+    gen_.assign(max_ + 1, vector<uint64_t>(words_, 0));
+    if (max_ >= 1)
+        for (size_t c = 0; c < rec_.tc_.count(); ++c)
+            for (size_t w = 0; w < words_; ++w) gen_[1][w] |= rec_.base_[c * words_ + w];
+    for (size_t r = 2; r <= max_; ++r)
+        for (size_t k = 1; k < r; ++k) combine(gen_[r].data(), gen_[k].data(), gen_[r - k].data());
+    column_.assign(max_, {});
+    for (size_t j = 0; j < max_; ++j) column_[j].assign((j + 1) * words_, 0);
+}
+
+const TerminalClasses &PrefixChart::classes() const { return rec_.tc_; }
+
+bool PrefixChart::has_start(const uint64_t *c) const {
+    int S = rec_.start_;
+    return S >= 0 && (c[S >> 6] >> (S & 63) & 1);
+}
+
+// out |= closure of { A : A -> B C, B in L, C in R }
+void PrefixChart::combine(uint64_t *out, const uint64_t *L, const uint64_t *R) const {
+    for (size_t w = 0; w < words_; ++w)
+        for (uint64_t bits = L[w]; bits; bits &= bits - 1) {
+            int B = (int)(w * 64 + __builtin_ctzll(bits));
+            for (auto &ca : rec_.left_[B])
+                if (R[ca.first >> 6] >> (ca.first & 63) & 1) rec_.add_closed(out, ca.second);
+        }
+}
+
+/// @brief Append a symbol and fill the chart column of the cells ending after it.
+void PrefixChart::push(uint32_t cls) {
+    if (p_ >= max_) throw logic_error("PrefixChart: prefixo maior que o comprimento máximo.");
+    size_t p = p_++;
+    uint64_t *col = column_[p].data();
+    fill(col, col + (p + 1) * words_, 0);
+    if (cls != NO_CLASS) {
+        const uint64_t *b = rec_.base_.data() + cls * words_;
+        copy(b, b + words_, col + p * words_);
+    }
+    for (size_t i = p; i-- > 0;)
+        for (size_t k = i + 1; k <= p; ++k) combine(col + i * words_, cell(i, k), cell(k, p + 1));
+}
+
+bool PrefixChart::accepts() const {
+    return p_ == 0 ? rec_.start_nullable_ : has_start(cell(0, p_));
+}
+
+/// @brief tail(i, 0) is the chart cell (i, p); for r > 0 either the first child ends inside the prefix
+/// (cell(i, j), tail(j, r)) or it covers the whole prefix plus r' < r symbols (tail(i, r'), gen(r - r')).
+void PrefixChart::compute_tails(size_t R) {
+    size_t p = p_, W = R + 1;
+    if (p == 0) return;
+    tail_.assign(p * W * words_, 0);
+    auto tail = [&](size_t i, size_t r) { return tail_.data() + (i * W + r) * words_; };
+    for (size_t i = p; i-- > 0;) {
+        const uint64_t *c = cell(i, p);
+        copy(c, c + words_, tail(i, 0));
+        for (size_t r = 1; r <= R; ++r) {
+            uint64_t *out = tail(i, r);
+            for (size_t j = i + 1; j < p; ++j) combine(out, cell(i, j), tail(j, r));
+            for (size_t q = 0; q < r; ++q) combine(out, tail(i, q), gen_[r - q].data());
+        }
+    }
+}
+
+bool PrefixChart::completes(size_t r) const {
+    if (p_ == 0) return r == 0 ? rec_.start_nullable_ : has_start(gen_[r].data());
+    return has_start(tail_.data() + r * words_); // tail(0, r)
+}
+
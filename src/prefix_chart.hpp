@@ -0,0 +1,44 @@
+#ifndef PREFIX_CHART_HPP
+#define PREFIX_CHART_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "grammar.hpp"
+#include "recognizer.hpp"
+
+using namespace std;
+
+// CYK chart of a growing prefix, for a grammar in binary normal form (the tables and the unit closure
+// are the ones of Recognizer). push() adds the column of the cells ending at the new symbol, so walking
+// a tree of prefixes costs one column per edge. compute_tails(R) answers "does S derive the prefix
+// followed by some r more symbols" for every r <= R: tail(i, r) = symbols deriving prefix[i..] plus r
+// symbols, built from the chart and gen(r), the symbols deriving some word of length r.
+class PrefixChart {
+public:
+    static const uint32_t NO_CLASS = UINT32_MAX; // a terminal the grammar does not have
+
+    PrefixChart(const Grammar &G, size_t max_length);
+
+    const TerminalClasses &classes() const;
+    size_t size() const { return p_; }
+    void push(uint32_t cls); // terminal class id, or NO_CLASS
+    void pop() { --p_; }
+    bool accepts() const;     // S derives the prefix
+
+    void compute_tails(size_t R);
+    bool completes(size_t r) const; // after compute_tails(R), r <= R
+
+private:
+    Recognizer rec_;
+    size_t words_ = 0, max_ = 0, p_ = 0;
+    vector<vector<uint64_t>> gen_;    // gen_[r]: symbols deriving some word of length r (r >= 1)
+    vector<vector<uint64_t>> column_; // column_[j]: cells (i, j + 1) for i <= j
+    vector<uint64_t> tail_;
+
+    const uint64_t *cell(size_t i, size_t j) const { return column_[j - 1].data() + i * words_; }
+    bool has_start(const uint64_t *c) const;
+    void combine(uint64_t *out, const uint64_t *L, const uint64_t *R) const;
+};
+
+#endif
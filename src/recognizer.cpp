@@ -0,0 +1,152 @@
+#include "recognizer.hpp"
+#include "analyses.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+/// @brief Index a binary-normal-form grammar for recognition.
+/// @param G Grammar whose bodies have at most two symbols ('&' and empty bodies are ε).
+/// @param supers Super-terminals of G with their DFAs (see the 'regular' pass).
+Recognizer::Recognizer(const Grammar &G, const vector<SuperTerminal> &supers) : supers_(supers) {
+    for (auto &A : G.V) id_.emplace(A, (int)nv_++);
+    tc_ = compute_terminal_classes(G);
+    ns_ = nv_ + tc_.count();
+    for (uint32_t t = 0; t < tc_.tokens.size(); ++t) id_.emplace(tc_.tokens[t], (int)(nv_ + tc_.class_of[t]));
+    words_ = (ns_ + 63) / 64;
+    auto sym = [&](const Symbol &X) {
+        auto it = id_.find(X);
+        if (it == id_.end()) throw runtime_error("Símbolo '" + X + "' não declarado na gramática.");
+        return it->second;
+    };
+
+    auto nullable = compute_nullable(G);
+    vector<char> isNull(ns_, 0);
+    for (auto &A : nullable) if (id_.count(A)) isNull[id_.at(A)] = 1;
+    start_ = id_.count(G.S) ? id_.at(G.S) : -1;
+    start_nullable_ = start_ >= 0 && isNull[start_];
+
+    // unit edges A -> X, including A -> X Y / A -> Y X with Y nullable
+    vector<vector<int>> down(ns_);
+    left_.assign(ns_, {});
+    for (auto &pr : G.P) {
+        if (!id_.count(pr.first)) continue;
+        int A = id_.at(pr.first);
+        for (auto &rhs : pr.second) {
+            if (rhs.size() > 2) throw runtime_error("Produção de '" + pr.first + "' com mais de dois símbolos: a gramática não está em 2NF/CNF.");
+            if (rhs.empty() || rhs == RHS{"&"}) continue;
+            if (rhs.size() == 1) { down[A].push_back(sym(rhs[0])); continue; }
+            int B = sym(rhs[0]), C = sym(rhs[1]);
+            left_[B].emplace_back(C, A);
+            if (isNull[C]) down[A].push_back(B);
+            if (isNull[B]) down[A].push_back(C);
+        }
+    }
+    // reflexive-transitive closure, stored upwards
+    up_.assign(ns_, {});
+    vector<vector<int>> rev(ns_);
+    for (int A = 0; A < (int)ns_; ++A) for (int X : down[A]) rev[X].push_back(A);
+    vector<int> mark(ns_, -1), stack;
+    for (int X = 0; X < (int)ns_; ++X) {
+        stack.assign(1, X);
+        mark[X] = X;
+        while (!stack.empty()) {
+            int Y = stack.back();
+            stack.pop_back();
+            up_[X].push_back(Y);
+            for (int A : rev[Y]) if (mark[A] != X) { mark[A] = X; stack.push_back(A); }
+        }
+    }
+    // terminals of one class give identical rules: keep one copy
+    for (auto &l : left_) {
+        sort(l.begin(), l.end());
+        l.erase(unique(l.begin(), l.end()), l.end());
+    }
+    // base row: the closed cell of every terminal class
+    base_.assign(tc_.count() * words_, 0);
+    for (size_t c = 0; c < tc_.count(); ++c) add_closed(base_.data() + c * words_, (int)(nv_ + c));
+
+    // super-terminals still used by the grammar; DFA columns looked up once per token id
+    for (auto &st : supers_) {
+        auto t = tc_.token_id.find(st.name);
+        if (t == tc_.token_id.end()) continue;
+        Seed seed{ (int)(nv_ + tc_.class_of[t->second]), &st.dfa, vector<uint32_t>(tc_.tokens.size(), UINT32_MAX) };
+        for (uint32_t k = 0; k < tc_.tokens.size(); ++k) {
+            auto c = st.dfa.column.find(tc_.tokens[k]);
+            if (c != st.dfa.column.end()) seed.column[k] = c->second;
+        }
+        seeds_.push_back(std::move(seed));
+    }
+    // a super-terminal stands for the words of its DFA, never for its own name in the input
+    auto named = [&](uint32_t t) {
+        for (auto &st : supers_) if (tc_.tokens[t] == st.name) return true;
+        return false;
+    };
+    tc_.by_length.erase(remove_if(tc_.by_length.begin(), tc_.by_length.end(), named), tc_.by_length.end());
+}
+
+bool Recognizer::tokenize(const string &word, vector<uint32_t> &tokens) const {
+    return tc_.tokenize(word, tokens);
+}
+
+// Set X and everything that derives it by unit steps; cells are kept closed, so a bit that is
+// already set needs nothing more.
+void Recognizer::add_closed(uint64_t *cell, int X) const {
+    if (cell[X >> 6] >> (X & 63) & 1) return;
+    for (int A : up_[X]) cell[A >> 6] |= 1ull << (A & 63);
+}
+
+bool Recognizer::accepts(const vector<Symbol> &tokens) const {
+    vector<uint32_t> ids;
+    for (auto &t : tokens) {
+        auto it = tc_.token_id.find(t);
+        if (it == tc_.token_id.end()) return false;
+        ids.push_back(it->second);
+    }
+    return accepts(ids);
+}
+
+/// @brief CYK over bitset cells.
+/// @param tokens Token ids of the input word (see tokenize).
+/// @return True if the start symbol derives the word.
+bool Recognizer::accepts(const vector<uint32_t> &tokens) const {
+    size_t n = tokens.size();
+    if (start_ < 0) return false;
+    if (n == 0) return start_nullable_;
+    // cell(i, len) holds the symbols deriving tokens[i, i+len)
+    vector<uint64_t> chart(n * (n + 1) * words_, 0);
+    auto cell = [&](size_t i, size_t len) { return chart.data() + (i * (n + 1) + len) * words_; };
+    for (size_t i = 0; i < n; ++i) {
+        if (tokens[i] >= tc_.class_of.size()) return false;
+        const uint64_t *b = base_.data() + tc_.class_of[tokens[i]] * words_;
+        copy(b, b + words_, cell(i, 1));
+    }
+    // every span a super-terminal's DFA accepts
+    for (auto &seed : seeds_) {
+        const Dfa &d = *seed.dfa;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t s = d.start;
+            for (size_t j = i; j < n; ++j) {
+                uint32_t c = seed.column[tokens[j]];
+                if (c == UINT32_MAX || (s = d.step(s, c)) == d.dead) break;
+                if (d.accepting[s]) add_closed(cell(i, j - i + 1), seed.symbol);
+            }
+        }
+    }
+    for (size_t len = 2; len <= n; ++len) {
+        for (size_t i = 0; i + len <= n; ++i) {
+            uint64_t *out = cell(i, len);
+            for (size_t k = 1; k < len; ++k) {
+                const uint64_t *L = cell(i, k), *R = cell(i + k, len - k);
+                for (size_t w = 0; w < words_; ++w) {
+                    for (uint64_t bits = L[w]; bits; bits &= bits - 1) {
+                        int B = (int)(w * 64 + __builtin_ctzll(bits));
+                        for (auto &ca : left_[B])
+                            if (R[ca.first >> 6] >> (ca.first & 63) & 1) add_closed(out, ca.second);
+                    }
+                }
+            }
+        }
+    }
+    const uint64_t *top = cell(0, n);
+    return top[start_ >> 6] >> (start_ & 63) & 1;
+}
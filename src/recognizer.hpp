@@ -0,0 +1,58 @@
+#ifndef RECOGNIZER_HPP
+#define RECOGNIZER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "grammar.hpp"
+#include "terminal_classes.hpp"
+#include "dfa.hpp"
+
+using namespace std;
+
+// Chart (CYK) recognizer for grammars in binary normal form: bodies of at most two symbols, with
+// ε and unit productions allowed, so CNF grammars are accepted as well. Unit steps, and binary
+// productions whose other symbol is nullable, are folded into a precomputed unit-closure relation
+// that is applied to every chart cell. Terminals are grouped into equivalence classes: the chart only
+// knows classes, and the base row is a copy of the precomputed cell of the token's class.
+// Super-terminals (regular sub-grammars compiled to DFAs) are seeded into every cell whose span the
+// DFA accepts before the chart is filled.
+class Recognizer {
+public:
+    explicit Recognizer(const Grammar &G, const vector<SuperTerminal> &supers = {});
+
+    // Split a word into token ids (longest match, whitespace ignored); false if some part is not a terminal.
+    bool tokenize(const string &word, vector<uint32_t> &tokens) const;
+    bool accepts(const vector<uint32_t> &tokens) const;
+    bool accepts(const vector<Symbol> &tokens) const;
+
+    size_t variable_count() const { return nv_; }
+    size_t symbol_count() const { return ns_; }
+    const TerminalClasses &classes() const { return tc_; }
+
+private:
+    friend string generate_recognizer_header(const Recognizer &rec, const string &ns, const string &source);
+    friend class PrefixChart;
+
+    size_t nv_ = 0, ns_ = 0, words_ = 0; // variables are ids [0, nv_), terminal classes [nv_, ns_)
+    unordered_map<Symbol, int> id_;      // variables and terminals (a terminal maps to its class symbol)
+    TerminalClasses tc_;
+    vector<uint64_t> base_;              // closed cell of each class, words_ words each
+    int start_ = -1;
+    bool start_nullable_ = false;
+    vector<vector<int>> up_;              // up_[X]: every A with A =>* X by unit steps (X included)
+    vector<vector<pair<int, int>>> left_; // left_[B]: (C, A) for every A -> B C
+    struct Seed {
+        int symbol;               // class symbol of the super-terminal
+        const Dfa *dfa;
+        vector<uint32_t> column;  // token id -> DFA column (UINT32_MAX: not in its alphabet)
+    };
+    vector<SuperTerminal> supers_;
+    vector<Seed> seeds_;
+
+    void add_closed(uint64_t *cell, int X) const;
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "regular.hpp"
+#include "grammar_sets.hpp"
+#include "analyses.hpp"
+
+#include <algorithm>
+
+/// @brief Components of the dependency graph, classified bottom-up (a component can only be regular
+/// when everything it uses below it is).
+/// @param G Grammar to analyse.
+RegularComponents find_regular_components(const Grammar &G) {
+    RegularComponents rc;
+    for (auto &A : G.V) {
+        rc.id.emplace(A, (uint32_t)rc.vars.size());
+        rc.vars.push_back(A);
+    }
+    size_t nv = rc.vars.size();
+    auto var = [&](const Symbol &X) -> int64_t {
+        if (G.isTerminal(X)) return -1;
+        auto it = rc.id.find(X);
+        return it == rc.id.end() ? -1 : it->second;
+    };
+    vector<pair<uint32_t, uint32_t>> edges;
+    for (auto &pr : G.P) {
+        int64_t A = var(pr.first);
+        if (A < 0) continue;
+        for (auto &rhs : pr.second)
+            for (auto &X : rhs) {
+                int64_t B = var(X);
+                if (B >= 0) edges.push_back({ (uint32_t)A, (uint32_t)B });
+            }
+    }
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+    vector<uint32_t> off(nv + 1, 0), adj;
+    for (auto &e : edges) ++off[e.first + 1];
+    for (size_t i = 0; i < nv; ++i) off[i + 1] += off[i];
+    for (auto &e : edges) adj.push_back(e.second);
+    size_t count = strongly_connected_components(nv, off, adj, rc.comp);
+    rc.members.assign(count, {});
+    for (uint32_t A = 0; A < nv; ++A) rc.members[rc.comp[A]].push_back(A);
+
+    rc.regular.assign(count, 0);
+    rc.right_linear.assign(count, 0);
+    for (uint32_t c = 0; c < count; ++c) {
+        bool right = true, left = true, lower_ok = true;
+        for (uint32_t A : rc.members[c]) {
+            auto it = G.P.find(rc.vars[A]);
+            if (it == G.P.end()) continue;
+            for (auto &rhs : it->second) {
+                // positions of own-component variables among the non-ε symbols
+                vector<size_t> own;
+                size_t len = 0;
+                for (auto &X : rhs) {
+                    if (X == "&") continue;
+                    int64_t B = var(X);
+                    if (B >= 0 && rc.comp[B] == c) own.push_back(len);
+                    else if (B >= 0 && !rc.regular[rc.comp[B]]) lower_ok = false;
+                    ++len;
+                }
+                if (own.size() > 1) { right = left = false; continue; }
+                if (own.size() == 1) {
+                    if (own[0] != len - 1) right = false;
+                    if (own[0] != 0) left = false;
+                }
+            }
+        }
+        rc.regular[c] = lower_ok && (right || left);
+        rc.right_linear[c] = right;
+    }
+
+    // roots: regular variables used by a non-regular variable, and the start symbol
+    rc.roots.assign(nv, 0);
+    for (auto &pr : G.P) {
+        int64_t A = var(pr.first);
+        if (A < 0 || rc.is_regular((uint32_t)A)) continue;
+        for (auto &rhs : pr.second)
+            for (auto &X : rhs) {
+                int64_t B = var(X);
+                if (B >= 0 && rc.is_regular((uint32_t)B)) rc.roots[B] = 1;
+            }
+    }
+    int64_t S = var(G.S);
+    if (S >= 0 && rc.is_regular((uint32_t)S)) rc.roots[S] = 1;
+    return rc;
+}
+
+namespace {
+// Builds the NFA of a regular variable; regular variables of lower components are inlined.
+struct NfaBuilder {
+    const Grammar &G;
+    const RegularComponents &rc;
+    Nfa &nfa;
+    size_t limit;
+    Budget &budget; // every state added is a unit of work
+    bool overflow = false;
+
+    // path from -> to reading body[b, e)
+    void symbols(const RHS &body, size_t b, size_t e, uint32_t from, uint32_t to) {
+        uint32_t cur = from;
+        for (size_t i = b; i < e && !overflow; ++i) {
+            const Symbol &X = body[i];
+            if (X == "&") continue;
+            budget.tick();
+            uint32_t nxt = nfa.add_state();
+            if (G.isTerminal(X)) nfa.add_edge(cur, nfa.label_of(X), nxt);
+            else variable(rc.id.at(X), cur, nxt);
+            cur = nxt;
+        }
+        nfa.add_edge(cur, Nfa::EPS, to);
+        if (nfa.size() > limit) overflow = true;
+    }
+
+    // skip ε entries, so that "own variable first/last" matches find_regular_components
+    static size_t first_symbol(const RHS &body) {
+        size_t i = 0;
+        while (i < body.size() && body[i] == "&") ++i;
+        return i;
+    }
+    static size_t last_symbol(const RHS &body) {
+        size_t i = body.size();
+        while (i > 0 && body[i - 1] == "&") --i;
+        return i; // one past the last symbol
+    }
+
+    // path from -> to reading a word of L(X)
+    void variable(uint32_t X, uint32_t from, uint32_t to) {
+        if (overflow) return;
+        uint32_t c = rc.comp[X];
+        unordered_map<uint32_t, uint32_t> state;
+        for (uint32_t M : rc.members[c]) state[M] = nfa.add_state();
+        auto own = [&](const Symbol &Y) -> int64_t {
+            if (G.isTerminal(Y)) return -1;
+            uint32_t B = rc.id.at(Y);
+            return rc.comp[B] == c ? (int64_t)B : -1;
+        };
+        bool right = rc.right_linear[c];
+        // right-linear: state(M) = "still to read a word of M"; left-linear: "read a word of M"
+        if (right) nfa.add_edge(from, Nfa::EPS, state[X]);
+        else nfa.add_edge(state[X], Nfa::EPS, to);
+        for (uint32_t M : rc.members[c]) {
+            auto it = G.P.find(rc.vars[M]);
+            if (it == G.P.end()) continue;
+            for (auto &rhs : it->second) {
+                if (overflow) return;
+                size_t b = first_symbol(rhs), e = last_symbol(rhs);
+                if (right) {
+                    int64_t Z = e > b ? own(rhs[e - 1]) : -1;
+                    if (Z >= 0) symbols(rhs, b, e - 1, state[M], state[(uint32_t)Z]);
+                    else symbols(rhs, b, e, state[M], to);
+                } else {
+                    int64_t Z = e > b ? own(rhs[b]) : -1;
+                    if (Z >= 0) symbols(rhs, b + 1, e, state[(uint32_t)Z], state[M]);
+                    else symbols(rhs, b, e, from, state[M]);
+                }
+            }
+        }
+    }
+};
+}
+
+/// @brief Compile every regular root to a minimal DFA and replace it by a super-terminal.
+/// @param G Grammar rewritten in place.
+/// @param ctx Pass context; receives the super-terminals.
+void compile_regular_subgrammars(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Subgramáticas regulares: início.");
+    const size_t MAX_NFA = 200000, MAX_DFA = 20000;
+    RegularComponents rc = find_regular_components(G);
+    size_t regular_vars = 0;
+    for (uint32_t A = 0; A < rc.vars.size(); ++A) regular_vars += rc.is_regular(A);
+    log.info("Componentes: " + to_string(rc.members.size()) + "; variáveis em componentes regulares: "
+             + to_string(regular_vars) + " de " + to_string(rc.vars.size()) + ".");
+
+    // bodies are replaced only after every root is compiled: roots inline each other's original productions
+    vector<pair<Symbol, vector<RHS>>> replaced;
+    size_t compiled = 0;
+    for (uint32_t R = 0; R < rc.vars.size(); ++R) {
+        if (!rc.roots[R]) continue;
+        const Symbol &name = rc.vars[R];
+        // a variable that is just one terminal is already as cheap as it gets
+        auto it = G.P.find(name);
+        if (it != G.P.end() && it->second.size() == 1 && it->second[0].size() == 1 && G.isTerminal(it->second[0][0])) continue;
+
+        Nfa nfa;
+        nfa.start = nfa.add_state();
+        uint32_t accept = nfa.add_state();
+        nfa.accepting[accept] = 1;
+        NfaBuilder nb{ G, rc, nfa, MAX_NFA, ctx.budget };
+        nb.variable(R, nfa.start, accept);
+        Dfa dfa;
+        if (nb.overflow || !determinize(nfa, MAX_DFA, dfa, &ctx.budget)) {
+            log.info("  " + name + ": autômato grande demais, mantida como gramática.");
+            continue;
+        }
+        size_t subset = dfa.states;
+        dfa = minimize(dfa, &ctx.budget);
+
+        Symbol st = "<" + name + ">";
+        for (size_t k = 1; G.V.count(st) || G.T.count(st); ++k) st = "<" + name + "_" + to_string(k) + ">";
+        G.T.insert(st);
+        vector<RHS> bodies{ RHS{ st } };
+        if (dfa.accepting[dfa.start]) bodies.push_back(RHS());
+        replaced.emplace_back(name, std::move(bodies));
+        log.info("  " + name + " -> " + st + ": " + to_string(rc.members[rc.comp[R]].size()) + " variável(is) na componente, NFA "
+                 + to_string(nfa.size()) + " estados, DFA " + to_string(subset) + " -> " + to_string(dfa.states)
+                 + " estados x " + to_string(dfa.alphabet.size()) + " colunas.");
+        ctx.super_terminals.push_back({ st, name, std::move(dfa) });
+        ++compiled;
+    }
+    for (auto &r : replaced) G.P[r.first] = std::move(r.second);
+
+    // variables only used inside compiled sub-grammars are gone
+    size_t dropped = 0;
+    auto reach = compiled ? compute_reachable(G, &ctx.budget) : set<Symbol>(G.V);
+    for (auto it = G.V.begin(); it != G.V.end();) {
+        if (reach.count(*it)) { ++it; continue; }
+        G.P.erase(*it);
+        it = G.V.erase(it);
+        ++dropped;
+    }
+    log.info("Super-terminais: " + to_string(compiled) + "; variáveis removidas: " + to_string(dropped) + ".");
+    log.info("Subgramáticas regulares: finalizada.");
+    log.snapshot("Após compilação de subgramáticas regulares", G);
+}
@@ -0,0 +1,35 @@
+#ifndef REGULAR_HPP
+#define REGULAR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "grammar.hpp"
+#include "pass_manager.hpp"
+
+using namespace std;
+
+// Strongly connected components of the variable dependency graph (A -> every variable in a body of A),
+// and which of them generate regular languages: every body uses only terminals and variables of regular
+// lower components, plus at most one variable of its own component, always last (right-linear) or
+// always first (left-linear).
+struct RegularComponents {
+    vector<Symbol> vars;
+    unordered_map<Symbol, uint32_t> id;
+    vector<uint32_t> comp;               // variable -> component (sinks first)
+    vector<vector<uint32_t>> members;    // component -> variables
+    vector<char> regular, right_linear;  // per component
+    vector<char> roots;                  // per variable: regular and used by a non-regular part (or the start)
+
+    bool is_regular(uint32_t A) const { return regular[comp[A]]; }
+};
+
+RegularComponents find_regular_components(const Grammar &G);
+
+// Pass 'regular': every regular root R becomes R -> <R>, with <R> a super-terminal matched by a
+// minimal DFA (stored in ctx.super_terminals); variables no longer reachable are dropped.
+void compile_regular_subgrammars(Grammar &G, PassContext &ctx);
+
+#endif
@@ -0,0 +1,83 @@
+#include "rhs_pool.hpp"
+
+#include <cstring>
+
+SymId RhsPool::intern(const Symbol &s) {
+    auto it = symbol_index_.find(s);
+    if (it != symbol_index_.end()) return it->second;
+    SymId id = (SymId)symbols_.size();
+    symbols_.push_back(s);
+    symbol_index_.emplace(s, id);
+    return id;
+}
+
+bool RhsPool::find(const Symbol &s, SymId &id) const {
+    auto it = symbol_index_.find(s);
+    if (it == symbol_index_.end()) return false;
+    id = it->second;
+    return true;
+}
+
+RhsId RhsPool::intern(const RHS &rhs) {
+    SymId small[16];
+    vector<SymId> big;
+    SymId *ids = small;
+    if (rhs.size() > 16) { big.resize(rhs.size()); ids = big.data(); }
+    for (size_t i = 0; i < rhs.size(); ++i) ids[i] = intern(rhs[i]);
+    return intern_ids(ids, rhs.size());
+}
+
+uint64_t RhsPool::hash_ids(const SymId *ids, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= ids[i];
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+void RhsPool::grow() {
+    vector<RhsId> table(table_.empty() ? 64 : table_.size() * 2, 0);
+    size_t mask = table.size() - 1;
+    for (RhsId id = 0; id < (RhsId)hash_.size(); ++id) {
+        size_t pos = hash_[id] & mask;
+        while (table[pos]) pos = (pos + 1) & mask;
+        table[pos] = id + 1;
+    }
+    table_.swap(table);
+}
+
+RhsId RhsPool::intern_ids(const SymId *ids, size_t n) {
+    if ((hash_.size() + 1) * 2 > table_.size()) grow();
+    uint64_t h = hash_ids(ids, n);
+    size_t mask = table_.size() - 1;
+    size_t pos = h & mask;
+    while (RhsId slot = table_[pos]) {
+        RhsId id = slot - 1;
+        if (hash_[id] == h) {
+            RhsView b = body(id);
+            if (b.size == n && (n == 0 || memcmp(b.data, ids, n * sizeof(SymId)) == 0)) return id;
+        }
+        pos = (pos + 1) & mask;
+    }
+    RhsId id = (RhsId)hash_.size();
+    if (n && ids >= data_.data() && ids < data_.data() + data_.size()) {
+        // slice of a body already in the pool: copy before data_ may reallocate
+        vector<SymId> tmp(ids, ids + n);
+        data_.insert(data_.end(), tmp.begin(), tmp.end());
+    } else {
+        data_.insert(data_.end(), ids, ids + n);
+    }
+    offset_.push_back((uint32_t)data_.size());
+    hash_.push_back(h);
+    table_[pos] = id + 1;
+    return id;
+}
+
+RHS RhsPool::to_rhs(RhsView b) const {
+    RHS rhs;
+    rhs.reserve(b.size);
+    for (SymId s : b) rhs.push_back(symbols_[s]);
+    return rhs;
+}
@@ -0,0 +1,76 @@
+#ifndef RHS_POOL_HPP
+#define RHS_POOL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "grammar.hpp"
+
+using namespace std;
+
+using SymId = uint32_t;
+using RhsId = uint32_t;
+
+// Read-only view of an interned body.
+struct RhsView {
+    const SymId *data;
+    size_t size;
+    const SymId *begin() const { return data; }
+    const SymId *end() const { return data + size; }
+    SymId operator[](size_t i) const { return data[i]; }
+};
+
+// Hash-consing pool: every distinct symbol and every distinct RHS is stored once and named by a dense id,
+// so that equal bodies compare (and deduplicate) as integers.
+class RhsPool {
+public:
+    SymId intern(const Symbol &s);
+    RhsId intern(const RHS &rhs);
+    RhsId intern_ids(const SymId *ids, size_t n);
+    RhsId intern_ids(const vector<SymId> &ids) { return intern_ids(ids.data(), ids.size()); }
+
+    // Lookup without inserting; returns false if the symbol was never interned.
+    bool find(const Symbol &s, SymId &id) const;
+
+    const Symbol &symbol(SymId id) const { return symbols_[id]; }
+    RhsView body(RhsId id) const { return RhsView{ data_.data() + offset_[id], offset_[id + 1] - offset_[id] }; }
+    RHS to_rhs(RhsId id) const { return to_rhs(body(id)); }
+    // Symbols of a body (possibly from another pool that shares this pool's symbol ids).
+    RHS to_rhs(RhsView b) const;
+
+    size_t symbol_count() const { return symbols_.size(); }
+    size_t size() const { return offset_.size() - 1; }
+    size_t stored_symbols() const { return data_.size(); }
+
+private:
+    unordered_map<Symbol, SymId> symbol_index_;
+    vector<Symbol> symbols_;
+    vector<SymId> data_;             // all bodies, back to back
+    vector<uint32_t> offset_{ 0 };   // body i is data_[offset_[i], offset_[i+1])
+    vector<uint64_t> hash_;          // hash of each body
+    vector<RhsId> table_;            // open addressing, RhsId + 1 (0 = empty)
+
+    static uint64_t hash_ids(const SymId *ids, size_t n);
+    void grow();
+};
+
+// Set of pool ids cleared in O(1) by bumping an epoch.
+struct IdMarks {
+    vector<uint32_t> stamp;
+    uint32_t epoch = 1;
+
+    // true if id was not yet in the set
+    bool insert(uint32_t id) {
+        if (id >= stamp.size()) stamp.resize(id + 1 + stamp.size() / 2, 0);
+        if (stamp[id] == epoch) return false;
+        stamp[id] = epoch;
+        return true;
+    }
+    void clear() {
+        if (++epoch == 0) { stamp.assign(stamp.size(), 0); epoch = 1; }
+    }
+};
+
+#endif
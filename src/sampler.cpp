@@ -0,0 +1,258 @@
+#include "sampler.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+/// @brief Count derivations per (variable, length) and build the choice tables.
+/// @param G Grammar in CNF (A -> B C, A -> a, and S -> & only if S is in no body).
+/// @param max_length Longest sentence that can be sampled.
+/// @param threads Workers for the counting (one length at a time, split by variable).
+Sampler::Sampler(const Grammar &G, size_t max_length, unsigned threads) : max_(max_length) {
+    unordered_map<Symbol, uint32_t> id;
+    for (auto &A : G.V) id.emplace(A, (uint32_t)nv_++);
+    terms_.assign(nv_, {});
+    bins_.assign(nv_, {});
+    left_.assign(nv_, {});
+    unordered_map<Symbol, uint32_t> term_id;
+    start_ = id.count(G.S) ? (int)id.at(G.S) : -1;
+    auto not_cnf = [&](const Symbol &A) {
+        return runtime_error("Produção de '" + A + "' fora da CNF: o sorteio exige a gramática em CNF (use --passes=cnf).");
+    };
+    for (auto &pr : G.P) {
+        auto a = id.find(pr.first);
+        if (a == id.end()) continue;
+        uint32_t A = a->second;
+        for (auto &rhs : pr.second) {
+            if (rhs.empty() || rhs == RHS{ "&" }) {
+                if ((int)A != start_) throw not_cnf(pr.first);
+                start_nullable_ = true;
+            } else if (rhs.size() == 1 && G.isTerminal(rhs[0])) {
+                auto t = term_id.emplace(rhs[0], (uint32_t)term_name_.size());
+                if (t.second) {
+                    term_name_.push_back(rhs[0]);
+                    term_heads_.emplace_back();
+                }
+                terms_[A].push_back(t.first->second);
+                term_heads_[t.first->second].push_back(A);
+            } else if (rhs.size() == 2 && id.count(rhs[0]) && id.count(rhs[1])) {
+                bins_[A].emplace_back(id.at(rhs[0]), id.at(rhs[1]));
+                left_[id.at(rhs[0])].emplace_back(id.at(rhs[1]), A);
+            } else {
+                throw not_cnf(pr.first);
+            }
+        }
+    }
+    if (start_nullable_)
+        for (auto &b : bins_)
+            for (auto &bc : b)
+                if ((int)bc.first == start_ || (int)bc.second == start_) throw not_cnf(G.S);
+
+    // count(A, 1) = terminal rules; count(A, n) = sum over A -> B C and 0 < k < n of count(B, k) count(C, n - k)
+    size_t W = max_ + 1;
+    count_.assign(nv_ * W, BigNat());
+    for (size_t A = 0; A < nv_; ++A) if (max_ >= 1) count_[A * W + 1] = BigNat(terms_[A].size());
+    for (size_t n = 2; n <= max_; ++n) {
+        parallel_for(nv_, threads, [&](size_t begin, size_t end, unsigned) {
+            for (size_t A = begin; A < end; ++A) {
+                BigNat sum;
+                for (auto &bc : bins_[A])
+                    for (size_t k = 1; k < n; ++k) {
+                        const BigNat &l = count_[bc.first * W + k], &r = count_[bc.second * W + n - k];
+                        if (!l.is_zero() && !r.is_zero()) sum += l * r;
+                    }
+                count_[A * W + n] = std::move(sum);
+            }
+        });
+    }
+
+    // cumulative choice tables, probabilities from log2 of the counts
+    vector<double> lg(count_.size());
+    for (size_t i = 0; i < count_.size(); ++i) lg[i] = count_[i].log2();
+    table_off_.assign(nv_ * W + 1, 0);
+    for (size_t A = 0; A < nv_; ++A) {
+        for (size_t n = 0; n <= max_; ++n) {
+            size_t i = A * W + n;
+            table_off_[i] = cdf_.size();
+            if (n < 2 || count_[i].is_zero()) continue;
+            double acc = 0;
+            for (auto &bc : bins_[A])
+                for (size_t k = 1; k < n; ++k) {
+                    size_t l = bc.first * W + k, r = bc.second * W + n - k;
+                    if (count_[l].is_zero() || count_[r].is_zero()) continue;
+                    acc += exp2(lg[l] + lg[r] - lg[i]);
+                    cdf_.push_back(acc);
+                    choice_.push_back({ bc.first, bc.second, (uint32_t)k });
+                }
+            for (size_t c = table_off_[i]; c < cdf_.size(); ++c) cdf_[c] /= acc;
+        }
+    }
+    table_off_[nv_ * W] = cdf_.size();
+}
+
+const BigNat &Sampler::derivations(size_t n) const {
+    static const BigNat zero, one(1);
+    if (start_ < 0 || n > max_) return zero;
+    if (n == 0) return start_nullable_ ? one : zero;
+    return count_[start_ * (max_ + 1) + n];
+}
+
+// uniform double in [0, 1)
+static double unit(mt19937_64 &rng) { return (double)(rng() >> 11) * 0x1.0p-53; }
+
+/// @brief Draw one derivation of length n top-down, choosing each (A, len) expansion with its exact weight.
+void Sampler::draw(size_t n, mt19937_64 &rng, vector<uint32_t> &word) const {
+    word.clear();
+    size_t W = max_ + 1;
+    vector<pair<uint32_t, uint32_t>> stack{ { (uint32_t)start_, (uint32_t)n } };
+    while (!stack.empty()) {
+        auto [A, len] = stack.back();
+        stack.pop_back();
+        if (len == 1) {
+            auto &t = terms_[A];
+            word.push_back(t[min(t.size() - 1, (size_t)(unit(rng) * (double)t.size()))]);
+            continue;
+        }
+        size_t i = A * W + len;
+        const double *b = cdf_.data() + table_off_[i], *e = cdf_.data() + table_off_[i + 1];
+        size_t c = min((size_t)(upper_bound(b, e, unit(rng)) - b), (size_t)(e - b) - 1);
+        const Choice &ch = choice_[table_off_[i] + c];
+        stack.emplace_back(ch.C, len - ch.k);
+        stack.emplace_back(ch.B, ch.k);
+    }
+}
+
+namespace {
+// Counting CYK scratch of one thread: derivations per (cell, variable), with the variables present in each
+// cell listed so that only those are combined and cleared.
+struct CountChart {
+    vector<double> count;
+    vector<vector<uint32_t>> present;
+};
+}
+
+/// @brief Derivations of the start symbol for a word the grammar derives (counting CYK, in doubles).
+double Sampler::derivations_of(const vector<uint32_t> &word) const {
+    thread_local CountChart ch;
+    size_t n = word.size(), cells = n * (n + 1);
+    if (ch.present.size() < cells) ch.present.resize(cells);
+    if (ch.count.size() < cells * nv_) ch.count.assign(cells * nv_, 0);
+    auto at = [&](size_t i, size_t len) { return i * (n + 1) + len; };
+    for (size_t i = 0; i < n; ++i) {
+        size_t c = at(i, 1);
+        for (uint32_t A : term_heads_[word[i]]) {
+            double &x = ch.count[c * nv_ + A];
+            if (x == 0) ch.present[c].push_back(A);
+            x += 1;
+        }
+    }
+    for (size_t len = 2; len <= n; ++len)
+        for (size_t i = 0; i + len <= n; ++i) {
+            size_t o = at(i, len);
+            double *out = ch.count.data() + o * nv_;
+            for (size_t k = 1; k < len; ++k) {
+                size_t l = at(i, k), r = at(i + k, len - k);
+                const double *L = ch.count.data() + l * nv_, *R = ch.count.data() + r * nv_;
+                for (uint32_t B : ch.present[l])
+                    for (auto &ca : left_[B]) {
+                        double cr = R[ca.first];
+                        if (cr == 0) continue;
+                        double &x = out[ca.second];
+                        if (x == 0) ch.present[o].push_back(ca.second);
+                        x += L[B] * cr;
+                    }
+            }
+        }
+    double d = ch.count[at(0, n) * nv_ + start_];
+    for (size_t c = 0; c < cells; ++c) {
+        for (uint32_t A : ch.present[c]) ch.count[c * nv_ + A] = 0;
+        ch.present[c].clear();
+    }
+    return d;
+}
+
+/// @brief Draw derivations until one is kept: a word with d derivations is kept with probability 1/d.
+bool Sampler::sample(size_t n, mt19937_64 &rng, string &out, SampleStats &stats) const {
+    out.clear();
+    if (derivations(n).is_zero()) return false;
+    ++stats.sentences;
+    if (n == 0) return true;
+    vector<uint32_t> word;
+    for (size_t attempt = 1;; ++attempt) {
+        draw(n, rng, word);
+        ++stats.draws;
+        double d = derivations_of(word);
+        bool keep = d <= 1 || attempt == MAX_DRAWS;
+        if (d > 1) {
+            ++stats.ambiguous;
+            if (stats.witness.empty() || n < stats.witness.size()) {
+                stats.witness.clear();
+                for (uint32_t t : word) stats.witness.push_back(term_name_[t]);
+                stats.witness_derivations = d;
+            }
+            if (!keep) keep = unit(rng) * d < 1;
+            else if (attempt == MAX_DRAWS) ++stats.capped;
+        }
+        if (keep) break;
+    }
+    for (uint32_t t : word) out += term_name_[t];
+    return true;
+}
+
+void SampleStats::merge(const SampleStats &o) {
+    sentences += o.sentences;
+    draws += o.draws;
+    ambiguous += o.ambiguous;
+    capped += o.capped;
+    if (!o.witness.empty() && (witness.empty() || o.witness.size() < witness.size())) {
+        witness = o.witness;
+        witness_derivations = o.witness_derivations;
+    }
+}
+
+/// @brief Generate and write sentences in batches of chunks; each batch is split over the threads and
+/// written in chunk order.
+SampleStats write_samples(const Sampler &s, size_t count, size_t min_len, size_t max_len, uint64_t seed,
+                          unsigned threads, ostream &out) {
+    vector<size_t> lengths;
+    for (size_t n = min_len; n <= min(max_len, s.max_length()); ++n)
+        if (!s.derivations(n).is_zero()) lengths.push_back(n);
+    SampleStats total;
+    if (lengths.empty()) return total;
+
+    const size_t CHUNK = 4096;
+    size_t chunks = (count + CHUNK - 1) / CHUNK, batch = max<size_t>(1, threads) * 8;
+    vector<string> text(batch);
+    vector<SampleStats> stats(batch);
+    for (size_t first = 0; first < chunks; first += batch) {
+        size_t m = min(batch, chunks - first);
+        parallel_for(m, threads, [&](size_t begin, size_t end, unsigned) {
+            string word;
+            for (size_t c = begin; c < end; ++c) {
+                size_t chunk = first + c;
+                // splitmix64 of (seed, chunk): independent streams per chunk
+                uint64_t z = seed + 0x9e3779b97f4a7c15ull * (chunk + 1);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                mt19937_64 rng(z ^ (z >> 31));
+                string &buf = text[c];
+                buf.clear();
+                stats[c] = SampleStats();
+                size_t todo = min(CHUNK, count - chunk * CHUNK);
+                for (size_t j = 0; j < todo; ++j) {
+                    size_t n = lengths[min(lengths.size() - 1, (size_t)(unit(rng) * (double)lengths.size()))];
+                    s.sample(n, rng, word, stats[c]);
+                    buf += word.empty() ? "&" : word;
+                    buf += '\n';
+                }
+            }
+        });
+        for (size_t c = 0; c < m; ++c) {
+            out << text[c];
+            total.merge(stats[c]);
+        }
+    }
+    return total;
+}
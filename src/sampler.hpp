@@ -0,0 +1,73 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "grammar.hpp"
+#include "bignat.hpp"
+
+using namespace std;
+
+// Uniform random sentences of a CNF grammar. count(A, n), the number of derivations of A with n
+// terminals, is computed exactly (BigNat) for every n up to max_length; from it, every (A, n) gets a
+// cumulative table over its choices (A -> B C split at k), with probability count(B, k) count(C, n - k)
+// / count(A, n) evaluated in log space. A draw of length n walks down from (S, n) choosing one expansion
+// per node, which is uniform over the derivations of length n. A word with d derivations is then kept with
+// probability 1/d (counting CYK over the drawn word), so kept words are uniform over the sentences of
+// length n; for an unambiguous grammar d is always 1 and nothing is rejected.
+struct SampleStats {
+    size_t sentences = 0, draws = 0;
+    size_t ambiguous = 0; // draws of a word with more than one derivation
+    size_t capped = 0;    // sentences kept after MAX_DRAWS rejections (biased towards ambiguous words)
+    vector<Symbol> witness; // shortest ambiguous word drawn
+    double witness_derivations = 0;
+
+    void merge(const SampleStats &o);
+};
+
+class Sampler {
+public:
+    static constexpr size_t MAX_DRAWS = 1000; // per sentence
+
+    Sampler(const Grammar &G, size_t max_length, unsigned threads = 1);
+
+    size_t max_length() const { return max_; }
+    const BigNat &derivations(size_t n) const; // of the start symbol
+    size_t table_entries() const { return cdf_.size(); }
+
+    // One sentence of length n (terminals concatenated); false if there is none.
+    bool sample(size_t n, mt19937_64 &rng, string &out, SampleStats &stats) const;
+
+private:
+    struct Choice {
+        uint32_t B, C, k;
+    };
+    size_t nv_ = 0, max_ = 0;
+    int start_ = -1;
+    bool start_nullable_ = false;
+    vector<Symbol> term_name_;                      // terminal id -> terminal
+    vector<vector<uint32_t>> terms_;                // A -> a, as terminal ids
+    vector<vector<uint32_t>> term_heads_;           // terminal id -> every A with A -> a
+    vector<vector<pair<uint32_t, uint32_t>>> bins_; // A -> B C
+    vector<vector<pair<uint32_t, uint32_t>>> left_; // left_[B]: (C, A) for every A -> B C
+    vector<BigNat> count_;                          // count_[A * (max_ + 1) + n]
+    vector<size_t> table_off_;                      // choices of (A, n) in [table_off_[i], table_off_[i + 1])
+    vector<double> cdf_;
+    vector<Choice> choice_;
+
+    void draw(size_t n, mt19937_64 &rng, vector<uint32_t> &word) const;
+    double derivations_of(const vector<uint32_t> &word) const;
+};
+
+// Writes `count` sentences, one per line ('&' for the empty word), each with a length drawn uniformly
+// among the lengths in [min_len, max_len] that have sentences. Sentences are produced in chunks with
+// one generator per chunk (seeded from `seed` and the chunk index), so the output does not depend on
+// the number of threads. Returns the counts of all chunks (0 sentences if no length in range has any).
+SampleStats write_samples(const Sampler &s, size_t count, size_t min_len, size_t max_len, uint64_t seed,
+                          unsigned threads, ostream &out);
+
+#endif
@@ -0,0 +1,125 @@
+#include "terminal_classes.hpp"
+#include "rhs_pool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+
+/// @brief Group terminals by the set of contexts they occur in.
+/// @param G Grammar; aliased terminals join the class of the terminal they stand for.
+/// @param budget Limits checked while it runs (may be null).
+/// @return Dense token ids, the token -> class table and one representative per class.
+TerminalClasses compute_terminal_classes(const Grammar &G, Budget *budget) {
+    TerminalClasses tc;
+    for (auto &t : G.T) if (t != "&") tc.tokens.push_back(t);
+    for (auto &a : G.alias) if (!G.T.count(a.first)) tc.tokens.push_back(a.first);
+    sort(tc.tokens.begin(), tc.tokens.end());
+    for (uint32_t i = 0; i < tc.tokens.size(); ++i) {
+        tc.token_id.emplace(tc.tokens[i], i);
+        tc.by_length.push_back(i);
+    }
+    stable_sort(tc.by_length.begin(), tc.by_length.end(),
+                [&](uint32_t a, uint32_t b){ return tc.tokens[a].size() > tc.tokens[b].size(); });
+
+    // contexts: (variable, position, body with a hole at the position), interned
+    const SymId HOLE = UINT32_MAX;
+    RhsPool pool, contexts, sigs;
+    vector<vector<RhsId>> sig(tc.tokens.size());
+    vector<SymId> key;
+    for (auto &pr : G.P) {
+        SymId A = pool.intern(pr.first);
+        for (auto &rhs : pr.second) {
+            if (budget) budget->tick();
+            for (size_t i = 0; i < rhs.size(); ++i) {
+                auto t = tc.token_id.find(rhs[i]);
+                if (t == tc.token_id.end() || !G.T.count(rhs[i])) continue;
+                key.assign({ A, (SymId)i });
+                for (size_t j = 0; j < rhs.size(); ++j) key.push_back(j == i ? HOLE : pool.intern(rhs[j]));
+                sig[t->second].push_back(contexts.intern_ids(key));
+            }
+        }
+    }
+
+    tc.class_of.assign(tc.tokens.size(), 0);
+    map<RhsId, uint32_t> cls;
+    for (uint32_t i = 0; i < tc.tokens.size(); ++i) {
+        if (!G.T.count(tc.tokens[i])) continue;
+        auto &s = sig[i];
+        sort(s.begin(), s.end());
+        s.erase(unique(s.begin(), s.end()), s.end());
+        auto it = cls.emplace(sigs.intern_ids(s), (uint32_t)cls.size()).first;
+        if (it->second == tc.representative.size()) tc.representative.push_back(tc.tokens[i]); // smallest member
+        tc.class_of[i] = it->second;
+    }
+    for (auto &a : G.alias) {
+        if (G.T.count(a.first)) continue;
+        auto t = tc.token_id.find(a.second);
+        if (t != tc.token_id.end()) tc.class_of[tc.token_id.at(a.first)] = tc.class_of[t->second];
+    }
+    return tc;
+}
+
+bool TerminalClasses::tokenize(const string &word, vector<uint32_t> &ids) const {
+    ids.clear();
+    size_t p = 0;
+    while (p < word.size()) {
+        if (isspace((unsigned char)word[p])) { ++p; continue; }
+        bool matched = false;
+        for (uint32_t t : by_length) {
+            const Symbol &ts = tokens[t];
+            if (word.compare(p, ts.size(), ts) == 0) {
+                ids.push_back(t);
+                p += ts.size();
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) return false;
+    }
+    return true;
+}
+
+/// @brief Replace every terminal by the representative of its class.
+/// @param G Grammar rewritten in place; G.T keeps only representatives and G.alias maps the others.
+/// @param ctx Pass context (logger, pool).
+void compress_terminal_classes(Grammar &G, PassContext &ctx) {
+    Logger &log = ctx.log;
+    log.info("Classes de equivalência de terminais: início.");
+    TerminalClasses tc = compute_terminal_classes(G, &ctx.budget);
+    size_t before = G.T.size();
+
+    auto rep = [&](const Symbol &t) -> const Symbol & {
+        return tc.representative[tc.class_of[tc.token_id.at(t)]];
+    };
+    IdMarks seen;
+    for (auto &pr : G.P) {
+        auto &list = pr.second;
+        seen.clear();
+        size_t out = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            ctx.budget.tick();
+            for (auto &X : list[i]) if (X != "&" && G.T.count(X)) X = rep(X);
+            if (!seen.insert(ctx.pool.intern(list[i]))) continue;
+            if (out != i) list[out] = std::move(list[i]);
+            ++out;
+        }
+        list.resize(out);
+    }
+    for (auto &t : tc.tokens) {
+        const Symbol &r = rep(t);
+        if (r != t) G.alias[t] = r;
+    }
+    set<Symbol> newT;
+    for (auto &t : G.T) newT.insert(t == "&" ? t : rep(t));
+    G.T = newT;
+
+    log.info("Terminais: " + to_string(before) + " -> " + to_string(G.T.size()) + " (" + to_string(tc.count()) + " classes).");
+    for (size_t c = 0; c < tc.count(); ++c) {
+        string members;
+        for (uint32_t i = 0; i < tc.tokens.size(); ++i)
+            if (tc.class_of[i] == c) members += (members.empty() ? "" : ", ") + tc.tokens[i];
+        if (members != tc.representative[c]) log.info("  " + tc.representative[c] + " = {" + members + "}");
+    }
+    log.info("Classes de equivalência de terminais: finalizada.");
+    log.snapshot("Após compressão do alfabeto em classes", G);
+}
@@ -0,0 +1,34 @@
+#ifndef TERMINAL_CLASSES_HPP
+#define TERMINAL_CLASSES_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "grammar.hpp"
+#include "pass_manager.hpp"
+
+using namespace std;
+
+// Partition of the alphabet into terminals that occur in exactly the same contexts (same variable,
+// same body around them). Swapping terminals of one class never changes membership of a word.
+struct TerminalClasses {
+    vector<Symbol> tokens;                     // token id -> terminal (G.T and aliased terminals, sorted)
+    unordered_map<Symbol, uint32_t> token_id;
+    vector<uint32_t> class_of;                 // token id -> class id (dense lookup table)
+    vector<Symbol> representative;             // class id -> terminal standing for the class
+    vector<uint32_t> by_length;                // token ids, longest terminal first
+
+    size_t count() const { return representative.size(); }
+    // Split a word into token ids (longest match, whitespace ignored); false if some part is not a terminal.
+    bool tokenize(const string &word, vector<uint32_t> &ids) const;
+};
+
+// With a budget, every body scanned for contexts is a unit of work.
+TerminalClasses compute_terminal_classes(const Grammar &G, Budget *budget = nullptr);
+
+// Pass 'tclass': rewrite bodies to class representatives, shrink G.T and record the aliases.
+void compress_terminal_classes(Grammar &G, PassContext &ctx);
+
+#endif
@@ -0,0 +1,115 @@
+#include "verify.hpp"
+#include "prefix_chart.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace {
+// Terminals of both grammars, grouped by the pair (class in the first, class in the second).
+struct JointClasses {
+    vector<uint32_t> first, second; // joint class -> class in each grammar (or NO_CLASS)
+    vector<Symbol> representative;
+};
+
+JointClasses joint_classes(const TerminalClasses &a, const TerminalClasses &b) {
+    set<Symbol> tokens(a.tokens.begin(), a.tokens.end());
+    tokens.insert(b.tokens.begin(), b.tokens.end());
+    auto cls = [](const TerminalClasses &tc, const Symbol &t) {
+        auto it = tc.token_id.find(t);
+        return it == tc.token_id.end() ? PrefixChart::NO_CLASS : tc.class_of[it->second];
+    };
+    JointClasses jc;
+    map<pair<uint32_t, uint32_t>, size_t> seen;
+    for (auto &t : tokens) {
+        pair<uint32_t, uint32_t> key{ cls(a, t), cls(b, t) };
+        if (!seen.emplace(key, jc.representative.size()).second) continue;
+        jc.first.push_back(key.first);
+        jc.second.push_back(key.second);
+        jc.representative.push_back(t);
+    }
+    return jc;
+}
+
+struct Search {
+    const JointClasses &jc;
+    atomic<size_t> &limit; // longest length still worth looking at
+    mutex &lock;
+    EquivalenceReport &best;
+    vector<uint32_t> &best_word;
+    PrefixChart a, b;
+    vector<uint32_t> word;
+    size_t prefixes = 0;
+
+    void record(bool in_first) {
+        lock_guard<mutex> g(lock);
+        if (best.found && (best_word.size() < word.size() || (best_word.size() == word.size() && best_word <= word))) return;
+        best.found = true;
+        best.accepted_by_first = in_first;
+        best_word = word;
+        size_t cur = limit.load();
+        while (word.size() < cur && !limit.compare_exchange_weak(cur, word.size())) {}
+    }
+
+    // called with the charts at `word`
+    void visit() {
+        ++prefixes;
+        bool ia = a.accepts(), ib = b.accepts();
+        if (ia != ib) { record(ia); return; }
+        size_t p = word.size(), lim = limit.load();
+        if (p >= lim) return;
+        size_t R = lim - p;
+        // the second grammar only needs asking when the first cannot complete the prefix
+        auto extendable = [&](PrefixChart &c) {
+            c.compute_tails(R);
+            for (size_t r = 1; r <= R; ++r) if (c.completes(r)) return true;
+            return false;
+        };
+        if (!extendable(a) && !extendable(b)) return;
+        for (uint32_t j = 0; j < jc.representative.size(); ++j) descend(j);
+    }
+
+    void descend(uint32_t j) {
+        a.push(jc.first[j]);
+        b.push(jc.second[j]);
+        word.push_back(j);
+        visit();
+        word.pop_back();
+        a.pop();
+        b.pop();
+    }
+};
+}
+
+/// @brief Differential check of two languages up to a length bound.
+/// @param first Grammar in binary normal form (e.g. the input after 'bin').
+/// @param second Grammar in binary normal form (e.g. the normalized output).
+/// @param max_length Longest word compared.
+/// @param threads Workers; each takes a contiguous range of first symbols.
+/// @return The shortest counterexample, if any, and the number of prefixes compared.
+EquivalenceReport compare_languages(const Grammar &first, const Grammar &second, size_t max_length, unsigned threads) {
+    PrefixChart a(first, max_length), b(second, max_length);
+    JointClasses jc = joint_classes(a.classes(), b.classes());
+    EquivalenceReport report;
+    report.max_length = max_length;
+    vector<uint32_t> best_word;
+    atomic<size_t> limit(max_length);
+    mutex lock;
+    atomic<size_t> prefixes(0);
+
+    Search root{ jc, limit, lock, report, best_word, a, b, {}, 0 };
+    ++prefixes;
+    if (a.accepts() != b.accepts()) root.record(a.accepts());
+    else if (max_length > 0) {
+        parallel_for(jc.representative.size(), threads, [&](size_t begin, size_t end, unsigned) {
+            Search s{ jc, limit, lock, report, best_word, a, b, {}, 0 };
+            for (size_t j = begin; j < end; ++j) s.descend((uint32_t)j);
+            prefixes += s.prefixes;
+        });
+    }
+    report.prefixes = prefixes;
+    for (uint32_t j : best_word) report.counterexample += jc.representative[j];
+    return report;
+}
@@ -0,0 +1,25 @@
+#ifndef VERIFY_HPP
+#define VERIFY_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "grammar.hpp"
+
+using namespace std;
+
+struct EquivalenceReport {
+    size_t max_length = 0;
+    size_t prefixes = 0;          // prefixes whose membership was compared
+    bool found = false;           // a counterexample exists up to max_length
+    string counterexample;        // shortest, then first in terminal order ("" is the empty word)
+    bool accepted_by_first = false;
+};
+
+// Compares the languages of two grammars in binary normal form on every word of length <= max_length.
+// Both charts grow along one depth-first walk over prefixes (terminals that are equivalent in both
+// grammars are tried once), and a prefix is only extended while one of the grammars can still complete
+// it within the bound. The subtrees of the first symbols are split among the threads.
+EquivalenceReport compare_languages(const Grammar &first, const Grammar &second, size_t max_length, unsigned threads);
+
+#endif
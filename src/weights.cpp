@@ -0,0 +1,176 @@
+#include "weights.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "components.hpp"
+
+namespace {
+double weight_of(const Grammar &G, const Symbol &A, const RHS &rhs) {
+    auto it = G.weight.find(A);
+    if (it == G.weight.end()) return 0;
+    auto b = it->second.find(rhs);
+    return b == it->second.end() ? 0 : b->second;
+}
+
+bool is_epsilon(const RHS &rhs) { return rhs.empty() || rhs == RHS{ "&" }; }
+}
+
+/// @brief Bring the probabilities in line with G.P and make each variable sum to 1.
+void normalize_weights(Grammar &G) {
+    if (G.weight.empty()) return;
+    map<Symbol, map<RHS, double>> out;
+    for (auto &pr : G.P) {
+        if (pr.second.empty()) continue;
+        bool known = G.weight.count(pr.first) > 0;
+        auto &w = out[pr.first];
+        for (auto &rhs : pr.second) w[rhs] = weight_of(G, pr.first, rhs);
+        double sum = 0;
+        for (auto &bw : w) sum += bw.second;
+        for (auto &bw : w) bw.second = known && sum > 0 ? bw.second / sum : 1.0 / w.size();
+    }
+    G.weight.swap(out);
+}
+
+/// @brief Kleene iteration from 0: e(A) = sum over A -> α of p(α) * prod of e over α. Component by component,
+/// sinks first: a variable outside a cycle is computed once, the iteration only runs inside recursive components.
+map<Symbol, double> empty_word_probability(const Grammar &G) {
+    GrammarComponents gc = decompose_grammar(G);
+    vector<double> p(gc.rule_rhs.size()), e(gc.vars.size(), 0.0);
+    for (uint32_t v = 0; v < gc.vars.size(); ++v) {
+        set<RHS> seen; // a repeated body is one rule of G.weight
+        for (uint32_t r = gc.rule_off[v]; r < gc.rule_off[v + 1]; ++r)
+            if (seen.insert(*gc.rule_rhs[r]).second) p[r] = weight_of(G, gc.vars[v], *gc.rule_rhs[r]);
+    }
+    auto eval = [&](uint32_t v) {
+        double sum = 0;
+        for (uint32_t r = gc.rule_off[v]; r < gc.rule_off[v + 1]; ++r) {
+            double x = p[r];
+            for (uint32_t k = gc.body_off[r]; k < gc.body_off[r + 1] && x != 0; ++k) {
+                uint32_t X = gc.body[k];
+                x *= X == GrammarComponents::TERMINAL ? 0 : e[X]; // terminals never derive ε
+            }
+            sum += x;
+        }
+        return sum;
+    };
+    for_each_component(gc, 1, [&](uint32_t c, unsigned) {
+        for (int round = 0; round < 10000; ++round) {
+            double delta = 0;
+            for (uint32_t i = gc.member_off[c]; i < gc.member_off[c + 1]; ++i) {
+                uint32_t v = gc.members[i];
+                double x = eval(v);
+                delta = max(delta, fabs(x - e[v]));
+                e[v] = x;
+            }
+            if (!gc.recursive[c] || delta < 1e-15) break;
+        }
+    });
+    map<Symbol, double> out;
+    uint32_t v = 0;
+    for (auto &A : G.V) out.emplace_hint(out.end(), A, e[v++]);
+    return out;
+}
+
+/// @param G Grammar as read by remove_epsilon (with the fresh start already added, if any).
+/// @param nullable Variables that derive ε.
+/// @param new_start Fresh start S0 created by the pass, or empty.
+/// @param old_start Start symbol S0 stands for.
+/// @param budget Limits of the run (ticked per variant).
+map<Symbol, map<RHS, double>> epsilon_free_weights(const Grammar &G, const set<Symbol> &nullable,
+                                                   const Symbol &new_start, const Symbol &old_start, Budget &budget) {
+    map<Symbol, double> e = empty_word_probability(G);
+    map<Symbol, map<RHS, double>> out;
+    vector<size_t> pos;
+    for (auto &pr : G.weight) {
+        const Symbol &A = pr.first;
+        for (auto &bw : pr.second) {
+            const RHS &rhs = bw.first;
+            if (is_epsilon(rhs)) continue;
+            pos.clear();
+            for (size_t i = 0; i < rhs.size(); ++i) if (nullable.count(rhs[i])) pos.push_back(i);
+            size_t m = pos.size();
+            if (m >= 64) throw runtime_error("Remoção de regras-ε: corpo com " + to_string(m) + " símbolos anuláveis (2^" + to_string(m) + " variantes).");
+            for (uint64_t mask = 0; mask < ((uint64_t)1 << m); ++mask) {
+                budget.tick();
+                RHS variant;
+                double w = bw.second;
+                for (size_t i = 0, j = 0; i < rhs.size(); ++i) {
+                    if (j < m && pos[j] == i) {
+                        double ex = e[rhs[i]];
+                        bool drop = (mask >> j++) & 1;
+                        w *= drop ? ex : 1 - ex;
+                        if (drop) continue;
+                    }
+                    variant.push_back(rhs[i]);
+                }
+                // ε and A -> A are dropped by the pass; conditioning on a non-empty yield makes up for them
+                if (variant.empty() || (variant.size() == 1 && variant[0] == A)) continue;
+                out[A][variant] += w;
+            }
+        }
+    }
+    if (!new_start.empty()) {
+        double es = e[old_start];
+        out[new_start][RHS{ old_start }] = 1 - es;
+        out[new_start][RHS{ "&" }] = es;
+    }
+    return out;
+}
+
+/// @param G Grammar as read by remove_unit_productions.
+/// @param closure Unit closure of every variable (itself included).
+map<Symbol, map<RHS, double>> unit_free_weights(const Grammar &G, const map<Symbol, set<Symbol>> &closure) {
+    auto is_unit = [&](const RHS &rhs) { return rhs.size() == 1 && !G.isTerminal(rhs[0]); };
+    // unit steps into each variable: B <- (C, p(C -> B))
+    map<Symbol, vector<pair<Symbol, double>>> unit_in;
+    for (auto &pr : G.weight)
+        for (auto &bw : pr.second)
+            if (is_unit(bw.first)) unit_in[bw.first[0]].emplace_back(pr.first, bw.second);
+
+    map<Symbol, map<RHS, double>> out;
+    for (auto &pr : G.weight) {
+        const Symbol &A = pr.first;
+        auto cl = closure.find(A);
+        map<Symbol, double> u{ { A, 1.0 } };
+        if (cl != closure.end() && cl->second.size() > 1) {
+            // u(A, B) = [A = B] + sum over C -> B of u(A, C) p(C -> B), by Gauss-Seidel sweeps
+            for (int round = 0; round < 10000; ++round) {
+                double delta = 0;
+                for (auto &B : cl->second) {
+                    double x = B == A ? 1.0 : 0.0;
+                    auto in = unit_in.find(B);
+                    if (in != unit_in.end())
+                        for (auto &cp : in->second) {
+                            auto uc = u.find(cp.first);
+                            if (uc != u.end()) x += uc->second * cp.second;
+                        }
+                    double &cur = u[B];
+                    delta = max(delta, fabs(x - cur));
+                    cur = x;
+                }
+                if (delta < 1e-15) break;
+            }
+        }
+        auto &dst = out[A];
+        for (auto &ub : u) {
+            auto src = G.weight.find(ub.first);
+            if (src == G.weight.end() || ub.second == 0) continue;
+            for (auto &bw : src->second)
+                if (!is_unit(bw.first)) dst[bw.first] += ub.second * bw.second;
+        }
+    }
+    return out;
+}
+
+void rekey_weights(Grammar &G, const function<void(RHS &)> &rewrite) {
+    for (auto &pr : G.weight) {
+        map<RHS, double> next;
+        for (auto &bw : pr.second) {
+            RHS key = bw.first;
+            rewrite(key);
+            next[key] += bw.second;
+        }
+        pr.second.swap(next);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef WEIGHTS_HPP
+#define WEIGHTS_HPP
+
+#include <functional>
+#include <map>
+#include <set>
+
+#include "budget.hpp"
+#include "grammar.hpp"
+
+using namespace std;
+
+// Rule probabilities (Grammar::weight) through the normalization passes. Each pass that changes the
+// bodies hands the probabilities of the grammar it read to one of these and gets the ones of the
+// grammar it writes; the distribution over terminal strings is kept (exactly for proper grammars).
+
+// Make every variable's probabilities sum to 1 over its current bodies: entries of bodies no longer in
+// G.P are dropped, and a variable without any entry (e.g. one created by a pass) gets a uniform split.
+void normalize_weights(Grammar &G);
+
+// e(A): probability that A derives ε (least fixpoint, by iteration).
+map<Symbol, double> empty_word_probability(const Grammar &G);
+
+// Probabilities after remove_epsilon: the variant of A -> α without the nullable symbols in D gets
+// p(α) * prod_{X in D} e(X) * prod_{nullable X kept} (1 - e(X)), summed over equal variants; A is then
+// conditioned on a non-empty yield. `new_start` (empty if none) is the fresh start S0 -> S | & that
+// stands for `old_start`. Each variant is a tick of `budget`.
+map<Symbol, map<RHS, double>> epsilon_free_weights(const Grammar &G, const set<Symbol> &nullable,
+                                                   const Symbol &new_start, const Symbol &old_start, Budget &budget);
+
+// Probabilities after remove_unit_productions: A -> β gets sum over B in the unit closure of A of
+// u(A, B) * p(B -> β), u(A, B) the total probability of the unit chains from A to B.
+map<Symbol, map<RHS, double>> unit_free_weights(const Grammar &G, const map<Symbol, set<Symbol>> &closure);
+
+// Rewrite the body keys in place (passes that only rename symbols inside bodies).
+void rekey_weights(Grammar &G, const function<void(RHS &)> &rewrite);
+
+#endif
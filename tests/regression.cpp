@@ -0,0 +1,230 @@
+// regression.cpp
+// Checks run by ctest: incremental normalization against full runs over random grammars and deltas, and
+// grammars written with --output read back to the same grammar (or, after tclass, the same language).
+// Compilar: g++ -std=c++17 -O2 -pthread tests/regression.cpp $(ls src/*.cpp | grep -v glc_norm_v2) -Isrc -o glc_tests
+// Uso: ./glc_tests incremental pasta [--count=N] [--deltas=N] [--seed=S]
+//      ./glc_tests readback pasta [--count=N] [--seed=S] [gramatica.txt ...]
+// Sai com 0 se tudo confere, 2 numa diferença e 1 num erro.
+
+#include <bits/stdc++.h>
+
+#include "incremental.hpp"
+#include "io_handling.hpp"
+#include "pass_manager.hpp"
+#include "utility.hpp"
+#include "verify.hpp"
+
+using namespace std;
+
+namespace {
+// Small grammars over one-letter symbols (variables S, A..F, terminals a..c), so bodies written without
+// separators split back the same way. Bodies of 0 to 3 symbols give ε, unit, useless and left-recursive rules.
+struct RandomGrammars {
+    mt19937_64 rng;
+    explicit RandomGrammars(uint64_t seed) : rng(seed) {}
+
+    size_t pick(size_t n) { return (size_t)(rng() % n); }
+
+    RHS body(const vector<Symbol> &vars, const vector<Symbol> &terms) {
+        RHS r;
+        size_t n = pick(4);
+        for (size_t i = 0; i < n; ++i)
+            r.push_back(pick(2) ? vars[pick(vars.size())] : terms[pick(terms.size())]);
+        return r;
+    }
+
+    Grammar make() {
+        Grammar G;
+        G.S = "S";
+        vector<Symbol> vars = { "S" }, terms = { "a", "b", "c" };
+        for (size_t i = 0, n = 2 + pick(5); i < n; ++i) vars.push_back(string(1, char('A' + i)));
+        G.V.insert(vars.begin(), vars.end());
+        G.T.insert(terms.begin(), terms.end());
+        for (auto &A : vars)
+            for (size_t i = 0, n = 1 + pick(3); i < n; ++i) G.P[A].push_back(body(vars, terms));
+        return G;
+    }
+
+    // 1 to 3 edits: a body added to a variable (sometimes a new one, G or H) or an existing body removed. Bodies
+    // only use variables that already have rules, since a new one would be read as a terminal until it has some.
+    GrammarDelta delta(const Grammar &G) {
+        GrammarDelta d;
+        vector<Symbol> vars(G.V.begin(), G.V.end()), terms(G.T.begin(), G.T.end()), lhs = vars;
+        for (const char *X : { "G", "H" })
+            if (!G.V.count(X) && pick(4) == 0) lhs.push_back(X);
+        for (size_t i = 0, n = 1 + pick(3); i < n; ++i) {
+            const Symbol &A = lhs[pick(lhs.size())];
+            auto it = G.P.find(A);
+            if (pick(2) && it != G.P.end() && !it->second.empty())
+                d.removed.emplace_back(A, it->second[pick(it->second.size())]);
+            else
+                d.added.emplace_back(A, body(vars, terms));
+        }
+        return d;
+    }
+
+    // Adds terminal d as a copy of c (every body with c also with d in each of its c positions), so tclass
+    // has a class to merge.
+    void twin_terminal(Grammar &G) {
+        G.T.insert("d");
+        for (auto &[A, bodies] : G.P) {
+            vector<RHS> out;
+            for (auto &r : bodies) {
+                vector<RHS> variants = { RHS() };
+                for (auto &s : r) {
+                    vector<RHS> next;
+                    for (auto &v : variants) {
+                        next.push_back(v);
+                        next.back().push_back(s);
+                        if (s == "c") {
+                            next.push_back(v);
+                            next.back().push_back("d");
+                        }
+                    }
+                    variants = std::move(next);
+                }
+                out.insert(out.end(), variants.begin(), variants.end());
+            }
+            bodies = std::move(out);
+        }
+    }
+};
+
+bool same_grammar(const Grammar &a, const Grammar &b) {
+    return a.V == b.V && a.T == b.T && a.S == b.S && a.P == b.P;
+}
+
+// The same grammar once read back: ε is written as & and read as an empty body, and the start is listed
+// among the variables even when useless removal left none.
+bool same_after_readback(const Grammar &written, const Grammar &read) {
+    Grammar a = written;
+    a.V.insert(a.S);
+    for (auto &[A, bodies] : a.P)
+        for (auto &r : bodies)
+            if (r == RHS{ "&" }) r.clear();
+    return same_grammar(a, read);
+}
+
+Grammar normalized(Grammar G, const string &pipeline) {
+    Logger quiet("/dev/null");
+    quiet.enabled = false;
+    PassContext ctx(quiet);
+    run_pipeline(G, parse_pipeline(pipeline), ctx);
+    return G;
+}
+
+void write_delta(const string &file, const GrammarDelta &d) {
+    ofstream out(file);
+    if (!out) throw runtime_error("Não foi possível escrever " + file);
+    auto line = [&](char op, const Symbol &A, const RHS &r) {
+        out << op << ' ' << A << " -> ";
+        if (r.empty()) out << '&';
+        for (auto &s : r) out << s;
+        out << '\n';
+    };
+    for (auto &[A, r] : d.removed) line('-', A, r);
+    for (auto &[A, r] : d.added) line('+', A, r);
+}
+
+// Writes every grammar and its deltas to dir (gN.txt, gN_dK.txt, so a difference can be rerun with
+// glc_norm gN.txt incremental log.txt --delta=gN_d0.txt,..., as the incremental-cli-g* tests do), reads them
+// back as the incremental mode does and compares each update with a full cnf run.
+int check_incremental(const string &dir, size_t count, size_t deltas, uint64_t seed) {
+    RandomGrammars gen(seed);
+    size_t differences = 0, rebuilt = 0;
+    for (size_t g = 0; g < count; ++g) {
+        string base = dir + "/g" + to_string(g);
+        write_grammar_file(base + ".txt", gen.make(), GrammarFormat::Text);
+        Grammar G;
+        read_grammar(base + ".txt", G);
+        IncrementalNormalizer inc(G);
+        for (size_t k = 0; k < deltas; ++k) {
+            string file = base + "_d" + to_string(k) + ".txt";
+            write_delta(file, gen.delta(inc.input()));
+            IncrementalStats st = inc.apply(read_grammar_delta(file, inc.input()));
+            rebuilt += st.rebuilt;
+            if (!same_grammar(inc.result(), normalized(inc.input(), "cnf"))) {
+                cerr << "DIFERENÇA: " << file << " (incremental e completa dão gramáticas diferentes)\n";
+                ++differences;
+            }
+        }
+    }
+    cout << count << " gramática(s), " << count * deltas << " delta(s) (" << rebuilt << " refeito(s) da entrada), "
+         << differences << " diferença(s).\n";
+    return differences ? 2 : 0;
+}
+
+// Normalizes G with the pipeline, writes it as --output does and reads it back: the same grammar, or after
+// tclass (class members written back in place of their representative) the language of the input.
+bool readback(const Grammar &G, const string &pipeline, const string &file) {
+    Grammar N = normalized(G, pipeline), R;
+    write_grammar_file(file, N, GrammarFormat::Text);
+    read_grammar(file, R);
+    bool same;
+    if (N.alias.empty()) {
+        same = same_after_readback(N, R);
+    } else {
+        EquivalenceReport r = compare_languages(normalized(G, "2nf"), normalized(R, "2nf"), 8, 1);
+        same = !r.found;
+    }
+    if (!same) cerr << "DIFERENÇA: " << file << " (etapas " << pipeline << ") não é lida de volta igual.\n";
+    return same;
+}
+
+int check_readback(const string &dir, const vector<string> &files, size_t count, uint64_t seed) {
+    const vector<string> pipelines = { "cnf", "gnf", "2nf", "cnf,tclass" };
+    vector<pair<string, Grammar>> grammars;
+    for (auto &f : files) {
+        Grammar G;
+        read_grammar(f, G);
+        grammars.emplace_back(f.substr(f.find_last_of('/') + 1), std::move(G));
+    }
+    RandomGrammars gen(seed);
+    for (size_t g = 0; g < count; ++g) {
+        Grammar G = gen.make();
+        if (g % 2) gen.twin_terminal(G);
+        string name = "r" + to_string(g);
+        write_grammar_file(dir + "/" + name + ".txt", G, GrammarFormat::Text); // the input, to rerun a difference
+        grammars.emplace_back(name, std::move(G));
+    }
+    size_t differences = 0, checks = 0, merged = 0;
+    for (auto &[name, G] : grammars)
+        for (auto &p : pipelines) {
+            string tag = p;
+            replace(tag.begin(), tag.end(), ',', '-');
+            differences += !readback(G, p, dir + "/" + name + "." + tag + ".txt");
+            merged += !normalized(G, p).alias.empty();
+            ++checks;
+        }
+    cout << checks << " gramática(s) gravada(s) e lida(s) (" << merged << " com classes de terminais), "
+         << differences << " diferença(s).\n";
+    return differences ? 2 : 0;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " incremental|readback pasta [--count=N] [--deltas=N] [--seed=S] [gramatica.txt ...]\n";
+        return 1;
+    }
+    string mode = argv[1], dir = argv[2];
+    size_t count = 200, deltas = 4;
+    uint64_t seed = 1;
+    vector<string> files;
+    for (int i = 3; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--count=", 0) == 0) count = strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--deltas=", 0) == 0) deltas = strtoull(arg.c_str() + 9, nullptr, 10);
+        else if (arg.rfind("--seed=", 0) == 0) seed = strtoull(arg.c_str() + 7, nullptr, 10);
+        else files.push_back(arg);
+    }
+    try {
+        filesystem::create_directories(dir);
+        if (mode == "incremental") return check_incremental(dir, count, deltas, seed);
+        if (mode == "readback") return check_readback(dir, files, count, seed);
+        cerr << "Modo desconhecido: use incremental ou readback\n";
+    } catch (const exception &e) {
+        cerr << "Erro: " << e.what() << "\n";
+    }
+    return 1;
+}